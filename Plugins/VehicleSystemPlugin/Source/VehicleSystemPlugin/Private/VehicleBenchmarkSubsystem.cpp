@@ -0,0 +1,580 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleBenchmarkSubsystem.h"
+#include "VehicleSystemBase.h"
+#include "VehicleSystemPlugin.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "GameFramework/GameStateBase.h"
+#include "VehicleNetInterpolation.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+static FAutoConsoleCommandWithWorldAndArgs VehicleBenchmarkStartCommand(
+	TEXT("VehicleBenchmark.Start"),
+	TEXT("Servers spawn and drive vehicles, every machine records a replication report. VehicleBenchmark.Start <vehicles> <class path> [seconds]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		UVehicleBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UVehicleBenchmarkSubsystem>() : nullptr;
+		if (Benchmark)
+		{
+			const int32 NumVehicles = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+			const FString ClassPath = Args.Num() > 1 ? Args[1] : FString();
+			const float Duration = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 60.0f;
+			Benchmark->StartBenchmark(NumVehicles, Duration, ClassPath);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld VehicleBenchmarkStopCommand(
+	TEXT("VehicleBenchmark.Stop"),
+	TEXT("Ends the running vehicle benchmark and writes its report"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (UVehicleBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UVehicleBenchmarkSubsystem>() : nullptr)
+		{
+			Benchmark->StopBenchmark();
+		}
+	}));
+
+namespace VehicleBenchmark
+{
+	static TSharedRef<FJsonObject> Summarize(TArray<float> Values)
+	{
+		TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+		if (Values.Num() == 0)
+		{
+			return Summary;
+		}
+
+		Values.Sort();
+		double Sum = 0;
+		for (float Value : Values)
+		{
+			Sum += Value;
+		}
+		auto Percentile = [&Values](float Fraction)
+		{
+			return Values[FMath::Clamp(FMath::FloorToInt(Fraction * (Values.Num() - 1)), 0, Values.Num() - 1)];
+		};
+		Summary->SetNumberField(TEXT("Avg"), Sum / Values.Num());
+		Summary->SetNumberField(TEXT("P50"), Percentile(0.5f));
+		Summary->SetNumberField(TEXT("P95"), Percentile(0.95f));
+		Summary->SetNumberField(TEXT("P99"), Percentile(0.99f));
+		Summary->SetNumberField(TEXT("Max"), Values.Last());
+		return Summary;
+	}
+}
+
+bool UVehicleBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bInitialized = true;
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	const bool IsBenchmarkServer = FParse::Value(CommandLine, TEXT("VehicleBenchmark="), NumVehicles);
+	if (IsBenchmarkServer || FParse::Param(CommandLine, TEXT("VehicleBenchmark")))
+	{
+		FParse::Value(CommandLine, TEXT("VehicleBenchmarkClients="), NumClients);
+		FParse::Value(CommandLine, TEXT("VehicleBenchmarkDuration="), Duration);
+		FString ClassPath;
+		FParse::Value(CommandLine, TEXT("VehicleBenchmarkClass="), ClassPath);
+		ExitWhenDone = FParse::Param(CommandLine, TEXT("VehicleBenchmarkExit"));
+		StartBenchmark(NumVehicles, Duration, ClassPath);
+	}
+}
+
+void UVehicleBenchmarkSubsystem::Deinitialize()
+{
+	if (IsRunning())
+	{
+		FinishBenchmark();
+	}
+	bInitialized = false;
+	Super::Deinitialize();
+}
+
+bool UVehicleBenchmarkSubsystem::IsTickable() const
+{
+	return bInitialized && IsRunning() && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UVehicleBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+bool UVehicleBenchmarkSubsystem::IsServer() const
+{
+	UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Client;
+}
+
+void UVehicleBenchmarkSubsystem::StartBenchmark(int32 InNumVehicles, float InDuration, const FString& ClassPath)
+{
+	if (IsRunning())
+	{
+		return;
+	}
+	if (IsServer())
+	{
+		//A plain AVehicleSystemBase has no simulating mesh, so it would sit still and the report would measure idle vehicles
+		VehicleClassPath = ClassPath;
+		VehicleClass = ClassPath.IsEmpty() ? nullptr : LoadClass<AVehicleSystemBase>(nullptr, *ClassPath);
+		if (!VehicleClass)
+		{
+			UE_LOG(LogVehicleSystem, Error, TEXT("VehicleBenchmark: needs a vehicle class with a simulating mesh, couldn't load '%s'"), *ClassPath);
+			if (ExitWhenDone)
+			{
+				FPlatformMisc::RequestExit(false);
+			}
+			return;
+		}
+	}
+	NumVehicles = FMath::Max(0, InNumVehicles);
+	Duration = FMath::Max(1.0f, InDuration);
+	State = IsServer() ? EBenchmarkState::WaitingForClients : EBenchmarkState::WaitingForVehicles;
+	UE_LOG(LogVehicleSystem, Log, TEXT("VehicleBenchmark: starting, %d vehicles for %.0f seconds"), NumVehicles, Duration);
+}
+
+void UVehicleBenchmarkSubsystem::StopBenchmark()
+{
+	if (IsRunning())
+	{
+		FinishBenchmark();
+	}
+}
+
+void UVehicleBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (!World || !World->HasBegunPlay())
+	{
+		return;
+	}
+	const float Now = World->GetTimeSeconds();
+
+	switch (State)
+	{
+	case EBenchmarkState::WaitingForClients:
+	{
+		UNetDriver* NetDriver = World->GetNetDriver();
+		const int32 Connected = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+		if (Connected >= NumClients)
+		{
+			SpawnVehicles();
+			State = EBenchmarkState::WarmingUp;
+			StateStartTime = Now;
+		}
+		break;
+	}
+	case EBenchmarkState::WaitingForVehicles:
+		if (Now >= NextSecondTime)
+		{
+			NextSecondTime = Now + 1.0f;
+			if (TActorIterator<AVehicleSystemBase>(World))
+			{
+				State = EBenchmarkState::WarmingUp;
+				StateStartTime = Now;
+			}
+		}
+		break;
+	case EBenchmarkState::WarmingUp:
+		DriveVehicles(Now);
+		if (Now - StateStartTime >= WarmupTime)
+		{
+			BeginRecording();
+			State = EBenchmarkState::Recording;
+			StateStartTime = Now;
+			NextSecondTime = Now + 1.0f;
+		}
+		break;
+	case EBenchmarkState::Recording:
+		DriveVehicles(Now);
+		RecordFrame(DeltaTime);
+		if (Now >= NextSecondTime)
+		{
+			NextSecondTime += 1.0f;
+			RecordSecond();
+		}
+		if (Now - StateStartTime >= Duration)
+		{
+			FinishBenchmark();
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void UVehicleBenchmarkSubsystem::SpawnVehicles()
+{
+	UWorld* World = GetWorld();
+	FVector Origin = FVector(0, 0, 200);
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	//Square grid, far enough apart that they don't collide until they start turning
+	const float Spacing = 1500.0f;
+	const int32 Columns = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt((float)NumVehicles)));
+	for (int32 i = 0; i < NumVehicles; i++)
+	{
+		const FVector Location = Origin + FVector((i % Columns) * Spacing, (i / Columns) * Spacing, 0);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		if (AVehicleSystemBase* Vehicle = World->SpawnActor<AVehicleSystemBase>(VehicleClass, Location, FRotator::ZeroRotator, SpawnParams))
+		{
+			SpawnedVehicles.Add(Vehicle);
+		}
+	}
+}
+
+void UVehicleBenchmarkSubsystem::DriveVehicles(float Time)
+{
+	for (int32 i = 0; i < SpawnedVehicles.Num(); i++)
+	{
+		AVehicleSystemBase* Vehicle = SpawnedVehicles[i].Get();
+		UPrimitiveComponent* Chassis = Vehicle ? Vehicle->VehicleMesh : nullptr;
+		if (!Chassis || !Chassis->IsSimulatingPhysics())
+		{
+			continue;
+		}
+
+		//Accelerate forward and weave, each vehicle out of phase so the states don't all change at once
+		const float Phase = i * 0.7f;
+		const float Throttle = FMath::Sin(Time * 0.2f + Phase) > -0.5f ? 1.0f : -0.5f;
+		Chassis->AddForce(Vehicle->GetActorForwardVector() * 600.0f * Throttle, NAME_None, true);
+		Chassis->AddTorqueInRadians(FVector(0, 0, FMath::Sin(Time * 0.5f + Phase) * 1.5f), NAME_None, true);
+	}
+}
+
+void UVehicleBenchmarkSubsystem::BeginRecording()
+{
+	FrameMs.Reset();
+	GameThreadMs.Reset();
+	OutBytesPerSecond.Reset();
+	InBytesPerSecond.Reset();
+	VehicleStateBytesPerSecond.Reset();
+	RelevantVehicles.Reset();
+	StatesReached = 0;
+	Underruns = 0;
+	LateStates = 0;
+	DroppedStates = 0;
+	OutOfOrderStates = 0;
+	ErrorSum = 0;
+	ErrorSquaredSum = 0;
+	MaxError = 0;
+	PositionSamples = 0;
+	PositionErrorSum = 0;
+	PositionErrorSquaredSum = 0;
+	MaxPositionError = 0;
+	ProxyTracks.Reset();
+
+	if (IsServer())
+	{
+		const bool AnyDriven = SpawnedVehicles.ContainsByPredicate([](const TWeakObjectPtr<AVehicleSystemBase>& Vehicle)
+		{
+			return Vehicle.IsValid() && Vehicle->VehicleMesh && Vehicle->VehicleMesh->IsSimulatingPhysics();
+		});
+		if (!AnyDriven)
+		{
+			UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleBenchmark: none of the %s vehicles simulate physics, they won't move"), *VehicleClassPath);
+		}
+	}
+
+	//Throw away everything the vehicles counted while warming up
+	for (TActorIterator<AVehicleSystemBase> It(GetWorld()); It; ++It)
+	{
+		It->NetSyncStats = FVehicleNetSyncStats();
+		It->StateQueue.Stats = FVehicleStateBufferStats();
+	}
+}
+
+void UVehicleBenchmarkSubsystem::RecordFrame(float DeltaTime)
+{
+	FrameMs.Add(DeltaTime * 1000.0f);
+	GameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+	if (!IsServer())
+	{
+		SampleProxies();
+		ResolveProxySamples();
+	}
+}
+
+void UVehicleBenchmarkSubsystem::RecordOwnerState(AVehicleSystemBase* Vehicle, const FNetState& OwnerState)
+{
+	if (!IsRecording() || IsServer())
+	{
+		return;
+	}
+	FProxyTrack& Track = ProxyTracks.FindOrAdd(Vehicle);
+	if (Track.OwnerStates.Num() > 0 && OwnerState.timestamp <= Track.OwnerStates.Last().ServerTime)
+	{
+		return; //Out of order, the states around it already cover its time
+	}
+	Track.OwnerStates.Add({ OwnerState.timestamp, OwnerState.position, OwnerState.velocity });
+}
+
+void UVehicleBenchmarkSubsystem::SampleProxies()
+{
+	UWorld* World = GetWorld();
+	AGameStateBase* GameState = World->GetGameState();
+	if (!GameState)
+	{
+		return;
+	}
+
+	const float ServerTime = GameState->GetServerWorldTimeSeconds();
+	for (TActorIterator<AVehicleSystemBase> It(World); It; ++It)
+	{
+		if (It->GetCachedNetworkRole() == NetworkRoles::Client && It->VehicleMesh)
+		{
+			ProxyTracks.FindOrAdd(*It).ProxySamples.Add({ ServerTime, It->VehicleMesh->GetComponentLocation() });
+		}
+	}
+}
+
+void UVehicleBenchmarkSubsystem::ResolveProxySamples()
+{
+	for (auto It = ProxyTracks.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		//A sample can be compared once the owner's states on both sides of its time have arrived
+		FProxyTrack& Track = It->Value;
+		int32 Resolved = 0;
+		int32 OwnerIndex = 0;
+		for (; Resolved < Track.ProxySamples.Num(); Resolved++)
+		{
+			const FProxySample& Sample = Track.ProxySamples[Resolved];
+			if (Track.OwnerStates.Num() == 0 || Sample.ServerTime > Track.OwnerStates.Last().ServerTime)
+			{
+				break;
+			}
+			while (OwnerIndex + 1 < Track.OwnerStates.Num() && Track.OwnerStates[OwnerIndex + 1].ServerTime < Sample.ServerTime)
+			{
+				OwnerIndex++;
+			}
+			const FOwnerSample& From = Track.OwnerStates[OwnerIndex];
+			const FOwnerSample& To = Track.OwnerStates[FMath::Min(OwnerIndex + 1, Track.OwnerStates.Num() - 1)];
+			const float Gap = To.ServerTime - From.ServerTime;
+			if (Sample.ServerTime < From.ServerTime || Gap > MaxOwnerStateGap)
+			{
+				continue; //Before the first state we have or in a gap, there is no ground truth
+			}
+
+			const float Alpha = Gap > KINDA_SMALL_NUMBER ? (Sample.ServerTime - From.ServerTime) / Gap : 1.0f;
+			const FVector OwnerPosition = FVehicleNetInterpolation::HermitePosition(From.Position, From.Velocity, To.Position, To.Velocity, Gap, Alpha);
+			const float Error = FVector::Dist(Sample.Position, OwnerPosition);
+			PositionSamples++;
+			PositionErrorSum += Error;
+			PositionErrorSquaredSum += Error * Error;
+			MaxPositionError = FMath::Max(MaxPositionError, Error);
+		}
+		Track.ProxySamples.RemoveAt(0, Resolved, false);
+
+		//Keep the last state before the oldest waiting sample, everything earlier is done with
+		if (Track.ProxySamples.Num() == 0)
+		{
+			OwnerIndex = FMath::Max(0, Track.OwnerStates.Num() - 1);
+		}
+		if (OwnerIndex > 0)
+		{
+			Track.OwnerStates.RemoveAt(0, OwnerIndex, false);
+		}
+	}
+}
+
+void UVehicleBenchmarkSubsystem::RecordSecond()
+{
+	UWorld* World = GetWorld();
+	if (UNetDriver* NetDriver = World->GetNetDriver())
+	{
+		OutBytesPerSecond.Add(NetDriver->OutBytesPerSecond);
+		InBytesPerSecond.Add(NetDriver->InBytesPerSecond);
+	}
+
+	float StateBytes = 0;
+	int32 Relevant = 0;
+	for (TActorIterator<AVehicleSystemBase> It(World); It; ++It)
+	{
+		StateBytes += It->NetBytesPerSecond;
+		Relevant++;
+	}
+	VehicleStateBytesPerSecond.Add(StateBytes);
+	RelevantVehicles.Add(Relevant);
+	HarvestVehicleStats();
+}
+
+void UVehicleBenchmarkSubsystem::HarvestVehicleStats()
+{
+	for (TActorIterator<AVehicleSystemBase> It(GetWorld()); It; ++It)
+	{
+		const FVehicleNetSyncStats& SyncStats = It->NetSyncStats;
+		StatesReached += SyncStats.StatesReached;
+		Underruns += SyncStats.Underruns;
+		ErrorSum += SyncStats.ErrorSum;
+		ErrorSquaredSum += SyncStats.ErrorSquaredSum;
+		MaxError = FMath::Max(MaxError, SyncStats.MaxError);
+
+		const FVehicleStateBufferStats& BufferStats = It->StateQueue.Stats;
+		LateStates += BufferStats.Late;
+		DroppedStates += BufferStats.Dropped;
+		OutOfOrderStates += BufferStats.OutOfOrder;
+
+		It->NetSyncStats = FVehicleNetSyncStats();
+		It->StateQueue.Stats = FVehicleStateBufferStats();
+	}
+}
+
+void UVehicleBenchmarkSubsystem::FinishBenchmark()
+{
+	if (State == EBenchmarkState::Recording)
+	{
+		HarvestVehicleStats();
+		WriteReport();
+	}
+	State = EBenchmarkState::Idle;
+
+	for (const TWeakObjectPtr<AVehicleSystemBase>& Vehicle : SpawnedVehicles)
+	{
+		if (Vehicle.IsValid())
+		{
+			Vehicle->Destroy();
+		}
+	}
+	SpawnedVehicles.Reset();
+
+	if (ExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UVehicleBenchmarkSubsystem::WriteReport()
+{
+	using namespace VehicleBenchmark;
+	UWorld* World = GetWorld();
+	UNetDriver* NetDriver = World->GetNetDriver();
+
+	const TCHAR* NetModeName = TEXT("Standalone");
+	switch (World->GetNetMode())
+	{
+	case NM_DedicatedServer: NetModeName = TEXT("DedicatedServer"); break;
+	case NM_ListenServer: NetModeName = TEXT("ListenServer"); break;
+	case NM_Client: NetModeName = TEXT("Client"); break;
+	default: break;
+	}
+
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetNumberField(TEXT("Version"), 3);
+	Report->SetStringField(TEXT("Date"), FDateTime::UtcNow().ToIso8601());
+	Report->SetStringField(TEXT("Map"), World->GetMapName());
+	Report->SetStringField(TEXT("NetMode"), NetModeName);
+	Report->SetStringField(TEXT("VehicleClass"), VehicleClassPath);
+	Report->SetNumberField(TEXT("Duration"), World->GetTimeSeconds() - StateStartTime);
+	Report->SetNumberField(TEXT("SpawnedVehicles"), SpawnedVehicles.Num());
+	Report->SetNumberField(TEXT("Clients"), NetDriver ? NetDriver->ClientConnections.Num() : 0);
+
+	//Packet emulation the run used, PktLag and friends from the command line or Engine.ini
+	TSharedRef<FJsonObject> PacketSimulation = MakeShared<FJsonObject>();
+#if DO_ENABLE_NET_TEST
+	if (NetDriver)
+	{
+		const FPacketSimulationSettings& Settings = NetDriver->PacketSimulationSettings;
+		PacketSimulation->SetNumberField(TEXT("PktLag"), Settings.PktLag);
+		PacketSimulation->SetNumberField(TEXT("PktLagVariance"), Settings.PktLagVariance);
+		PacketSimulation->SetNumberField(TEXT("PktLoss"), Settings.PktLoss);
+		PacketSimulation->SetNumberField(TEXT("PktOrder"), Settings.PktOrder);
+		PacketSimulation->SetNumberField(TEXT("PktDup"), Settings.PktDup);
+	}
+#endif
+	Report->SetObjectField(TEXT("PacketSimulation"), PacketSimulation);
+
+	Report->SetObjectField(TEXT("FrameMs"), Summarize(FrameMs));
+	Report->SetObjectField(TEXT("GameThreadMs"), Summarize(GameThreadMs));
+
+	TSharedRef<FJsonObject> Bandwidth = MakeShared<FJsonObject>();
+	Bandwidth->SetObjectField(TEXT("OutBytesPerSecond"), Summarize(OutBytesPerSecond));
+	Bandwidth->SetObjectField(TEXT("InBytesPerSecond"), Summarize(InBytesPerSecond));
+	Bandwidth->SetObjectField(TEXT("VehicleStateBytesPerSecond"), Summarize(VehicleStateBytesPerSecond));
+	float AvgRelevant = 0;
+	for (int32 Relevant : RelevantVehicles)
+	{
+		AvgRelevant += Relevant;
+	}
+	AvgRelevant = RelevantVehicles.Num() > 0 ? AvgRelevant / RelevantVehicles.Num() : 0;
+	float AvgOut = 0;
+	for (float Out : OutBytesPerSecond)
+	{
+		AvgOut += Out;
+	}
+	AvgOut = OutBytesPerSecond.Num() > 0 ? AvgOut / OutBytesPerSecond.Num() : 0;
+	Bandwidth->SetNumberField(TEXT("RelevantVehicles"), AvgRelevant);
+	Bandwidth->SetNumberField(TEXT("OutBytesPerSecondPerVehicle"), AvgRelevant > 0 ? AvgOut / AvgRelevant : 0);
+	Report->SetObjectField(TEXT("Bandwidth"), Bandwidth);
+
+	TSharedRef<FJsonObject> Replication = MakeShared<FJsonObject>();
+	Replication->SetNumberField(TEXT("StatesReached"), StatesReached);
+	Replication->SetNumberField(TEXT("Underruns"), Underruns);
+	Replication->SetNumberField(TEXT("UnderrunRate"), StatesReached > 0 ? (double)Underruns / StatesReached : 0);
+	Replication->SetNumberField(TEXT("LateStates"), LateStates);
+	Replication->SetNumberField(TEXT("DroppedStates"), DroppedStates);
+	Replication->SetNumberField(TEXT("OutOfOrderStates"), OutOfOrderStates);
+	Report->SetObjectField(TEXT("Replication"), Replication);
+
+	//Distance between each remote vehicle and the owner's pose at the same server time, sampled every frame
+	TSharedRef<FJsonObject> PositionError = MakeShared<FJsonObject>();
+	PositionError->SetNumberField(TEXT("Samples"), PositionSamples);
+	PositionError->SetNumberField(TEXT("Avg"), PositionSamples > 0 ? PositionErrorSum / PositionSamples : 0);
+	PositionError->SetNumberField(TEXT("RMS"), PositionSamples > 0 ? FMath::Sqrt(PositionErrorSquaredSum / PositionSamples) : 0);
+	PositionError->SetNumberField(TEXT("Max"), MaxPositionError);
+	Report->SetObjectField(TEXT("PositionError"), PositionError);
+
+	//Distance between each remote vehicle and a received state as playback reaches it, how far interpolation
+	//was off from the states it was given. Mostly smoothing lag, PositionError is the error against the owner
+	TSharedRef<FJsonObject> StateReachError = MakeShared<FJsonObject>();
+	StateReachError->SetNumberField(TEXT("Avg"), StatesReached > 0 ? ErrorSum / StatesReached : 0);
+	StateReachError->SetNumberField(TEXT("RMS"), StatesReached > 0 ? FMath::Sqrt(ErrorSquaredSum / StatesReached) : 0);
+	StateReachError->SetNumberField(TEXT("Max"), MaxError);
+	Report->SetObjectField(TEXT("StateReachError"), StateReachError);
+
+	FString Json;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Report, Writer);
+
+	const FString Directory = FPaths::Combine(FPaths::ProfilingDir(), TEXT("VehicleBenchmark"));
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	const FString FileName = FString::Printf(TEXT("VehicleBenchmark-%s-%u-%s.json"), NetModeName, FPlatformProcess::GetCurrentProcessId(), *FDateTime::Now().ToString());
+	const FString Path = FPaths::Combine(Directory, FileName);
+	if (FFileHelper::SaveStringToFile(Json, *Path))
+	{
+		UE_LOG(LogVehicleSystem, Log, TEXT("VehicleBenchmark: report written to %s"), *Path);
+	}
+	else
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleBenchmark: couldn't write %s"), *Path);
+	}
+}
@@ -3,11 +3,78 @@
 
 
 #include "VehicleConstraint.h"
+#include "Engine/World.h"
+#include "VehicleConstraintSubsystem.h"
 
 void UVehicleConstraint::SetLinearSoftConstraint(bool SoftConstraint, float Stiffness, float Damping)
 {
 	ConstraintInstance.ProfileInstance.LinearLimit.bSoftConstraint = SoftConstraint;
 	ConstraintInstance.ProfileInstance.LinearLimit.Stiffness = Stiffness;
 	ConstraintInstance.ProfileInstance.LinearLimit.Damping = Damping;
-	ConstraintInstance.UpdateLinearLimit();
-}
\ No newline at end of file
+	QueueUpdate(PendingLinearLimit);
+}
+
+void UVehicleConstraint::ApplyConstraintSettings(const FVehicleConstraintSettings& Settings)
+{
+	if (Settings.SetLinearSoftConstraint)
+	{
+		SetLinearSoftConstraint(Settings.LinearSoftConstraint, Settings.LinearStiffness, Settings.LinearDamping);
+	}
+	if (Settings.SetLinearLimit)
+	{
+		ConstraintInstance.ProfileInstance.LinearLimit.Limit = Settings.LinearLimit;
+		QueueUpdate(PendingLinearLimit);
+	}
+	if (Settings.SetAngularDrive)
+	{
+		PendingAngularPositionStrength = Settings.AngularPositionStrength;
+		PendingAngularVelocityStrength = Settings.AngularVelocityStrength;
+		PendingAngularForceLimit = Settings.AngularForceLimit;
+		QueueUpdate(PendingAngularDrive);
+	}
+}
+
+void UVehicleConstraint::ApplyConstraintSettingsToAll(const TArray<UVehicleConstraint*>& Constraints, const FVehicleConstraintSettings& Settings)
+{
+	for (UVehicleConstraint* Constraint : Constraints)
+	{
+		if (Constraint)
+		{
+			Constraint->ApplyConstraintSettings(Settings);
+		}
+	}
+}
+
+void UVehicleConstraint::QueueUpdate(uint8 Update)
+{
+	const bool WasQueued = PendingUpdates != 0;
+	PendingUpdates |= Update;
+	if (WasQueued)
+	{
+		return; //Coalesced with the changes already waiting
+	}
+
+	UWorld* World = GetWorld();
+	UVehicleConstraintSubsystem* ConstraintSubsystem = World ? World->GetSubsystem<UVehicleConstraintSubsystem>() : nullptr;
+	if (ConstraintSubsystem)
+	{
+		ConstraintSubsystem->QueueConstraint(this);
+	}
+	else
+	{
+		FlushPendingUpdates(); //Editor worlds have no subsystem
+	}
+}
+
+void UVehicleConstraint::FlushPendingUpdates()
+{
+	if (PendingUpdates & PendingLinearLimit)
+	{
+		ConstraintInstance.UpdateLinearLimit();
+	}
+	if (PendingUpdates & PendingAngularDrive)
+	{
+		ConstraintInstance.SetAngularDriveParams(PendingAngularPositionStrength, PendingAngularVelocityStrength, PendingAngularForceLimit);
+	}
+	PendingUpdates = 0;
+}
@@ -0,0 +1,80 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleConstraintSubsystem.h"
+#include "Engine/World.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "VehicleConstraint.h"
+#include "VehicleSystemStats.h"
+
+bool UVehicleConstraintSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleConstraintSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UVehicleConstraintSubsystem::Deinitialize()
+{
+	FlushConstraintUpdates();
+	bInitialized = false;
+	Super::Deinitialize();
+}
+
+bool UVehicleConstraintSubsystem::IsTickable() const
+{
+	return bInitialized && PendingConstraints.Num() > 0 && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UVehicleConstraintSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleConstraintSubsystem, STATGROUP_Tickables);
+}
+
+void UVehicleConstraintSubsystem::Tick(float DeltaTime)
+{
+	FlushConstraintUpdates();
+}
+
+void UVehicleConstraintSubsystem::QueueConstraint(UVehicleConstraint* Constraint)
+{
+	PendingConstraints.Add(Constraint);
+}
+
+void UVehicleConstraintSubsystem::FlushConstraintUpdates()
+{
+	if (PendingConstraints.Num() == 0)
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_VehicleConstraintFlush);
+	VEHICLE_COUNTER_ADD(ConstraintUpdates, PendingConstraints.Num());
+
+	TArray<TWeakObjectPtr<UVehicleConstraint>> Constraints = MoveTemp(PendingConstraints);
+	auto FlushAll = [&Constraints]()
+	{
+		for (const TWeakObjectPtr<UVehicleConstraint>& Constraint : Constraints)
+		{
+			if (UVehicleConstraint* ValidConstraint = Constraint.Get())
+			{
+				ValidConstraint->FlushPendingUpdates();
+			}
+		}
+	};
+
+#if PHYSICS_INTERFACE_PHYSX
+	//PhysX scene locks are reentrant, each constraint's own write nests inside this one instead of locking the scene again
+	FPhysScene* Scene = GetWorld()->GetPhysicsScene();
+	if (Scene)
+	{
+		FPhysicsCommand::ExecuteWrite(Scene, FlushAll);
+		return;
+	}
+#endif
+	FlushAll();
+}
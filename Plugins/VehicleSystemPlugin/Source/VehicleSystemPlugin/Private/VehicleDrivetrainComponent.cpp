@@ -0,0 +1,209 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleDrivetrainComponent.h"
+#include "VehicleSystemBase.h"
+#include "VehicleSystemStats.h"
+
+void FVehicleCurveTable::Bake(const FRichCurve& Curve, int32 NumSamples)
+{
+	Samples.Reset();
+	if (Curve.GetNumKeys() == 0)
+	{
+		return;
+	}
+
+	float MaxX = 0;
+	Curve.GetTimeRange(MinX, MaxX);
+	NumSamples = FMath::Max(NumSamples, 2);
+	const float Step = FMath::Max(MaxX - MinX, KINDA_SMALL_NUMBER) / (NumSamples - 1);
+	SamplesPerUnit = 1.0f / Step;
+
+	Samples.SetNumUninitialized(NumSamples);
+	for (int32 i = 0; i < NumSamples; i++)
+	{
+		Samples[i] = Curve.Eval(MinX + Step * i);
+	}
+}
+
+void FVehicleGearTableEntry::Bake(const FVehicleGear& Gear)
+{
+	StartSpeed = Gear.StartSpeed;
+	SpeedToPercent = (Gear.EndSpeed > Gear.StartSpeed) ? 1.0f / (Gear.EndSpeed - Gear.StartSpeed) : 0.0f;
+	LowRPM = Gear.LowRPM;
+	RPMRange = Gear.HighRPM - Gear.LowRPM;
+	MaxTorque = Gear.MaxTorque;
+	TorqueRange = Gear.MinTorque - Gear.MaxTorque;
+
+	//Gears set up before UpShift and DownShift were used shift at the ends of their range
+	UpShiftSpeed = (Gear.UpShift > 0) ? Gear.UpShift : Gear.EndSpeed;
+	DownShiftSpeed = (Gear.DownShift > 0) ? Gear.DownShift : Gear.StartSpeed;
+}
+
+UVehicleDrivetrainComponent::UVehicleDrivetrainComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false; //Updated by the vehicle
+}
+
+void UVehicleDrivetrainComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	Vehicle = Cast<AVehicleSystemBase>(GetOwner());
+	BakeGears();
+}
+
+void UVehicleDrivetrainComponent::BakeGears()
+{
+	GearTable.Reset();
+	if (Vehicle)
+	{
+		GearTable.SetNum(Vehicle->Gears.Num());
+		for (int32 i = 0; i < GearTable.Num(); i++)
+		{
+			GearTable[i].Bake(Vehicle->Gears[i]);
+		}
+	}
+	CurrentGear = FMath::Clamp(CurrentGear, 0, FMath::Max(GearTable.Num() - 1, 0));
+}
+
+void UVehicleDrivetrainComponent::SetThrottleInput(float Throttle)
+{
+	const bool HadInput = HasInput();
+	ThrottleInput = FMath::Clamp(Throttle, -1.0f, 1.0f);
+	WakeOnInput(HadInput);
+}
+
+void UVehicleDrivetrainComponent::SetSteeringInput(float Steering)
+{
+	const bool HadInput = HasInput();
+	SteeringInput = FMath::Clamp(Steering, -1.0f, 1.0f);
+	WakeOnInput(HadInput);
+}
+
+void UVehicleDrivetrainComponent::SetBrakeInput(float Brake)
+{
+	const bool HadInput = HasInput();
+	BrakeInput = FMath::Clamp(Brake, 0.0f, 1.0f);
+	WakeOnInput(HadInput);
+}
+
+void UVehicleDrivetrainComponent::SetHandbrakeInput(bool Handbrake)
+{
+	const bool HadInput = HasInput();
+	HandbrakeInput = Handbrake;
+	WakeOnInput(HadInput);
+}
+
+bool UVehicleDrivetrainComponent::HasInput() const
+{
+	return ThrottleInput != 0 || SteeringInput != 0 || BrakeInput != 0 || HandbrakeInput;
+}
+
+void UVehicleDrivetrainComponent::WakeOnInput(bool HadInput)
+{
+	//Resting wheels stop pushing, so nothing else would wake a body that settled or started asleep
+	if (!HadInput && HasInput() && Vehicle && Vehicle->VehicleMesh->IsSimulatingPhysics())
+	{
+		Vehicle->VehicleMesh->WakeRigidBody();
+		Vehicle->WakeFromRest();
+	}
+}
+
+FVehicleInputFrame UVehicleDrivetrainComponent::GetInputFrame() const
+{
+	FVehicleInputFrame Input;
+	Input.Throttle = ThrottleInput;
+	Input.Brake = BrakeInput;
+	Input.Steering = SteeringInput;
+	Input.Handbrake = HandbrakeInput;
+	return Input;
+}
+
+void UVehicleDrivetrainComponent::ApplyInputFrame(const FVehicleInputFrame& Input)
+{
+	SetThrottleInput(Input.Throttle);
+	SetBrakeInput(Input.Brake);
+	SetSteeringInput(Input.Steering);
+	SetHandbrakeInput(Input.Handbrake);
+}
+
+void UVehicleDrivetrainComponent::ShiftUp()
+{
+	if (!IsShifting && CurrentGear < GearTable.Num() - 1)
+	{
+		SetGear(CurrentGear + 1);
+	}
+}
+
+void UVehicleDrivetrainComponent::ShiftDown()
+{
+	if (!IsShifting && CurrentGear > 0)
+	{
+		SetGear(CurrentGear - 1);
+	}
+}
+
+void UVehicleDrivetrainComponent::SetGear(int32 Gear)
+{
+	CurrentGear = Gear;
+	ShiftEndTime = Vehicle->GetLocalWorldTime() + ShiftTime;
+	IsShifting = ShiftTime > 0;
+}
+
+void UVehicleDrivetrainComponent::SelectGear()
+{
+	//One gear at a time, the next one waits for ShiftTime
+	const FVehicleGearTableEntry& Gear = GearTable[CurrentGear];
+	if (Speed > Gear.UpShiftSpeed && CurrentGear < GearTable.Num() - 1)
+	{
+		SetGear(CurrentGear + 1);
+	}
+	else if (Speed < Gear.DownShiftSpeed && CurrentGear > 0)
+	{
+		SetGear(CurrentGear - 1);
+	}
+}
+
+void UVehicleDrivetrainComponent::UpdateDrivetrain(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VehicleDrivetrain);
+	if (!Vehicle)
+	{
+		return;
+	}
+
+	const float SignedSpeed = FVector::DotProduct(Vehicle->GetVelocity(), Vehicle->GetActorForwardVector()) * SpeedScale;
+	Speed = FMath::Abs(SignedSpeed);
+
+	const float TargetSteering = Vehicle->GetSteeringFromCurve(Speed) * SteeringInput;
+	SteeringAngle = FMath::FInterpTo(SteeringAngle, TargetSteering, DeltaTime, Vehicle->SteeringSpeed);
+
+	FrontBrakeTorque = BrakeInput * MaxBrakeTorque * 0.5f;
+	RearBrakeTorque = FrontBrakeTorque + (HandbrakeInput ? HandbrakeTorque : 0.0f);
+
+	if (GearTable.Num() == 0)
+	{
+		EngineRPM = 0;
+		DriveTorque = FrontAxleTorque = RearAxleTorque = 0;
+		return;
+	}
+
+	if (IsShifting && Vehicle->GetLocalWorldTime() >= ShiftEndTime)
+	{
+		IsShifting = false;
+	}
+	if (AutomaticGears && !IsShifting)
+	{
+		SelectGear();
+	}
+
+	const FVehicleGearTableEntry& Gear = GearTable[CurrentGear];
+	const float Percent = Gear.GetPercent(Speed);
+	EngineRPM = Gear.LowRPM + Gear.RPMRange * Percent;
+
+	//Reverse uses the first gear's torque
+	const float Torque = (ThrottleInput < 0) ? GearTable[0].MaxTorque + GearTable[0].TorqueRange * GearTable[0].GetPercent(Speed) : Gear.MaxTorque + Gear.TorqueRange * Percent;
+	DriveTorque = IsShifting ? 0.0f : Torque * ThrottleInput;
+	FrontAxleTorque = DriveTorque * FrontTorqueSplit;
+	RearAxleTorque = DriveTorque - FrontAxleTorque;
+}
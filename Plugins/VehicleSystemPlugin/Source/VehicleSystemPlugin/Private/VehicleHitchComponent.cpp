@@ -0,0 +1,80 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleHitchComponent.h"
+#include "Components/PrimitiveComponent.h"
+
+void UVehicleHitchComponent::AttachTrailer(UPrimitiveComponent* TrailerComponent)
+{
+	DetachTrailer();
+	Trailer = TrailerComponent;
+	NextHitch = FindNextHitch();
+}
+
+void UVehicleHitchComponent::DetachTrailer()
+{
+	if (Trailer)
+	{
+		SetTrailerDriven(false);
+	}
+	Trailer = nullptr;
+	NextHitch = nullptr;
+}
+
+UVehicleHitchComponent* UVehicleHitchComponent::FindNextHitch() const
+{
+	//Trailers can be components of the vehicle or actors of their own, either way their hitch is below them
+	TArray<USceneComponent*> Children;
+	Trailer->GetChildrenComponents(true, Children);
+	for (USceneComponent* Child : Children)
+	{
+		if (UVehicleHitchComponent* Hitch = Cast<UVehicleHitchComponent>(Child))
+		{
+			return Hitch != this ? Hitch : nullptr;
+		}
+	}
+	return nullptr;
+}
+
+void UVehicleHitchComponent::SetTrailerDriven(bool Driven)
+{
+	if (TrailerDriven != Driven)
+	{
+		TrailerDriven = Driven;
+		Trailer->SetSimulatePhysics(!Driven);
+	}
+}
+
+void UVehicleHitchComponent::GetTrailers(TArray<UPrimitiveComponent*>& OutTrailers) const
+{
+	for (const UVehicleHitchComponent* Hitch = this; Hitch && Hitch->Trailer; Hitch = Hitch->NextHitch)
+	{
+		OutTrailers.Add(Hitch->Trailer);
+	}
+}
+
+void UVehicleHitchComponent::GetHitchAngles(FNetState& State)
+{
+	State.numHitches = 0;
+	for (UVehicleHitchComponent* Hitch = this; Hitch && Hitch->Trailer && State.numHitches < VEHICLE_NET_MAX_HITCHES; Hitch = Hitch->NextHitch)
+	{
+		Hitch->SetTrailerDriven(false); //We simulate now, ownership changed
+		const FRotator Relative = (Hitch->GetComponentQuat().Inverse() * Hitch->Trailer->GetComponentQuat()).Rotator();
+		State.hitchYaw[State.numHitches] = Relative.Yaw;
+		State.hitchPitch[State.numHitches] = Relative.Pitch;
+		State.numHitches++;
+	}
+}
+
+void UVehicleHitchComponent::ApplyHitchAngles(int32 NumHitches, const float* Yaw, const float* Pitch)
+{
+	//Each trailer hangs off the hitch before it, which has just been moved with its own trailer
+	UVehicleHitchComponent* Hitch = this;
+	for (int32 i = 0; i < NumHitches && Hitch && Hitch->Trailer; i++, Hitch = Hitch->NextHitch)
+	{
+		Hitch->SetTrailerDriven(true);
+		const FQuat Rotation = Hitch->GetComponentQuat() * FRotator(Pitch[i], Yaw[i], 0).Quaternion();
+		const FVector Coupling = Rotation.RotateVector(Hitch->TrailerHitchPoint * Hitch->Trailer->GetComponentScale());
+		Hitch->Trailer->SetWorldLocationAndRotation(Hitch->GetComponentLocation() - Coupling, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+}
@@ -0,0 +1,79 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleNetDelayEstimator.h"
+
+namespace VehicleNetDelay
+{
+	//Recalculating sorts the window, so only do it every few samples
+	static const int32 SamplesPerUpdate = 4;
+	//Extra delay added for every underrun, decays again while the underrun rate is below target
+	static const float UnderrunMarginStep = 0.005f;
+	static const float UnderrunMarginDecay = 0.95f;
+	//Fraction of the difference removed per update when the delay is shrinking
+	static const float DelayDecreaseRate = 0.1f;
+}
+
+void FVehicleNetDelayEstimator::Reset()
+{
+	FMemory::Memzero(Offsets);
+	NextSample = 0;
+	NumSamples = 0;
+	SamplesSinceUpdate = 0;
+	ClockOffset = 0.0f;
+	Delay = 0.0f;
+	UnderrunMargin = 0.0f;
+	UnderrunRate = 0.0f;
+}
+
+void FVehicleNetDelayEstimator::AddSample(float SenderTime, float LocalTime)
+{
+	Offsets[NextSample] = LocalTime - SenderTime;
+	NextSample = (NextSample + 1) % WindowSize;
+	NumSamples = FMath::Min(NumSamples + 1, WindowSize);
+	SamplesSinceUpdate++;
+
+	//Exponential average over roughly one window
+	UnderrunRate *= 1.0f - (1.0f / WindowSize);
+}
+
+void FVehicleNetDelayEstimator::AddUnderrun()
+{
+	UnderrunRate += 1.0f / WindowSize;
+	UnderrunMargin += VehicleNetDelay::UnderrunMarginStep;
+}
+
+void FVehicleNetDelayEstimator::UpdateDelay(float TargetUnderrunRate, float MinDelay, float MaxDelay)
+{
+	using namespace VehicleNetDelay;
+
+	if (NumSamples == 0 || (SamplesSinceUpdate < SamplesPerUpdate && NumSamples > SamplesPerUpdate))
+	{
+		return;
+	}
+	SamplesSinceUpdate = 0;
+
+	float Sorted[WindowSize];
+	FMemory::Memcpy(Sorted, Offsets, sizeof(float) * NumSamples);
+	Sort(Sorted, NumSamples);
+
+	//The fastest transit is our best guess at the clock offset, everything above it is jitter
+	ClockOffset = Sorted[0];
+	const int32 QuantileIndex = FMath::Clamp(FMath::FloorToInt((1.0f - TargetUnderrunRate) * (NumSamples - 1)), 0, NumSamples - 1);
+	const float Jitter = Sorted[QuantileIndex] - ClockOffset;
+
+	if (UnderrunRate <= TargetUnderrunRate)
+	{
+		UnderrunMargin *= UnderrunMarginDecay;
+	}
+
+	const float TargetDelay = FMath::Clamp(Jitter + UnderrunMargin, MinDelay, MaxDelay);
+	if (TargetDelay > Delay)
+	{
+		Delay = TargetDelay; //Grow right away, starving is worse than a small time skip
+	}
+	else
+	{
+		Delay = FMath::Lerp(Delay, TargetDelay, DelayDecreaseRate);
+	}
+}
@@ -0,0 +1,107 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleNetInterpolation.h"
+#include "Kismet/KismetMathLibrary.h"
+
+FVehicleNetPose::FVehicleNetPose(const FNetState& State)
+	: Rotation(State.rotation.Quaternion())
+	, Position(State.position)
+	, Velocity(State.velocity)
+	, AngularVelocity(State.angularVelocity)
+{
+}
+
+FVector FVehicleNetInterpolation::HermitePosition(const FVector& P0, const FVector& V0, const FVector& P1, const FVector& V1, float Duration, float Alpha)
+{
+	if (Duration <= KINDA_SMALL_NUMBER)
+	{
+		return P1;
+	}
+
+	const float T = Alpha;
+	const float T2 = T * T;
+	const float T3 = T2 * T;
+	const float H00 = 2.0f * T3 - 3.0f * T2 + 1.0f;
+	const float H10 = T3 - 2.0f * T2 + T;
+	const float H01 = -2.0f * T3 + 3.0f * T2;
+	const float H11 = T3 - T2;
+
+	//Tangents are velocities scaled to the length of the segment
+	return (H00 * P0) + (H10 * Duration * V0) + (H01 * P1) + (H11 * Duration * V1);
+}
+
+FQuat FVehicleNetInterpolation::IntegrateRotation(const FQuat& Rotation, const FVector& AngularVelocity, float DeltaTime)
+{
+	const float AngleDegrees = AngularVelocity.Size() * DeltaTime;
+	if (FMath::Abs(AngleDegrees) <= KINDA_SMALL_NUMBER)
+	{
+		return Rotation;
+	}
+
+	//Angular velocity is in world space, so the delta is applied on the left
+	const FQuat Delta(AngularVelocity.GetSafeNormal(), FMath::DegreesToRadians(AngleDegrees));
+	return (Delta * Rotation).GetNormalized();
+}
+
+FQuat FVehicleNetInterpolation::BlendRotation(const FQuat& Q0, const FVector& W0, const FQuat& Q1, const FVector& W1, float Duration, float Alpha)
+{
+	if (Duration <= KINDA_SMALL_NUMBER)
+	{
+		return Q1;
+	}
+
+	const FQuat FromStart = IntegrateRotation(Q0, W0, Alpha * Duration);
+	const FQuat FromEnd = IntegrateRotation(Q1, W1, (Alpha - 1.0f) * Duration);
+	const float Blend = FMath::SmoothStep(0.0f, 1.0f, Alpha);
+	return FQuat::Slerp(FromStart, FromEnd, Blend).GetNormalized();
+}
+
+void FVehicleNetInterpolation::Interpolate(ENetInterpolationMode Mode, const FVehicleNetPose& From, const FVehicleNetPose& To, float Duration, float Alpha, FVector& OutPosition, FRotator& OutRotation)
+{
+	if (Mode == ENetInterpolationMode::Hermite)
+	{
+		OutPosition = HermitePosition(From.Position, From.Velocity, To.Position, To.Velocity, Duration, Alpha);
+		OutRotation = BlendRotation(From.Rotation, From.AngularVelocity, To.Rotation, To.AngularVelocity, Duration, Alpha).Rotator();
+	}
+	else
+	{
+		//Same as a shortest path RLerp
+		OutPosition = UKismetMathLibrary::VLerp(From.Position, To.Position, Alpha);
+		OutRotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha).GetNormalized().Rotator();
+	}
+}
+
+void FVehicleNetInterpolation::Interpolate(ENetInterpolationMode Mode, const FNetState& From, const FNetState& To, float Duration, float Alpha, FVector& OutPosition, FRotator& OutRotation)
+{
+	Interpolate(Mode, FVehicleNetPose(From), FVehicleNetPose(To), Duration, Alpha, OutPosition, OutRotation);
+}
+
+void FVehicleNetInterpolation::Extrapolate(const FVehicleNetPose& Pose, float DeltaTime, FVector& OutPosition, FRotator& OutRotation)
+{
+	OutPosition = Pose.Position + Pose.Velocity * DeltaTime;
+	OutRotation = IntegrateRotation(Pose.Rotation, Pose.AngularVelocity, DeltaTime).Rotator();
+}
+
+void FVehicleNetInterpolation::InterpolateHitches(const FNetState& From, const FNetState& To, float Alpha, uint8& OutNumHitches, float* OutYaw, float* OutPitch)
+{
+	OutNumHitches = To.numHitches;
+	const bool SameChain = From.numHitches == To.numHitches;
+	for (int32 i = 0; i < OutNumHitches; i++)
+	{
+		OutYaw[i] = SameChain ? From.hitchYaw[i] + FMath::FindDeltaAngleDegrees(From.hitchYaw[i], To.hitchYaw[i]) * Alpha : To.hitchYaw[i];
+		OutPitch[i] = SameChain ? FMath::Lerp(From.hitchPitch[i], To.hitchPitch[i], Alpha) : To.hitchPitch[i];
+	}
+}
+
+void FVehicleNetInterpolationJob::Compute()
+{
+	if (Type == EType::Interpolate)
+	{
+		FVehicleNetInterpolation::Interpolate(Mode, From, To, Duration, Alpha, Position, Rotation);
+	}
+	else if (Type == EType::Extrapolate)
+	{
+		FVehicleNetInterpolation::Extrapolate(From, ExtrapolationTime, Position, Rotation);
+	}
+}
@@ -0,0 +1,401 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleNetRecorderSubsystem.h"
+#include "VehicleSystemBase.h"
+#include "VehicleSystemPlugin.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static UVehicleNetRecorderSubsystem* GetRecorder(UWorld* World)
+{
+	return World ? World->GetSubsystem<UVehicleNetRecorderSubsystem>() : nullptr;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs VehicleNetRecordCommand(
+	TEXT("VehicleNet.Record"),
+	TEXT("Records every vehicle movement state this machine receives. VehicleNet.Record [name]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UVehicleNetRecorderSubsystem* Recorder = GetRecorder(World))
+		{
+			Recorder->StartRecording(Args.Num() > 0 ? Args[0] : FString());
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld VehicleNetStopRecordingCommand(
+	TEXT("VehicleNet.StopRecording"),
+	TEXT("Stops recording vehicle movement states"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (UVehicleNetRecorderSubsystem* Recorder = GetRecorder(World))
+		{
+			Recorder->StopRecording();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs VehicleNetReplayCommand(
+	TEXT("VehicleNet.Replay"),
+	TEXT("Replays a vehicle movement recording through local replay proxies. VehicleNet.Replay <name> [speed]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		UVehicleNetRecorderSubsystem* Recorder = GetRecorder(World);
+		if (Recorder && Args.Num() > 0)
+		{
+			Recorder->StartReplay(Args[0], Args.Num() > 1 ? FCString::Atof(*Args[1]) : 1.0f);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld VehicleNetStopReplayCommand(
+	TEXT("VehicleNet.StopReplay"),
+	TEXT("Stops the running vehicle movement replay"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (UVehicleNetRecorderSubsystem* Recorder = GetRecorder(World))
+		{
+			Recorder->StopReplay();
+		}
+	}));
+
+bool UVehicleNetRecorderSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleNetRecorderSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bInitialized = true;
+
+	FString Name;
+	if (FParse::Value(FCommandLine::Get(), TEXT("VehicleNetRecord="), Name))
+	{
+		StartRecording(Name);
+	}
+}
+
+void UVehicleNetRecorderSubsystem::Deinitialize()
+{
+	StopRecording();
+	StopReplay();
+	bInitialized = false;
+	Super::Deinitialize();
+}
+
+bool UVehicleNetRecorderSubsystem::IsTickable() const
+{
+	return bInitialized && Replaying && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UVehicleNetRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleNetRecorderSubsystem, STATGROUP_Tickables);
+}
+
+FString UVehicleNetRecorderSubsystem::GetRecordingPath(const FString& Name)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("VehicleNetRecordings"), FPaths::SetExtension(Name, TEXT("vnrec")));
+}
+
+void UVehicleNetRecorderSubsystem::StartRecording(const FString& Name)
+{
+	StopRecording();
+
+	const FString FileName = Name.IsEmpty() ? FString::Printf(TEXT("VehicleNet-%s"), *FDateTime::Now().ToString()) : Name;
+	RecordingPath = GetRecordingPath(FileName);
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(RecordingPath), true);
+
+	RecordBuffer.Reset();
+	RecordedVehicleIds.Reset();
+	RecordingHeaderWritten = false;
+	Recording = true;
+
+	FMemoryWriter Writer(RecordBuffer);
+	uint32 Magic = FileMagic;
+	int32 Version = FileVersion;
+	Writer << Magic << Version;
+	UE_LOG(LogVehicleSystem, Log, TEXT("VehicleNet: recording to %s"), *RecordingPath);
+}
+
+void UVehicleNetRecorderSubsystem::StopRecording()
+{
+	if (!Recording)
+	{
+		return;
+	}
+	FlushRecording();
+	Recording = false;
+	RecordedVehicleIds.Reset();
+	UE_LOG(LogVehicleSystem, Log, TEXT("VehicleNet: recording saved to %s"), *RecordingPath);
+}
+
+void UVehicleNetRecorderSubsystem::FlushRecording()
+{
+	if (RecordBuffer.Num() == 0)
+	{
+		return;
+	}
+	const uint32 WriteFlags = RecordingHeaderWritten ? FILEWRITE_Append : FILEWRITE_None;
+	if (!FFileHelper::SaveArrayToFile(RecordBuffer, *RecordingPath, &IFileManager::Get(), WriteFlags))
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleNet: couldn't write to %s"), *RecordingPath);
+	}
+	RecordingHeaderWritten = true;
+	RecordBuffer.Reset();
+}
+
+uint32 UVehicleNetRecorderSubsystem::GetRecordedVehicleId(AVehicleSystemBase* Vehicle)
+{
+	if (const uint32* Existing = RecordedVehicleIds.Find(Vehicle->GetUniqueID()))
+	{
+		return *Existing;
+	}
+
+	//First state from this vehicle, write what the replay needs to spawn it
+	uint32 VehicleId = (uint32)RecordedVehicleIds.Num();
+	RecordedVehicleIds.Add(Vehicle->GetUniqueID(), VehicleId);
+
+	FMemoryWriter Writer(RecordBuffer);
+	Writer.Seek(RecordBuffer.Num());
+	uint8 Type = (uint8)ERecordType::Vehicle;
+	FString ClassPath = Vehicle->GetClass()->GetPathName();
+	Writer << Type;
+	Writer.SerializeIntPacked(VehicleId);
+	Writer << ClassPath;
+	return VehicleId;
+}
+
+void UVehicleNetRecorderSubsystem::WriteState(ERecordType Type, AVehicleSystemBase* Vehicle, const FNetState& State)
+{
+	uint32 VehicleId = GetRecordedVehicleId(Vehicle);
+	float LocalTime = Vehicle->GetLocalWorldTime();
+
+	//Same bits as on the wire
+	FBitWriter Bits(0, true);
+	bool bSuccess = true;
+	FNetState(State).NetSerialize(Bits, nullptr, bSuccess);
+	uint16 NumBits = (uint16)Bits.GetNumBits();
+
+	FMemoryWriter Writer(RecordBuffer);
+	Writer.Seek(RecordBuffer.Num());
+	uint8 TypeByte = (uint8)Type;
+	Writer << TypeByte;
+	Writer.SerializeIntPacked(VehicleId);
+	Writer << LocalTime << NumBits;
+	Writer.Serialize(Bits.GetData(), Bits.GetNumBytes());
+
+	if (RecordBuffer.Num() >= FlushSize)
+	{
+		FlushRecording();
+	}
+}
+
+void UVehicleNetRecorderSubsystem::RecordState(AVehicleSystemBase* Vehicle, const FNetState& State)
+{
+	if (Recording && Vehicle)
+	{
+		WriteState(ERecordType::State, Vehicle, State);
+	}
+}
+
+void UVehicleNetRecorderSubsystem::RecordRestState(AVehicleSystemBase* Vehicle, const FNetState& State)
+{
+	if (Recording && Vehicle)
+	{
+		WriteState(ERecordType::RestState, Vehicle, State);
+	}
+}
+
+bool UVehicleNetRecorderSubsystem::StartReplay(const FString& Name, float Speed)
+{
+	StopReplay();
+
+	const FString Path = FPaths::FileExists(Name) ? Name : GetRecordingPath(Name);
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path))
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleNet: couldn't read %s"), *Path);
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != FileMagic || Version != FileVersion)
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleNet: %s is not a vehicle recording or is from another version"), *Path);
+		return false;
+	}
+
+	TMap<uint32, FString> VehicleClasses;
+	TArray<uint8> StateBytes;
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		uint8 Type = 0;
+		uint32 VehicleId = 0;
+		Reader << Type;
+		Reader.SerializeIntPacked(VehicleId);
+
+		if (Type == (uint8)ERecordType::Vehicle)
+		{
+			FString ClassPath;
+			Reader << ClassPath;
+			VehicleClasses.Add(VehicleId, ClassPath);
+			continue;
+		}
+
+		FReplayRecord& Record = ReplayRecords.AddDefaulted_GetRef();
+		Record.Type = (ERecordType)Type;
+		Record.VehicleId = VehicleId;
+		uint16 NumBits = 0;
+		Reader << Record.LocalTime << NumBits;
+		StateBytes.SetNumUninitialized((NumBits + 7) >> 3);
+		Reader.Serialize(StateBytes.GetData(), StateBytes.Num());
+
+		FBitReader Bits(StateBytes.GetData(), NumBits);
+		bool bSuccess = true;
+		Record.State.NetSerialize(Bits, nullptr, bSuccess);
+	}
+
+	if (Reader.IsError() || ReplayRecords.Num() == 0)
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("VehicleNet: %s is empty or truncated"), *Path);
+		ReplayRecords.Reset();
+		return false;
+	}
+
+	ReplaySpeed = FMath::Max(0.01f, Speed);
+	ReplayTime = ReplayRecords[0].LocalTime;
+	NextReplayRecord = 0;
+	SpawnReplayVehicles(VehicleClasses);
+	Replaying = true;
+	UE_LOG(LogVehicleSystem, Log, TEXT("VehicleNet: replaying %d states of %d vehicles from %s"), ReplayRecords.Num(), ReplayVehicles.Num(), *Path);
+	return true;
+}
+
+void UVehicleNetRecorderSubsystem::SpawnReplayVehicles(const TMap<uint32, FString>& VehicleClasses)
+{
+	UWorld* World = GetWorld();
+	for (const TPair<uint32, FString>& VehicleClass : VehicleClasses)
+	{
+		UClass* Class = LoadClass<AVehicleSystemBase>(nullptr, *VehicleClass.Value);
+		if (!Class)
+		{
+			Class = AVehicleSystemBase::StaticClass();
+		}
+
+		//Start where the first state is so the proxy doesn't teleport in
+		FTransform SpawnTransform = FTransform::Identity;
+		for (const FReplayRecord& Record : ReplayRecords)
+		{
+			if (Record.VehicleId == VehicleClass.Key && !Record.State.IsDelta())
+			{
+				SpawnTransform = FTransform(Record.State.rotation, Record.State.position);
+				break;
+			}
+		}
+
+		AVehicleSystemBase* Vehicle = World->SpawnActorDeferred<AVehicleSystemBase>(Class, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (Vehicle)
+		{
+			Vehicle->SetReplicates(false);
+			Vehicle->IsReplayProxy = true;
+			Vehicle->ReplayTime = ReplayTime;
+			Vehicle->FinishSpawning(SpawnTransform);
+			ReplayVehicles.Add(VehicleClass.Key, Vehicle);
+		}
+	}
+}
+
+void UVehicleNetRecorderSubsystem::Tick(float DeltaTime)
+{
+	ReplayTime += DeltaTime * ReplaySpeed;
+
+	//Feed everything that had arrived by now, the proxies see the new clock on their next tick
+	while (NextReplayRecord < ReplayRecords.Num() && ReplayRecords[NextReplayRecord].LocalTime <= ReplayTime)
+	{
+		const FReplayRecord& Record = ReplayRecords[NextReplayRecord++];
+		AVehicleSystemBase* Vehicle = ReplayVehicles.FindRef(Record.VehicleId).Get();
+		if (!Vehicle)
+		{
+			continue;
+		}
+
+		Vehicle->ReplayTime = Record.LocalTime;
+		if (Record.Type == ERecordType::RestState)
+		{
+			Vehicle->RestState = Record.State;
+			Vehicle->OnRep_RestState();
+		}
+		else
+		{
+			Vehicle->ReceiveNetState(Record.State);
+		}
+	}
+
+	for (const TPair<uint32, TWeakObjectPtr<AVehicleSystemBase>>& ReplayVehicle : ReplayVehicles)
+	{
+		if (AVehicleSystemBase* Vehicle = ReplayVehicle.Value.Get())
+		{
+			Vehicle->ReplayTime = ReplayTime;
+		}
+	}
+
+	//Give the last states time to be reached before finishing
+	if (NextReplayRecord >= ReplayRecords.Num() && ReplayTime > ReplayRecords.Last().LocalTime + 2.0f)
+	{
+		StopReplay();
+	}
+}
+
+void UVehicleNetRecorderSubsystem::LogReplaySummary()
+{
+	FVehicleNetSyncStats Total;
+	for (const TPair<uint32, TWeakObjectPtr<AVehicleSystemBase>>& ReplayVehicle : ReplayVehicles)
+	{
+		if (AVehicleSystemBase* Vehicle = ReplayVehicle.Value.Get())
+		{
+			const FVehicleNetSyncStats& Stats = Vehicle->NetSyncStats;
+			Total.StatesReached += Stats.StatesReached;
+			Total.Underruns += Stats.Underruns;
+			Total.ErrorSum += Stats.ErrorSum;
+			Total.ErrorSquaredSum += Stats.ErrorSquaredSum;
+			Total.MaxError = FMath::Max(Total.MaxError, Stats.MaxError);
+		}
+	}
+
+	const int32 Reached = FMath::Max(1, Total.StatesReached);
+	UE_LOG(LogVehicleSystem, Log, TEXT("VehicleNet: replay reached %d states, %d underruns, error avg %.2f rms %.2f max %.2f"),
+		Total.StatesReached, Total.Underruns, Total.ErrorSum / Reached, FMath::Sqrt(Total.ErrorSquaredSum / Reached), Total.MaxError);
+}
+
+void UVehicleNetRecorderSubsystem::StopReplay()
+{
+	if (!Replaying)
+	{
+		return;
+	}
+	LogReplaySummary();
+	Replaying = false;
+
+	for (const TPair<uint32, TWeakObjectPtr<AVehicleSystemBase>>& ReplayVehicle : ReplayVehicles)
+	{
+		if (AVehicleSystemBase* Vehicle = ReplayVehicle.Value.Get())
+		{
+			Vehicle->Destroy();
+		}
+	}
+	ReplayVehicles.Reset();
+	ReplayRecords.Reset();
+}
@@ -0,0 +1,275 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleNetState.h"
+
+namespace VehicleNetSerialization
+{
+	//Bits used for each of the three smallest quaternion components
+	static const int32 QuatComponentBits = 10;
+
+	static void SerializeFlag(FArchive& Ar, bool& Flag)
+	{
+		uint8 Bit = Flag ? 1 : 0;
+		Ar.SerializeBits(&Bit, 1);
+		Flag = (Bit & 1) != 0;
+	}
+
+	static void SerializeUnsigned(FArchive& Ar, uint32& Value, int32 NumBits)
+	{
+		Ar.SerializeInt(Value, 1u << NumBits);
+	}
+
+	//Maps a value in [-Range, Range] onto NumBits, the sign is included in NumBits
+	static void SerializeQuantizedFloat(FArchive& Ar, float& Value, float Range, int32 NumBits)
+	{
+		const int32 MaxSteps = (1 << (NumBits - 1)) - 1;
+		uint32 Packed = 0;
+		if (Ar.IsSaving())
+		{
+			const float Normalized = FMath::Clamp(Value / Range, -1.0f, 1.0f);
+			Packed = (uint32)(FMath::RoundToInt(Normalized * MaxSteps) + MaxSteps);
+		}
+		Ar.SerializeInt(Packed, (uint32)(2 * MaxSteps + 1));
+		if (Ar.IsLoading())
+		{
+			Value = ((int32)Packed - MaxSteps) / (float)MaxSteps * Range;
+		}
+	}
+
+	static void SerializeQuantizedVector(FArchive& Ar, FVector& Vector, float Range, int32 NumBits)
+	{
+		SerializeQuantizedFloat(Ar, Vector.X, Range, NumBits);
+		SerializeQuantizedFloat(Ar, Vector.Y, Range, NumBits);
+		SerializeQuantizedFloat(Ar, Vector.Z, Range, NumBits);
+	}
+
+	//Smallest three: the largest component is dropped and rebuilt from the unit length
+	static void SerializePackedQuaternion(FArchive& Ar, FRotator& Rotation)
+	{
+		const float Range = 0.70710678f; //The three smallest components can never exceed 1/sqrt(2)
+		uint32 Largest = 0;
+		float Components[4];
+
+		if (Ar.IsSaving())
+		{
+			FQuat Quat = Rotation.Quaternion();
+			Quat.Normalize();
+			Components[0] = Quat.X;
+			Components[1] = Quat.Y;
+			Components[2] = Quat.Z;
+			Components[3] = Quat.W;
+
+			for (uint32 i = 1; i < 4; i++)
+			{
+				if (FMath::Abs(Components[i]) > FMath::Abs(Components[Largest]))
+				{
+					Largest = i;
+				}
+			}
+
+			//q and -q are the same rotation, so flip the quaternion to keep the dropped component positive
+			if (Components[Largest] < 0.0f)
+			{
+				for (int32 i = 0; i < 4; i++)
+				{
+					Components[i] = -Components[i];
+				}
+			}
+		}
+
+		SerializeUnsigned(Ar, Largest, 2);
+
+		float SumSquared = 0.0f;
+		for (uint32 i = 0; i < 4; i++)
+		{
+			if (i != Largest)
+			{
+				SerializeQuantizedFloat(Ar, Components[i], Range, QuatComponentBits);
+				SumSquared += Components[i] * Components[i];
+			}
+		}
+
+		if (Ar.IsLoading())
+		{
+			Components[Largest] = FMath::Sqrt(FMath::Max(0.0f, 1.0f - SumSquared));
+			Rotation = FQuat(Components[0], Components[1], Components[2], Components[3]).GetNormalized().Rotator();
+		}
+	}
+
+	//Velocity ranges are sent as power of two exponents so the receiver does not need our settings
+	static uint32 GetRangeExponent(float Range, int32 MinExponent)
+	{
+		const uint32 Exponent = FMath::CeilLogTwo(FMath::Max(1, FMath::CeilToInt(Range)));
+		return (uint32)FMath::Clamp((int32)Exponent - MinExponent, 0, 15);
+	}
+
+	static const int32 LinearRangeMinExponent = 8;
+	static const int32 AngularRangeMinExponent = 4;
+	static const int32 MinVelocityBits = 8;
+
+	static const int32 HitchYawBits = 11;
+	static const int32 HitchPitchBits = 9;
+	static const int32 InputBits = 8;
+
+	//Vehicles without trailers only pay for the count
+	static void SerializeHitches(FArchive& Ar, FNetState& State, bool Quantized)
+	{
+		uint32 NumHitches = FMath::Min((uint32)State.numHitches, (uint32)VEHICLE_NET_MAX_HITCHES);
+		SerializeUnsigned(Ar, NumHitches, 2);
+		State.numHitches = (uint8)FMath::Min(NumHitches, (uint32)VEHICLE_NET_MAX_HITCHES);
+		for (int32 i = 0; i < State.numHitches; i++)
+		{
+			if (Quantized)
+			{
+				SerializeQuantizedFloat(Ar, State.hitchYaw[i], 180.0f, HitchYawBits);
+				SerializeQuantizedFloat(Ar, State.hitchPitch[i], 90.0f, HitchPitchBits);
+			}
+			else
+			{
+				Ar << State.hitchYaw[i] << State.hitchPitch[i];
+			}
+		}
+	}
+}
+
+bool FNetState::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	using namespace VehicleNetSerialization;
+
+	SerializeFlag(Ar, quantization.Enabled);
+	Ar << timestamp;
+
+	if (!quantization.Enabled)
+	{
+		//Full precision layout, kept for comparison and debugging
+		Ar << position;
+		Ar << rotation.Pitch << rotation.Yaw << rotation.Roll;
+		Ar << velocity;
+		Ar << angularVelocity;
+		SerializeHitches(Ar, *this, false);
+		if (Ar.IsLoading())
+		{
+			keyframeId = 0;
+			isKeyframe = false;
+			keyframeBase = FVector::ZeroVector;
+		}
+		bOutSuccess = !Ar.IsError();
+		return true;
+	}
+
+	//Position
+	uint32 KeyframeBits = keyframeId;
+	SerializeUnsigned(Ar, KeyframeBits, 4);
+	keyframeId = (uint8)KeyframeBits;
+	if (keyframeId != 0)
+	{
+		SerializeFlag(Ar, isKeyframe);
+	}
+	else
+	{
+		isKeyframe = false;
+	}
+
+	if (IsDelta())
+	{
+		//Only the offset from the keyframe is sent, the receiver adds its copy of the keyframe back on
+		FVector Delta = position - keyframeBase;
+		SerializePackedVector<1, 24>(Delta, Ar);
+		if (Ar.IsLoading())
+		{
+			position = Delta;
+			keyframeBase = FVector::ZeroVector;
+		}
+	}
+	else
+	{
+		SerializePackedVector<1, 24>(position, Ar);
+	}
+
+	//Rotation
+	uint32 RotationFormat = (uint32)quantization.RotationFormat;
+	SerializeUnsigned(Ar, RotationFormat, 2);
+	quantization.RotationFormat = (ENetRotationFormat)RotationFormat;
+	switch (quantization.RotationFormat)
+	{
+	case ENetRotationFormat::Full:
+		Ar << rotation.Pitch << rotation.Yaw << rotation.Roll;
+		break;
+	case ENetRotationFormat::CompressedRotator:
+		rotation.SerializeCompressedShort(Ar);
+		break;
+	default:
+		SerializePackedQuaternion(Ar, rotation);
+		break;
+	}
+
+	//Velocities, resting vehicles only pay for a single bit
+	bool Moving = !velocity.IsZero() || !angularVelocity.IsZero();
+	SerializeFlag(Ar, Moving);
+	if (Moving)
+	{
+		uint32 VelocityBits = (uint32)FMath::Clamp(quantization.VelocityBits - MinVelocityBits, 0, 15);
+		uint32 LinearExponent = GetRangeExponent(quantization.MaxLinearVelocity, LinearRangeMinExponent);
+		uint32 AngularExponent = GetRangeExponent(quantization.MaxAngularVelocity, AngularRangeMinExponent);
+		SerializeUnsigned(Ar, VelocityBits, 4);
+		SerializeUnsigned(Ar, LinearExponent, 4);
+		SerializeUnsigned(Ar, AngularExponent, 4);
+
+		const int32 NumBits = (int32)VelocityBits + MinVelocityBits;
+		const float LinearRange = (float)(1 << (LinearExponent + LinearRangeMinExponent));
+		const float AngularRange = (float)(1 << (AngularExponent + AngularRangeMinExponent));
+		SerializeQuantizedVector(Ar, velocity, LinearRange, NumBits);
+		SerializeQuantizedVector(Ar, angularVelocity, AngularRange, NumBits);
+
+		if (Ar.IsLoading())
+		{
+			quantization.VelocityBits = NumBits;
+			quantization.MaxLinearVelocity = LinearRange;
+			quantization.MaxAngularVelocity = AngularRange;
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		velocity = FVector::ZeroVector;
+		angularVelocity = FVector::ZeroVector;
+	}
+
+	SerializeHitches(Ar, *this, true);
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FVehicleInputBundle::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	using namespace VehicleNetSerialization;
+
+	//Only the newest frame number is sent, the others count down from it
+	uint32 NumFrames = FMath::Min(Frames.Num(), VEHICLE_NET_MAX_INPUT_FRAMES);
+	SerializeUnsigned(Ar, NumFrames, 2);
+	NumFrames = FMath::Min(NumFrames, (uint32)VEHICLE_NET_MAX_INPUT_FRAMES);
+	if (Ar.IsLoading())
+	{
+		Frames.SetNum(NumFrames);
+	}
+
+	uint16 NewestFrame = NumFrames > 0 ? Frames[0].Frame : 0;
+	if (NumFrames > 0)
+	{
+		Ar << NewestFrame;
+	}
+
+	for (uint32 i = 0; i < NumFrames; i++)
+	{
+		FVehicleInputFrame& Input = Frames[i];
+		Input.Frame = NewestFrame - (uint16)i;
+		SerializeQuantizedFloat(Ar, Input.Throttle, 1.0f, InputBits);
+		SerializeQuantizedFloat(Ar, Input.Brake, 1.0f, InputBits);
+		SerializeQuantizedFloat(Ar, Input.Steering, 1.0f, InputBits);
+		SerializeFlag(Ar, Input.Handbrake);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -0,0 +1,141 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleRaycastWheelComponent.h"
+#include "Engine/World.h"
+#include "VehicleSystemBase.h"
+#include "VehicleSuspensionSubsystem.h"
+
+UVehicleRaycastWheelComponent::UVehicleRaycastWheelComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false; //Updated by the suspension subsystem
+}
+
+void UVehicleRaycastWheelComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	Vehicle = Cast<AVehicleSystemBase>(GetOwner());
+	if (UVehicleSuspensionSubsystem* Suspension = GetWorld()->GetSubsystem<UVehicleSuspensionSubsystem>())
+	{
+		Suspension->RegisterWheel(this);
+	}
+}
+
+void UVehicleRaycastWheelComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVehicleSuspensionSubsystem* Suspension = GetWorld()->GetSubsystem<UVehicleSuspensionSubsystem>())
+	{
+		Suspension->UnregisterWheel(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UVehicleRaycastWheelComponent::ShouldSimulate() const
+{
+	return Vehicle && !Vehicle->TickSuspended && Vehicle->VehicleMesh->IsSimulatingPhysics() && Vehicle->VehicleMesh->RigidBodyIsAwake();
+}
+
+void UVehicleRaycastWheelComponent::QueueTrace(UWorld* World)
+{
+	const FVector Start = GetComponentLocation();
+	const FVector Down = -GetUpVector();
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(VehicleSuspension), false, GetOwner());
+
+	if (SphereTrace)
+	{
+		TraceHandle = World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, Start + Down * SuspensionLength, FQuat::Identity, TraceChannel, FCollisionShape::MakeSphere(WheelRadius), Params);
+	}
+	else
+	{
+		TraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, Start + Down * (SuspensionLength + WheelRadius), TraceChannel, Params);
+	}
+}
+
+void UVehicleRaycastWheelComponent::ApplyTraceResult(UWorld* World, float DeltaTime)
+{
+	UVehicleDrivetrainComponent* Drivetrain = Vehicle->Drivetrain;
+	SteerAngle = Drivetrain ? Drivetrain->SteeringAngle * SteeringScale : 0.0f;
+
+	FTraceDatum TraceData;
+	const bool HasResult = TraceHandle.IsValid() && World->QueryTraceData(TraceHandle, TraceData) && TraceData.OutHits.Num() > 0 && TraceData.OutHits[0].bBlockingHit;
+	TraceHandle = FTraceHandle();
+	if (!HasResult)
+	{
+		IsGrounded = false;
+		Compression = LastCompression = 0;
+		SettledTime = 0;
+		UpdateVisuals(SuspensionLength);
+		return;
+	}
+
+	const FHitResult& Hit = TraceData.OutHits[0];
+	const float SpringLength = Hit.bStartPenetrating ? 0.0f : FMath::Clamp(SphereTrace ? Hit.Distance : Hit.Distance - WheelRadius, 0.0f, SuspensionLength);
+	Compression = 1.0f - SpringLength / SuspensionLength;
+	IsGrounded = true;
+	ContactPoint = Hit.ImpactPoint;
+	ContactNormal = Hit.ImpactNormal;
+
+	//Spring and damper along the suspension, they only push
+	const float CompressionSpeed = (Compression - LastCompression) * SuspensionLength / FMath::Max(DeltaTime, KINDA_SMALL_NUMBER);
+	LastCompression = Compression;
+	const float Load = FMath::Max(Compression * SuspensionLength * SpringStiffness + CompressionSpeed * SpringDamping, 0.0f);
+
+	//Tire forces in the ground plane
+	UPrimitiveComponent* Mesh = Vehicle->VehicleMesh;
+	const FQuat WheelRotation = GetComponentQuat() * FQuat(FVector::UpVector, FMath::DegreesToRadians(SteerAngle));
+	const FVector Forward = FVector::VectorPlaneProject(WheelRotation.GetForwardVector(), ContactNormal).GetSafeNormal();
+	const FVector Right = FVector::CrossProduct(ContactNormal, Forward);
+	const FVector ContactVelocity = Mesh->GetPhysicsLinearVelocityAtPoint(ContactPoint);
+	const float ForwardSpeed = FVector::DotProduct(ContactVelocity, Forward);
+	const float MaxTireForce = Load * Grip;
+
+	const float LateralForce = FMath::Clamp(-FVector::DotProduct(ContactVelocity, Right) * CorneringStiffness, -MaxTireForce, MaxTireForce);
+	float DriveForce = -ForwardSpeed * RollingResistance;
+	if (Drivetrain)
+	{
+		DriveForce += (FrontAxle ? Drivetrain->FrontAxleTorque : Drivetrain->RearAxleTorque) * TorqueShare / WheelRadius;
+
+		//Brakes only stop the wheel, they can't push it backwards
+		const float BrakeForce = (FrontAxle ? Drivetrain->FrontBrakeTorque : Drivetrain->RearBrakeTorque) * TorqueShare / WheelRadius;
+		DriveForce -= FMath::Clamp(ForwardSpeed * CorneringStiffness, -BrakeForce, BrakeForce);
+	}
+	DriveForce = FMath::Clamp(DriveForce, -MaxTireForce, MaxTireForce);
+
+	if (IsSettled(DeltaTime))
+	{
+		//Every wheel sees the same body, so they all stop on the same frame
+		Mesh->PutRigidBodyToSleep();
+	}
+	else
+	{
+		Mesh->AddForceAtLocation(GetUpVector() * Load + Right * LateralForce + Forward * DriveForce, ContactPoint);
+	}
+
+	SpinAngle = FMath::Fmod(SpinAngle + FMath::RadiansToDegrees(ForwardSpeed / WheelRadius) * DeltaTime, 360.0f);
+	UpdateVisuals(SpringLength);
+}
+
+bool UVehicleRaycastWheelComponent::IsSettled(float DeltaTime)
+{
+	const UPrimitiveComponent* Mesh = Vehicle->VehicleMesh;
+	const bool HasInput = Vehicle->Drivetrain && Vehicle->Drivetrain->HasInput();
+	if (HasInput || Mesh->GetPhysicsLinearVelocity().SizeSquared() > FMath::Square(RestSpeed) || Mesh->GetPhysicsAngularVelocityInDegrees().SizeSquared() > FMath::Square(RestAngularSpeed))
+	{
+		SettledTime = 0;
+		return false;
+	}
+	SettledTime += DeltaTime;
+	return SettledTime >= RestDelay;
+}
+
+void UVehicleRaycastWheelComponent::UpdateVisuals(float SpringLength)
+{
+	const FTransform WheelTransform(FRotator(-SpinAngle, SteerAngle, 0), FVector(0, 0, -SpringLength));
+	for (USceneComponent* Child : GetAttachChildren())
+	{
+		if (Child)
+		{
+			Child->SetRelativeTransform(WheelTransform);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleReplicationRelay.h"
+#include "VehicleSystemBase.h"
+#include "UObject/CoreNet.h"
+
+bool FVehicleNetBatch::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	if (!Map)
+	{
+		bOutSuccess = false;
+		return true;
+	}
+
+	uint32 NumEntries = (uint32)NumSendEntries;
+	Ar.SerializeIntPacked(NumEntries);
+
+	if (Ar.IsSaving())
+	{
+		for (int32 i = 0; i < NumSendEntries; i++)
+		{
+			UObject* Vehicle = SendEntries[i].Vehicle;
+			FNetState State = SendEntries[i].State;
+			bool bStateSuccess = true;
+			Map->SerializeObject(Ar, AVehicleSystemBase::StaticClass(), Vehicle);
+			State.NetSerialize(Ar, Map, bStateSuccess);
+		}
+	}
+	else
+	{
+		if (NumEntries > (uint32)AVehicleReplicationRelay::MaxStatesPerBatch)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return true;
+		}
+
+		ReceivedEntries.SetNum(NumEntries);
+		for (FVehicleNetBatchEntry& Entry : ReceivedEntries)
+		{
+			UObject* Vehicle = nullptr;
+			bool bStateSuccess = true;
+			Map->SerializeObject(Ar, AVehicleSystemBase::StaticClass(), Vehicle);
+			Entry.Vehicle = Cast<AVehicleSystemBase>(Vehicle); //Null if the vehicle is not relevant to us anymore
+			Entry.State.NetSerialize(Ar, Map, bStateSuccess);
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+AVehicleReplicationRelay::AVehicleReplicationRelay()
+{
+	bReplicates = true;
+	bOnlyRelevantToOwner = true;
+	bAlwaysRelevant = false;
+	bNetLoadOnClient = false;
+	NetUpdateFrequency = 1.0f; //Only used for RPCs
+	PrimaryActorTick.bCanEverTick = false;
+}
+
+bool AVehicleReplicationRelay::Client_ReceiveVehicleStates_Validate(const FVehicleNetBatch& Batch)
+{
+	return true;
+}
+void AVehicleReplicationRelay::Client_ReceiveVehicleStates_Implementation(const FVehicleNetBatch& Batch)
+{
+	for (const FVehicleNetBatchEntry& Entry : Batch.ReceivedEntries)
+	{
+		if (Entry.Vehicle)
+		{
+			Entry.Vehicle->ReceiveNetState(Entry.State);
+		}
+	}
+}
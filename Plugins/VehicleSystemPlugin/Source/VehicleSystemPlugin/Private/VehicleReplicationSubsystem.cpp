@@ -0,0 +1,287 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleReplicationSubsystem.h"
+#include "VehicleSystemBase.h"
+#include "Engine/World.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "VehicleSystemStats.h"
+
+bool UVehicleReplicationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleReplicationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void UVehicleReplicationSubsystem::Deinitialize()
+{
+	bInitialized = false;
+	SendSlots.Empty();
+	PendingStates.Empty();
+	Connections.Empty();
+	Super::Deinitialize();
+}
+
+bool UVehicleReplicationSubsystem::IsTickable() const
+{
+	return bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId UVehicleReplicationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVehicleReplicationSubsystem, STATGROUP_Tickables);
+}
+
+void UVehicleReplicationSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	TickSends(World->GetTimeSeconds());
+
+	//Tickables run after all actors, so every state received or sent this frame is queued by now
+	const ENetMode NetMode = World->GetNetMode();
+	if (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		UpdateRelays();
+		FlushRelays();
+	}
+	PendingStates.Reset();
+}
+
+void UVehicleReplicationSubsystem::SetVehicleSending(AVehicleSystemBase* Vehicle, bool Sending)
+{
+	if (!Vehicle)
+	{
+		return;
+	}
+
+	FVehicleSendSlot& Slot = SendSlots[GetOrAddSendSlot(Vehicle)];
+	if (Sending && !Slot.Sending)
+	{
+		//Same as a looping timer, the first send happens one interval from now
+		UWorld* World = GetWorld();
+		Slot.NextSendTime = (World ? World->GetTimeSeconds() : 0.0f) + Vehicle->NetSendRate;
+	}
+	Slot.Sending = Sending;
+}
+
+int32 UVehicleReplicationSubsystem::GetOrAddSendSlot(AVehicleSystemBase* Vehicle)
+{
+	if (!SendSlots.IsValidIndex(Vehicle->NetSendSlot) || SendSlots[Vehicle->NetSendSlot].Vehicle.Get() != Vehicle)
+	{
+		FVehicleSendSlot NewSlot;
+		NewSlot.Vehicle = Vehicle;
+		Vehicle->NetSendSlot = SendSlots.Add(NewSlot);
+		for (FConnectionScratch& Scratch : Connections)
+		{
+			Scratch.VehicleStates.AddDefaulted();
+		}
+	}
+	return Vehicle->NetSendSlot;
+}
+
+void UVehicleReplicationSubsystem::UnregisterVehicle(AVehicleSystemBase* Vehicle)
+{
+	if (!Vehicle || !SendSlots.IsValidIndex(Vehicle->NetSendSlot) || SendSlots[Vehicle->NetSendSlot].Vehicle.Get() != Vehicle)
+	{
+		return;
+	}
+
+	const int32 Slot = Vehicle->NetSendSlot;
+	SendSlots.RemoveAtSwap(Slot, 1, false);
+	for (FConnectionScratch& Scratch : Connections)
+	{
+		Scratch.VehicleStates.RemoveAtSwap(Slot, 1, false); //Same swap as SendSlots, so the moved vehicle keeps its relay state
+	}
+	if (SendSlots.IsValidIndex(Slot))
+	{
+		if (AVehicleSystemBase* Moved = SendSlots[Slot].Vehicle.Get())
+		{
+			Moved->NetSendSlot = Slot;
+		}
+	}
+	Vehicle->NetSendSlot = INDEX_NONE;
+}
+
+void UVehicleReplicationSubsystem::QueueStateForRelay(AVehicleSystemBase* Vehicle, const FNetState& State, const FNetState& ResolvedState)
+{
+	FPendingState& Pending = PendingStates.AddDefaulted_GetRef();
+	Pending.Vehicle = Vehicle;
+	Pending.OwnerConnection = Vehicle->GetNetConnection();
+	Pending.SendSlot = GetOrAddSendSlot(Vehicle);
+	Pending.State = State;
+	Pending.ResolvedState = ResolvedState;
+}
+
+void UVehicleReplicationSubsystem::TickSends(float Now)
+{
+	for (int32 i = 0; i < SendSlots.Num(); i++)
+	{
+		FVehicleSendSlot& Slot = SendSlots[i];
+		AVehicleSystemBase* Vehicle = Slot.Vehicle.Get();
+		if (!Vehicle || !Slot.Sending || Now < Slot.NextSendTime)
+		{
+			continue;
+		}
+
+		//Keep the cadence, but don't burst to catch up after a hitch
+		Slot.NextSendTime += Vehicle->NetSendRate;
+		if (Slot.NextSendTime < Now)
+		{
+			Slot.NextSendTime = Now + Vehicle->NetSendRate;
+		}
+		Vehicle->NetStateSend();
+	}
+}
+
+void UVehicleReplicationSubsystem::UpdateRelays()
+{
+	UWorld* World = GetWorld();
+
+	bool Changed = false;
+	for (int32 i = Connections.Num() - 1; i >= 0; --i)
+	{
+		if (!Connections[i].PlayerController.IsValid() || !Connections[i].Relay.IsValid())
+		{
+			if (AVehicleReplicationRelay* Relay = Connections[i].Relay.Get())
+			{
+				Relay->Destroy();
+			}
+			Connections.RemoveAtSwap(i);
+			Changed = true;
+		}
+	}
+
+	//Only look for new connections when the number of player controllers doesn't add up
+	if (!Changed && World->GetNumPlayerControllers() == Connections.Num())
+	{
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (!PlayerController || PlayerController->IsLocalController() || !PlayerController->GetNetConnection())
+		{
+			continue;
+		}
+
+		const bool Known = Connections.ContainsByPredicate([PlayerController](const FConnectionScratch& Scratch)
+		{
+			return Scratch.PlayerController.Get() == PlayerController;
+		});
+		if (Known)
+		{
+			continue;
+		}
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = PlayerController;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		AVehicleReplicationRelay* Relay = World->SpawnActor<AVehicleReplicationRelay>(SpawnParams);
+		if (Relay)
+		{
+			FConnectionScratch& Scratch = Connections.AddDefaulted_GetRef();
+			Scratch.PlayerController = PlayerController;
+			Scratch.Relay = Relay;
+			Scratch.VehicleStates.SetNum(SendSlots.Num());
+		}
+	}
+}
+
+void UVehicleReplicationSubsystem::FlushRelays()
+{
+	SCOPE_CYCLE_COUNTER(STAT_VehicleRelayFlush);
+	CSV_SCOPED_TIMING_STAT(VehicleSystem, FlushRelays);
+	if (PendingStates.Num() == 0)
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (FConnectionScratch& Scratch : Connections)
+	{
+		APlayerController* PlayerController = Scratch.PlayerController.Get();
+		AVehicleReplicationRelay* Relay = Scratch.Relay.Get();
+		UNetConnection* Connection = PlayerController ? PlayerController->GetNetConnection() : nullptr;
+		if (!Relay || !Connection)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		const FVector ViewDirection = ViewRotation.Vector();
+		const float ViewFOV = PlayerController->PlayerCameraManager ? PlayerController->PlayerCameraManager->GetFOVAngle() : 90.0f;
+		const AActor* ViewTarget = PlayerController->GetViewTarget();
+		const APawn* ViewPawn = PlayerController->GetPawn();
+		const AActor* RiddenActor = ViewPawn ? ViewPawn->GetAttachParentActor() : nullptr;
+
+		Scratch.Entries.Reset();
+		for (const FPendingState& Pending : PendingStates)
+		{
+			AVehicleSystemBase* Vehicle = Pending.Vehicle.Get();
+			if (!Vehicle || Pending.OwnerConnection == Connection)
+			{
+				continue; //Owners never need their own states
+			}
+			if (!Connection->FindActorChannelRef(TWeakObjectPtr<AActor>(Vehicle)))
+			{
+				continue; //The vehicle isn't relevant to this connection
+			}
+
+			//Vehicles the viewer is in or watching get every state, everything else follows the rate tiers
+			FVehicleRelayState& RelayState = Scratch.VehicleStates[Pending.SendSlot];
+			const bool ViewersOwn = (ViewTarget == Vehicle || RiddenActor == Vehicle);
+			if (!ViewersOwn)
+			{
+				const float Interval = Vehicle->GetNetSendIntervalFor(ViewLocation, ViewDirection, ViewFOV);
+				if (Now - RelayState.LastSentTime < Interval - KINDA_SMALL_NUMBER)
+				{
+					continue;
+				}
+			}
+
+			FVehicleNetBatchEntry& Entry = Scratch.Entries.AddDefaulted_GetRef();
+			Entry.Vehicle = Vehicle;
+			Entry.State = Pending.State;
+			RelayState.LastSentTime = Now;
+
+			if (Pending.State.isKeyframe)
+			{
+				RelayState.KeyframeId = Pending.State.keyframeId;
+				RelayState.KeyframeTimestamp = Pending.State.timestamp;
+			}
+			else if (Pending.State.IsDelta())
+			{
+				//Only send a delta if this connection was sent the keyframe it is relative to
+				const FNetKeyframe& Keyframe = Vehicle->NetKeyframes[Pending.State.keyframeId];
+				if (RelayState.KeyframeId != Pending.State.keyframeId || RelayState.KeyframeTimestamp != Keyframe.timestamp)
+				{
+					Entry.State = Pending.ResolvedState;
+				}
+			}
+		}
+
+		for (int32 First = 0; First < Scratch.Entries.Num(); First += AVehicleReplicationRelay::MaxStatesPerBatch)
+		{
+			FVehicleNetBatch Batch;
+			Batch.SendEntries = Scratch.Entries.GetData() + First;
+			Batch.NumSendEntries = FMath::Min(AVehicleReplicationRelay::MaxStatesPerBatch, Scratch.Entries.Num() - First);
+			Relay->Client_ReceiveVehicleStates(Batch);
+		}
+	}
+}
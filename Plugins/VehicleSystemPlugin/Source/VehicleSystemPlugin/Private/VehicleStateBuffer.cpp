@@ -0,0 +1,127 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleStateBuffer.h"
+
+void FVehicleStateBuffer::Init(int32 InCapacity)
+{
+	MaxCount = FMath::Max(1, InCapacity);
+
+	//Storage is a power of two so wrapping is a mask instead of a modulo
+	const int32 StorageSize = (int32)FMath::RoundUpToPowerOfTwo((uint32)MaxCount);
+	States.SetNum(StorageSize);
+	Mask = StorageSize - 1;
+	Reset();
+}
+
+bool FVehicleStateBuffer::Insert(const FNetState& State, float MinTimestamp)
+{
+	if (MaxCount == 0)
+	{
+		Init(1);
+	}
+
+	if (State.timestamp < MinTimestamp)
+	{
+		Stats.Late++;
+		return false;
+	}
+
+	if (IsFull())
+	{
+		//A front at or before MinTimestamp is the state being synced to, dropping it would make the vehicle jump
+		const int32 Oldest = (Count > 1 && Front().timestamp <= MinTimestamp) ? 1 : 0;
+		if (State.timestamp <= At(Oldest).timestamp)
+		{
+			Stats.Dropped++;
+			return false; //Older than everything we can drop, keep the newer states
+		}
+		if (Oldest == 1)
+		{
+			At(1) = At(0);
+		}
+		PopFront();
+		Stats.Dropped++;
+	}
+
+	//States almost always arrive in order, so search from the back
+	int32 InsertIndex = Count;
+	while (InsertIndex > 0 && At(InsertIndex - 1).timestamp > State.timestamp)
+	{
+		InsertIndex--;
+	}
+
+	if (InsertIndex > 0 && At(InsertIndex - 1).timestamp == State.timestamp)
+	{
+		Stats.Dropped++;
+		return false; //Duplicate
+	}
+
+	for (int32 i = Count; i > InsertIndex; --i)
+	{
+		At(i) = At(i - 1);
+	}
+	At(InsertIndex) = State;
+	Count++;
+
+	if (InsertIndex != Count - 1)
+	{
+		Stats.OutOfOrder++;
+	}
+	return true;
+}
+
+void FVehiclePredictionHistory::Init(int32 InCapacity)
+{
+	const int32 StorageSize = (int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(1, InCapacity));
+	States.SetNum(StorageSize);
+	Mask = StorageSize - 1;
+	Reset();
+}
+
+void FVehiclePredictionHistory::Add(const FVehiclePredictedState& State)
+{
+	if (States.Num() == 0)
+	{
+		Init(1);
+	}
+
+	if (Count == States.Num())
+	{
+		Head = (Head + 1) & Mask;
+		Count--;
+	}
+	At(Count) = State;
+	Count++;
+}
+
+bool FVehiclePredictionHistory::PopUntil(uint16 Frame, FVehiclePredictedState& OutState)
+{
+	for (int32 i = 0; i < Count; i++)
+	{
+		const FVehiclePredictedState& State = At(i);
+		if (State.Frame == Frame)
+		{
+			OutState = State;
+			Head = (Head + i + 1) & Mask;
+			Count -= i + 1;
+			return true;
+		}
+		if ((int16)(State.Frame - Frame) > 0)
+		{
+			break; //Already past it
+		}
+	}
+	return false;
+}
+
+void FVehiclePredictionHistory::ApplyCorrection(const FVector& PositionOffset, const FQuat& RotationOffset, const FVector& VelocityOffset)
+{
+	for (int32 i = 0; i < Count; i++)
+	{
+		FVehiclePredictedState& State = At(i);
+		State.Position += PositionOffset;
+		State.Rotation = RotationOffset * State.Rotation;
+		State.Velocity += VelocityOffset;
+	}
+}
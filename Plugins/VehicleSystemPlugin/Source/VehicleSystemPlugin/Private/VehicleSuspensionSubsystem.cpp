@@ -0,0 +1,98 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleSuspensionSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "VehicleRaycastWheelComponent.h"
+#include "VehicleSystemStats.h"
+
+void FVehicleSuspensionTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Subsystem->TickSuspension(DeltaTime);
+	}
+}
+
+FString FVehicleSuspensionTickFunction::DiagnosticMessage()
+{
+	return TEXT("UVehicleSuspensionSubsystem::TickSuspension");
+}
+
+bool UVehicleSuspensionSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleSuspensionSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	for (UVehicleRaycastWheelComponent* Wheel : Wheels)
+	{
+		Wheel->SuspensionSlot = INDEX_NONE;
+	}
+	Wheels.Empty();
+	Super::Deinitialize();
+}
+
+void UVehicleSuspensionSubsystem::RegisterWheel(UVehicleRaycastWheelComponent* Wheel)
+{
+	if (!Wheel || Wheel->SuspensionSlot != INDEX_NONE)
+	{
+		return;
+	}
+
+	//Registered with the first wheel, the persistent level doesn't exist yet when the subsystem is created
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.Subsystem = this;
+		TickFunction.bCanEverTick = true;
+		TickFunction.TickGroup = TG_PrePhysics;
+		TickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+		TickFunction.SetTickFunctionEnable(true);
+	}
+
+	Wheel->SuspensionSlot = Wheels.Add(Wheel);
+}
+
+void UVehicleSuspensionSubsystem::UnregisterWheel(UVehicleRaycastWheelComponent* Wheel)
+{
+	if (!Wheel || !Wheels.IsValidIndex(Wheel->SuspensionSlot) || Wheels[Wheel->SuspensionSlot] != Wheel)
+	{
+		return;
+	}
+
+	const int32 Slot = Wheel->SuspensionSlot;
+	Wheel->SuspensionSlot = INDEX_NONE;
+	Wheels.RemoveAtSwap(Slot, 1, false);
+	if (Wheels.IsValidIndex(Slot))
+	{
+		Wheels[Slot]->SuspensionSlot = Slot;
+	}
+}
+
+void UVehicleSuspensionSubsystem::TickSuspension(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VehicleSuspension);
+	UWorld* World = GetWorld();
+
+	//Nothing here calls into blueprints, so the array can't change while we go through it
+	int32 NumTraces = 0;
+	for (UVehicleRaycastWheelComponent* Wheel : Wheels)
+	{
+		if (Wheel->ShouldSimulate())
+		{
+			Wheel->ApplyTraceResult(World, DeltaTime);
+			Wheel->QueueTrace(World);
+			NumTraces++;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_VehicleSuspensionTraces, NumTraces);
+	CSV_CUSTOM_STAT(VehicleSystem, SuspensionTraces, NumTraces, ECsvCustomStatOp::Set);
+}
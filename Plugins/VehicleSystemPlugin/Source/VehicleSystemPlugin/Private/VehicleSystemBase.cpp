@@ -4,7 +4,16 @@
 #include "VehicleSystemBase.h"
 #include "TimerManager.h"
 #include "GameFramework/GameStateBase.h"
-#include "Kismet/KismetMathLibrary.h"
+#include "GameFramework/PlayerController.h"
+#include "Serialization/BitWriter.h"
+#include "VehicleNetInterpolation.h"
+#include "VehicleReplicationSubsystem.h"
+#include "VehicleNetRecorderSubsystem.h"
+#include "VehicleBenchmarkSubsystem.h"
+#include "VehicleTickSubsystem.h"
+#include "VehicleHitchComponent.h"
+#include "VehicleSystemStats.h"
+#include "VehicleSystemPlugin.h"
 
 AVehicleSystemBase::AVehicleSystemBase()
 {
@@ -12,6 +21,7 @@ AVehicleSystemBase::AVehicleSystemBase()
 	PrimaryActorTick.bCanEverTick = true;
 	VehicleMesh = CreateDefaultSubobject<UStaticMeshComponent>("VehicleMesh");
 	RootComponent = VehicleMesh;
+	VehicleMesh->BodyInstance.bGenerateWakeEvents = true; //Wakes resting vehicles
 
 	ReplicateMovement = true;
 	NetSendRate = 0.05f;
@@ -19,6 +29,13 @@ AVehicleSystemBase::AVehicleSystemBase()
 	NetLerpStart = 0.35f;
 	NetPositionTolerance = 0.1f;
 	NetSmoothing = 10.0f;
+
+	NetRateTiers.Add(FVehicleNetRateTier(5000.0f, 0.0f));
+	NetRateTiers.Add(FVehicleNetRateTier(15000.0f, 0.1f));
+	NetRateTiers.Add(FVehicleNetRateTier(50000.0f, 0.25f));
+	NetRateTiers.Add(FVehicleNetRateTier(100000.0f, 1.0f));
+
+	StateQueue.Init(NetStateBufferSize);
 }
 
 //Replicated Variables
@@ -31,12 +48,49 @@ void AVehicleSystemBase::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >
 void AVehicleSystemBase::BeginPlay()
 {
 	Super::BeginPlay();
+	if (StateQueue.Capacity() != NetStateBufferSize)
+	{
+		StateQueue.Init(NetStateBufferSize);
+	}
+	NextKinematicCheckTime = GetLocalWorldTime() + FMath::FRand() * NetKinematicCheckInterval; //Spread the checks over frames
+	InvalidateNetworkRole(); //The net mode is known now
+	BakeSteeringCurve();
+	Drivetrain = FindComponentByClass<UVehicleDrivetrainComponent>();
+	Hitch = FindVehicleHitch();
+	if (NetServerAuthoritative && !Drivetrain)
+	{
+		UE_LOG(LogVehicleSystem, Warning, TEXT("%s: NetServerAuthoritative needs a UVehicleDrivetrainComponent to send inputs, the driver stays authoritative"), *GetName());
+		NetServerAuthoritative = false;
+	}
+	PredictionHistory.Init(NetPredictionHistorySize);
+	SyncTrailerInBlueprint = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AVehicleSystemBase, SyncTrailerRotation));
 	SetReplicationTimer(ReplicateMovement);
+	VehicleMesh->OnComponentWake.AddDynamic(this, &AVehicleSystemBase::OnVehicleMeshWake);
+
+	if (UVehicleTickSubsystem* TickSubsystem = NetUseTickManager ? GetWorld()->GetSubsystem<UVehicleTickSubsystem>() : nullptr)
+	{
+		TickSubsystem->RegisterVehicle(this);
+	}
+}
+
+void AVehicleSystemBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVehicleReplicationSubsystem* ReplicationSubsystem = GetReplicationSubsystem())
+	{
+		ReplicationSubsystem->UnregisterVehicle(this);
+	}
+	if (UVehicleTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UVehicleTickSubsystem>())
+	{
+		TickSubsystem->UnregisterVehicle(this);
+	}
+	Super::EndPlay(EndPlayReason);
 }
 
 void AVehicleSystemBase::PossessedBy(AController* NewController)
 {
 	Super::PossessedBy(NewController);
+	InvalidateNetworkRole();
+	WakeFromRest(); //Dormant actors don't send multicasts
 	if(GetLocalRole() == ROLE_Authority)
 	{
 		Multicast_ChangedOwner();
@@ -47,6 +101,7 @@ void AVehicleSystemBase::PossessedBy(AController* NewController)
 void AVehicleSystemBase::UnPossessed()
 {
 	Super::UnPossessed();
+	InvalidateNetworkRole();
 	if(GetLocalRole() == ROLE_Authority)
 	{
 		Multicast_ChangedOwner();
@@ -54,24 +109,84 @@ void AVehicleSystemBase::UnPossessed()
 	ClearQueue();
 }
 
+void AVehicleSystemBase::OnRep_Controller()
+{
+	Super::OnRep_Controller();
+	InvalidateNetworkRole();
+}
+
 void AVehicleSystemBase::Tick(float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_VehicleTick);
 	Super::Tick(DeltaTime);
-	SyncTrailerRotation(DeltaTime);
+	if (TickSlot != INDEX_NONE || TickSuspended)
+	{
+		return; //The tick subsystem does the rest or we are resting, we only tick for blueprints
+	}
+
+	FVehicleNetInterpolationJob Job;
+	if (PrepareTick(DeltaTime, GetCachedNetworkRole(), Job))
+	{
+		Job.Compute();
+		ApplySyncPhysics(Job);
+	}
+}
+
+bool AVehicleSystemBase::PrepareTick(float DeltaTime, NetworkRoles CurrentRole, FVehicleNetInterpolationJob& Job)
+{
+	if (Hitch ? Hitch->HasTrailer() : SyncTrailerInBlueprint)
+	{
+		SyncTrailerRotation(DeltaTime);
+	}
 	TickDeltaTime = DeltaTime;
-	NetworkRoles CurrentRole = GetNetworkRole();
-	if (CurrentRole != NetworkRoles::Owner)
+	UpdateKinematicLOD(CurrentRole);
+	const bool ServerSimulating = IsServerSimulating();
+	if (ServerSimulating)
 	{
+		ConsumeInputFrames(DeltaTime);
+	}
+	else if (IsPredicting())
+	{
+		ApplyReconcileOffset(DeltaTime);
+	}
+	if (Drivetrain)
+	{
+		Drivetrain->UpdateDrivetrain(DeltaTime);
+	}
+	if (CurrentRole != NetworkRoles::Owner && !ServerSimulating)
+	{
+		INC_DWORD_STAT_BY(STAT_VehicleQueueDepth, StateQueue.Num());
+		CSV_CUSTOM_STAT(VehicleSystem, QueueDepth, StateQueue.Num(), ECsvCustomStatOp::Accumulate);
 		if (ReplicateMovement && ShouldSyncWithServer)
 		{
-			SyncPhysics();
+			return PrepareSyncPhysics(Job);
 		}
 	}
+	return false;
+}
+
+bool AVehicleSystemBase::NeedsBlueprintTick() const
+{
+	return GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AVehicleSystemBase, ReceiveTick));
 }
 
 void AVehicleSystemBase::SyncTrailerRotation_Implementation(float DeltaTime)
 {
-	//Used in blueprint
+	//Used in blueprint, remote trailers are placed from the hitch angles in ApplySyncPhysics
+}
+
+UVehicleHitchComponent* AVehicleSystemBase::FindVehicleHitch() const
+{
+	//Trailers that are components of the vehicle can have hitches too, ours is the one on the chassis
+	TInlineComponentArray<UVehicleHitchComponent*> Hitches(this);
+	for (UVehicleHitchComponent* VehicleHitch : Hitches)
+	{
+		if (VehicleHitch->GetAttachParent() == VehicleMesh)
+		{
+			return VehicleHitch;
+		}
+	}
+	return Hitches.Num() > 0 ? Hitches[0] : nullptr;
 }
 
 void AVehicleSystemBase::SetupPlayerInputComponent(UInputComponent *PlayerInputComponent)
@@ -81,44 +196,376 @@ void AVehicleSystemBase::SetupPlayerInputComponent(UInputComponent *PlayerInputC
 
 float AVehicleSystemBase::GetSteeringFromCurve(float Speed)
 {
+	if (SteeringTable.IsBaked())
+	{
+		return SteeringTable.Eval(Speed);
+	}
 	const FRichCurve *SCurve = SteeringCurve.GetRichCurveConst();
 	return SCurve->Eval(Speed);
 }
 
+void AVehicleSystemBase::BakeSteeringCurve()
+{
+	SteeringTable.Bake(*SteeringCurve.GetRichCurveConst(), SteeringTableSize);
+}
+
 void AVehicleSystemBase::SetShouldSyncWithServer(bool ShouldSync)
 {
 	ShouldSyncWithServer = ShouldSync;
 	SetReplicationTimer(ShouldSync);
 }
 
+UVehicleNetRecorderSubsystem* AVehicleSystemBase::GetActiveNetRecorder() const
+{
+	UWorld* World = GetWorld();
+	UVehicleNetRecorderSubsystem* Recorder = (World && !IsReplayProxy) ? World->GetSubsystem<UVehicleNetRecorderSubsystem>() : nullptr;
+	return (Recorder && Recorder->IsRecording()) ? Recorder : nullptr;
+}
+
+UVehicleBenchmarkSubsystem* AVehicleSystemBase::GetActiveBenchmark() const
+{
+	UWorld* World = GetWorld();
+	UVehicleBenchmarkSubsystem* Benchmark = (World && !IsReplayProxy) ? World->GetSubsystem<UVehicleBenchmarkSubsystem>() : nullptr;
+	return (Benchmark && Benchmark->IsRecording()) ? Benchmark : nullptr;
+}
+
+UVehicleReplicationSubsystem* AVehicleSystemBase::GetReplicationSubsystem() const
+{
+	UWorld* World = GetWorld();
+	return (World && NetUseReplicationBatcher) ? World->GetSubsystem<UVehicleReplicationSubsystem>() : nullptr;
+}
+
+float AVehicleSystemBase::GetNetSendIntervalFor(const FVector& ViewLocation, const FVector& ViewDirection, float ViewFOV) const
+{
+	if (NetRateTiers.Num() == 0)
+	{
+		return 0.0f;
+	}
+
+	const FVector ToVehicle = GetActorLocation() - ViewLocation;
+	const float Distance = ToVehicle.Size();
+	float Interval = NetRateTiers.Last().SendInterval;
+	for (const FVehicleNetRateTier& Tier : NetRateTiers)
+	{
+		if (Distance <= Tier.MaxDistance)
+		{
+			Interval = Tier.SendInterval;
+			break;
+		}
+	}
+
+	//Widen the view cone a little so vehicles don't slow down right at the edge of the screen
+	const float HalfAngle = FMath::DegreesToRadians(FMath::Min(ViewFOV * 0.5f + 15.0f, 180.0f));
+	if (Distance > KINDA_SMALL_NUMBER && FVector::DotProduct(ToVehicle / Distance, ViewDirection) < FMath::Cos(HalfAngle))
+	{
+		Interval *= NetOutOfViewRateScale;
+	}
+	return Interval;
+}
+
+void AVehicleSystemBase::UpdateKinematicLOD(NetworkRoles CurrentRole)
+{
+	const bool CanBeKinematic = NetKinematicLOD && ReplicateMovement && ShouldSyncWithServer && CurrentRole == NetworkRoles::Client;
+	if (!CanBeKinematic)
+	{
+		SetKinematicProxy(false); //Don't wait for the next check, we may be driving it now
+		return;
+	}
+
+	const float Now = GetLocalWorldTime();
+	if (Now < NextKinematicCheckTime)
+	{
+		return;
+	}
+	NextKinematicCheckTime = Now + NetKinematicCheckInterval;
+
+	const float Distance = GetDistanceToLocalView();
+	const bool Far = Distance > (IsKinematicProxy ? NetKinematicDistance : NetKinematicDistance + NetKinematicHysteresis);
+	const bool Settled = IsResting && (IsKinematicProxy || IsAtRestState());
+	SetKinematicProxy(Far || Settled);
+}
+
+void AVehicleSystemBase::SetKinematicProxy(bool Kinematic)
+{
+	if (Kinematic == IsKinematicProxy)
+	{
+		return;
+	}
+	IsKinematicProxy = Kinematic;
+
+	if (Kinematic)
+	{
+		//Trailers may be actors of their own, they go kinematic with us
+		TArray<AActor*, TInlineAllocator<4>> Actors;
+		Actors.Add(this);
+		if (Hitch)
+		{
+			TArray<UPrimitiveComponent*> Trailers;
+			Hitch->GetTrailers(Trailers);
+			for (UPrimitiveComponent* Trailer : Trailers)
+			{
+				Actors.AddUnique(Trailer->GetOwner());
+			}
+		}
+
+		//Constraints first so they don't pull on bodies that stop simulating
+		KinematicConstraints.Reset();
+		for (AActor* Actor : Actors)
+		{
+			TInlineComponentArray<UPhysicsConstraintComponent*> Constraints(Actor);
+			for (UPhysicsConstraintComponent* Constraint : Constraints)
+			{
+				if (!Constraint->IsBroken())
+				{
+					Constraint->TermComponentConstraint();
+					KinematicConstraints.Add(Constraint);
+				}
+			}
+		}
+
+		//Wheels and trailers ride along with the chassis until we simulate again
+		KinematicBodies.Reset();
+		for (AActor* Actor : Actors)
+		{
+			TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+			for (UPrimitiveComponent* Primitive : Primitives)
+			{
+				if (!Primitive->IsSimulatingPhysics())
+				{
+					continue;
+				}
+				FVehicleKinematicBody& Body = KinematicBodies.AddDefaulted_GetRef();
+				Body.Component = Primitive;
+				Body.AttachParent = Primitive->GetAttachParent();
+				Body.AttachSocket = Primitive->GetAttachSocketName();
+
+				Primitive->SetSimulatePhysics(false);
+				if (Primitive != VehicleMesh)
+				{
+					Primitive->AttachToComponent(VehicleMesh, FAttachmentTransformRules::KeepWorldTransform);
+				}
+			}
+		}
+	}
+	else
+	{
+		//Carry on with the velocities we were interpolating with, every body moves rigidly with the chassis
+		const bool HasVelocity = HasLastAppliedState && !IsResting;
+		const FVector LinearVelocity = HasVelocity ? LastAppliedState.velocity : FVector::ZeroVector;
+		const FVector AngularVelocity = HasVelocity ? LastAppliedState.angularVelocity : FVector::ZeroVector;
+		const FVector AngularVelocityRadians = FMath::DegreesToRadians(AngularVelocity);
+		const FVector ChassisLocation = VehicleMesh->GetComponentLocation();
+
+		for (const FVehicleKinematicBody& Body : KinematicBodies)
+		{
+			UPrimitiveComponent* Primitive = Body.Component.Get();
+			if (!Primitive)
+			{
+				continue;
+			}
+			if (Primitive != VehicleMesh)
+			{
+				if (USceneComponent* AttachParent = Body.AttachParent.Get())
+				{
+					Primitive->AttachToComponent(AttachParent, FAttachmentTransformRules::KeepWorldTransform, Body.AttachSocket);
+				}
+				else
+				{
+					Primitive->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+				}
+			}
+
+			Primitive->SetSimulatePhysics(true);
+			const FVector Offset = Primitive->GetComponentLocation() - ChassisLocation;
+			Primitive->SetPhysicsLinearVelocity(LinearVelocity + FVector::CrossProduct(AngularVelocityRadians, Offset));
+			Primitive->SetPhysicsAngularVelocityInDegrees(AngularVelocity);
+		}
+		KinematicBodies.Reset();
+
+		for (const TWeakObjectPtr<UPhysicsConstraintComponent>& Constraint : KinematicConstraints)
+		{
+			if (Constraint.IsValid())
+			{
+				Constraint->InitComponentConstraint();
+			}
+		}
+		KinematicConstraints.Reset();
+	}
+}
+
+float AVehicleSystemBase::GetDistanceToLocalView() const
+{
+	float Closest = BIG_NUMBER;
+	const FVector Location = GetActorLocation();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			Closest = FMath::Min(Closest, FVector::Dist(ViewLocation, Location));
+		}
+	}
+	return Closest;
+}
+
+bool AVehicleSystemBase::IsAtRestState() const
+{
+	return VehicleMesh->GetComponentLocation().Equals(RestState.position, NetPositionTolerance)
+		&& VehicleMesh->GetComponentRotation().Equals(RestState.rotation, NetPositionTolerance);
+}
+
 void AVehicleSystemBase::SetReplicationTimer(bool Enabled)
 {
 	if (ReplicateMovement && Enabled)
 	{
-		GetWorldTimerManager().SetTimer(NetSendTimer, this, &AVehicleSystemBase::NetStateSend, NetSendRate, true);
+		if (!RestSleeping) //Resumes when woken
+		{
+			SetNetSending(true);
+		}
 	}
 	else
 	{
-		GetWorldTimerManager().ClearTimer(NetSendTimer);
+		SetNetSending(false);
 		IsResting = false;
 		ClearQueue();
 	}
 }
 
+void AVehicleSystemBase::SetNetSending(bool Sending)
+{
+	UVehicleReplicationSubsystem* ReplicationSubsystem = GetReplicationSubsystem();
+	if (Sending)
+	{
+		if (ReplicationSubsystem)
+		{
+			ReplicationSubsystem->SetVehicleSending(this, true);
+		}
+		else
+		{
+			GetWorldTimerManager().SetTimer(NetSendTimer, this, &AVehicleSystemBase::NetStateSend, NetSendRate, true);
+		}
+	}
+	else
+	{
+		if (ReplicationSubsystem)
+		{
+			ReplicationSubsystem->SetVehicleSending(this, false);
+		}
+		GetWorldTimerManager().ClearTimer(NetSendTimer);
+	}
+}
+
+void AVehicleSystemBase::BeginRestSleep()
+{
+	if (RestSleeping)
+	{
+		return;
+	}
+	RestSleeping = true;
+	SetNetSending(false);
+	GetWorldTimerManager().SetTimer(RestCheckTimer, this, &AVehicleSystemBase::CheckRestSleep, NetRestCheckInterval, true);
+}
+
+void AVehicleSystemBase::CheckRestSleep()
+{
+	if (VehicleMesh->GetPhysicsLinearVelocity().Size() > 50)
+	{
+		WakeFromRest(); //Started moving again before it fell asleep
+		return;
+	}
+	if (VehicleMesh->IsSimulatingPhysics() && VehicleMesh->RigidBodyIsAwake())
+	{
+		return;
+	}
+
+	//Asleep, from here on only a wake event, possession or an owner change brings it back
+	GetWorldTimerManager().ClearTimer(RestCheckTimer);
+	SetNetDormancy(DORM_DormantAll);
+	SetTickSuspended(true);
+}
+
+void AVehicleSystemBase::WakeFromRest()
+{
+	GetWorldTimerManager().ClearTimer(RestCheckTimer);
+	SetTickSuspended(false);
+	if (RestSleeping)
+	{
+		RestSleeping = false;
+		if (GetLocalRole() == ROLE_Authority && NetDormancy == DORM_DormantAll)
+		{
+			SetNetDormancy(DORM_Awake);
+		}
+		if (ShouldSyncWithServer)
+		{
+			SetReplicationTimer(true);
+		}
+	}
+}
+
+void AVehicleSystemBase::SetTickSuspended(bool Suspend)
+{
+	if (Suspend == TickSuspended)
+	{
+		return;
+	}
+	TickSuspended = Suspend;
+
+	UVehicleTickSubsystem* TickSubsystem = NetUseTickManager ? GetWorld()->GetSubsystem<UVehicleTickSubsystem>() : nullptr;
+	if (Suspend)
+	{
+		if (TickSubsystem)
+		{
+			TickSubsystem->UnregisterVehicle(this);
+		}
+		//Blueprint ticks carry on at a low rate, everything native waits for a wake up
+		TickIntervalBeforeSuspend = GetActorTickInterval();
+		SetActorTickInterval(NetRestCheckInterval);
+		SetActorTickEnabled(NeedsBlueprintTick());
+	}
+	else
+	{
+		SetActorTickInterval(TickIntervalBeforeSuspend);
+		if (TickSubsystem)
+		{
+			TickSubsystem->RegisterVehicle(this);
+		}
+		else
+		{
+			SetActorTickEnabled(true);
+		}
+	}
+}
+
+void AVehicleSystemBase::OnVehicleMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	WakeFromRest();
+}
+
 void AVehicleSystemBase::NetStateSend()
 {
-	if (GetNetworkRole() == NetworkRoles::Owner)
+	SCOPE_CYCLE_COUNTER(STAT_VehicleNetStateSend);
+	if (IsPredicting())
+	{
+		SendInputFrame(); //The server sends the states
+		return;
+	}
+	if (GetCachedNetworkRole() == NetworkRoles::Owner || IsServerSimulating())
 	{
 		FNetState NewState = CreateNetStateForNow();
 
 		//Check if resting
 		if (NewState.velocity.Size() > 50) //Not resting
 		{
-			Server_ReceiveNetState(NewState);
+			PrepareNetStateForSend(NewState);
+			SendNetState(NewState);
+			RecordNetStateSent(NewState);
 			if(IsResting) //Is resting but should not be
 			{
 				FNetState BlankRestState;
-				Server_ReceiveRestState(BlankRestState);
+				SendRestState(BlankRestState);
 				if(GetLocalRole() == ROLE_Authority) {OnRep_RestState();} //RepNotify on Server
 			}
 		}
@@ -127,9 +574,17 @@ void AVehicleSystemBase::NetStateSend()
 			//Not resting but should be, or distance is too different
 			if(!IsResting || FVector::DistXY(RestState.position, NewState.position) > 50)
 			{
-				Server_ReceiveRestState(NewState);
+				NetStatesSinceKeyframe = 0; //Start with a keyframe once we move again
+				SendRestState(NewState);
+				RecordNetStateSent(NewState);
 				if(GetLocalRole() == ROLE_Authority) {OnRep_RestState();} //RepNotify on Server
 			}
+
+			//Nobody is driving it, so nothing will move it but physics
+			if(NetDormantWhenResting && IsResting && isServer() && !IsPlayerControlled())
+			{
+				BeginRestSleep();
+			}
 		}
 
 		if(StateQueue.Num() > 0)
@@ -148,16 +603,180 @@ FNetState AVehicleSystemBase::CreateNetStateForNow()
 	newState.velocity = VehicleMesh->GetPhysicsLinearVelocity();
 	newState.angularVelocity = VehicleMesh->GetPhysicsAngularVelocityInDegrees();
 	newState.timestamp = GetLocalWorldTime();
+	newState.quantization = NetQuantization;
+	if (Hitch && Hitch->HasTrailer())
+	{
+		Hitch->GetHitchAngles(newState);
+	}
 	return newState;
 }
 
-bool AVehicleSystemBase::Server_ReceiveNetState_Validate(FNetState State)
+void AVehicleSystemBase::PrepareNetStateForSend(FNetState& State)
+{
+	if (!State.quantization.Enabled || !State.quantization.DeltaPosition)
+	{
+		return; //Position is sent in world space
+	}
+
+	if (NetStatesSinceKeyframe == 0)
+	{
+		//Cycle through ids 1-15, 0 is reserved for absolute positions
+		NetKeyframeId = (NetKeyframeId % (VEHICLE_NET_KEYFRAME_SLOTS - 1)) + 1;
+		NetKeyframePosition = State.position;
+		State.isKeyframe = true;
+	}
+	State.keyframeId = NetKeyframeId;
+	State.keyframeBase = NetKeyframePosition;
+	NetStatesSinceKeyframe = (NetStatesSinceKeyframe + 1) % FMath::Max(1, State.quantization.KeyframeInterval);
+}
+
+bool AVehicleSystemBase::ResolveNetState(FNetState& State)
 {
+	if (State.keyframeId == 0 || State.keyframeId >= VEHICLE_NET_KEYFRAME_SLOTS)
+	{
+		return State.keyframeId == 0;
+	}
+
+	FNetKeyframe& Keyframe = NetKeyframes[State.keyframeId];
+	if (State.isKeyframe)
+	{
+		Keyframe.position = State.position;
+		Keyframe.timestamp = State.timestamp;
+		Keyframe.valid = true;
+	}
+	else
+	{
+		//Ids are reused, so a keyframe older than half the reuse period may belong to a different cycle
+		const float MaxKeyframeAge = (VEHICLE_NET_KEYFRAME_SLOTS - 1) * FMath::Max(1, NetQuantization.KeyframeInterval) * NetSendRate * 0.5f;
+		const float KeyframeAge = State.timestamp - Keyframe.timestamp;
+		if (!Keyframe.valid || KeyframeAge < 0.0f || KeyframeAge > MaxKeyframeAge)
+		{
+			return false; //The keyframe for this state was lost
+		}
+		State.position += Keyframe.position;
+	}
+
+	State.keyframeId = 0;
+	State.isKeyframe = false;
 	return true;
 }
+
+void AVehicleSystemBase::ResetNetKeyframes()
+{
+	for (FNetKeyframe& Keyframe : NetKeyframes)
+	{
+		Keyframe.valid = false;
+	}
+	NetStatesSinceKeyframe = 0;
+}
+
+void AVehicleSystemBase::RecordNetStateSent(const FNetState& State)
+{
+	//Serialize the state the same way the net driver does to get the exact cost, and once more unquantized to compare
+	FNetState Unquantized = State;
+	Unquantized.quantization.Enabled = false;
+	bool bSuccess = false;
+	FBitWriter Writer(512, true);
+	FNetState(State).NetSerialize(Writer, nullptr, bSuccess);
+	FBitWriter UnquantizedWriter(512, true);
+	Unquantized.NetSerialize(UnquantizedWriter, nullptr, bSuccess);
+	NetBitsThisWindow += Writer.GetNumBits();
+	VEHICLE_COUNTER_ADD(BytesSent, Writer.GetNumBytes());
+	NetBitsUnquantizedThisWindow += UnquantizedWriter.GetNumBits();
+
+	const float Now = GetLocalWorldTime();
+	const float WindowLength = Now - NetBandwidthWindowStart;
+	if (WindowLength >= 1.0f)
+	{
+		NetBytesPerSecond = NetBitsThisWindow / 8.0f / WindowLength;
+		NetBytesPerSecondUnquantized = NetBitsUnquantizedThisWindow / 8.0f / WindowLength;
+		NetBitsThisWindow = 0;
+		NetBitsUnquantizedThisWindow = 0;
+		NetBandwidthWindowStart = Now;
+	}
+}
+
+void AVehicleSystemBase::SendNetState(const FNetState& State)
+{
+	if (IsServerSimulating())
+	{
+		RelayNetState(State);
+	}
+	else
+	{
+		Server_ReceiveNetState(State);
+	}
+}
+
+void AVehicleSystemBase::SendRestState(const FNetState& State)
+{
+	if (IsServerSimulating())
+	{
+		RestState = State;
+	}
+	else
+	{
+		Server_ReceiveRestState(State);
+	}
+}
+
+bool AVehicleSystemBase::Server_ReceiveNetState_Validate(FNetState State)
+{
+	//Garbage from a broken or modified client
+	return !State.position.ContainsNaN() && !State.rotation.ContainsNaN() && !State.velocity.ContainsNaN() && !State.angularVelocity.ContainsNaN();
+}
 void AVehicleSystemBase::Server_ReceiveNetState_Implementation(FNetState State)
 {
-	Client_ReceiveNetState(State);
+	if (IsServerSimulating())
+	{
+		return; //We run this vehicle, its driver only sends inputs
+	}
+	RelayNetState(State);
+	if (GetCachedNetworkRole() == NetworkRoles::Server)
+	{
+		RecordNetStateSent(State);
+	}
+}
+
+void AVehicleSystemBase::RelayNetState(const FNetState& State)
+{
+	//Relay as received, every receiver resolves keyframe deltas against its own keyframes
+	if (UVehicleReplicationSubsystem* ReplicationSubsystem = GetReplicationSubsystem())
+	{
+		//Clients that skipped the keyframe get the resolved state instead, and if we lost it they can't have it either
+		if (UVehicleNetRecorderSubsystem* Recorder = GetActiveNetRecorder())
+		{
+			Recorder->RecordState(this, State);
+		}
+		FNetState ResolvedState = State;
+		if (!State.keyframeBase.IsZero())
+		{
+			//Made on this machine and never serialized, so the position is still absolute.
+			//Keyframes are still recorded, the relay compares against them to decide who can be sent deltas
+			if (State.isKeyframe && State.keyframeId < VEHICLE_NET_KEYFRAME_SLOTS)
+			{
+				FNetKeyframe& Keyframe = NetKeyframes[State.keyframeId];
+				Keyframe.position = State.position;
+				Keyframe.timestamp = State.timestamp;
+				Keyframe.valid = true;
+			}
+			ResolvedState.keyframeId = 0;
+			ResolvedState.isKeyframe = false;
+			ResolvedState.keyframeBase = FVector::ZeroVector;
+		}
+		if (ResolveNetState(ResolvedState))
+		{
+			ReplicationSubsystem->QueueStateForRelay(this, State, ResolvedState);
+			if (ShouldSyncWithServer)
+			{
+				AddStateToQueue(ResolvedState); //The multicast used to run on the server too
+			}
+		}
+	}
+	else
+	{
+		Client_ReceiveNetState(State);
+	}
 }
 
 bool AVehicleSystemBase::Client_ReceiveNetState_Validate(FNetState State)
@@ -166,18 +785,60 @@ bool AVehicleSystemBase::Client_ReceiveNetState_Validate(FNetState State)
 }
 void AVehicleSystemBase::Client_ReceiveNetState_Implementation(FNetState State)
 {
-	if(ShouldSyncWithServer)
+	ReceiveNetState(State);
+}
+
+void AVehicleSystemBase::ReceiveNetState(FNetState State)
+{
+	if (UVehicleNetRecorderSubsystem* Recorder = GetActiveNetRecorder())
+	{
+		Recorder->RecordState(this, State);
+	}
+	if (!ResolveNetState(State))
+	{
+		return;
+	}
+	if (UVehicleBenchmarkSubsystem* Benchmark = GetActiveBenchmark())
+	{
+		Benchmark->RecordOwnerState(this, State);
+	}
+	if (ShouldSyncWithServer)
 	{
 		AddStateToQueue(State);
 	}
 }
 
+void AVehicleSystemBase::OnRep_RestState()
+{
+	if (UVehicleNetRecorderSubsystem* Recorder = GetActiveNetRecorder())
+	{
+		if (GetCachedNetworkRole() != NetworkRoles::Owner)
+		{
+			Recorder->RecordRestState(this, RestState);
+		}
+	}
+	const bool WasResting = IsResting;
+	IsResting = (RestState.position != FVector::ZeroVector);
+	if (IsResting != WasResting)
+	{
+		VEHICLE_COUNTER_ADD(RestTransitions, 1);
+	}
+	if (!IsResting)
+	{
+		WakeFromRest();
+	}
+}
+
 bool AVehicleSystemBase::Server_ReceiveRestState_Validate(FNetState State)
 {
 	return true;
 }
 void AVehicleSystemBase::Server_ReceiveRestState_Implementation(FNetState State)
 {
+	if (IsServerSimulating())
+	{
+		return;
+	}
 	RestState = State; //Clients should still receive even when not actively syncing
 	if(GetLocalRole() == ROLE_Authority) {OnRep_RestState();} //RepNotify on Server
 }
@@ -188,95 +849,274 @@ bool AVehicleSystemBase::Multicast_ChangedOwner_Validate()
 }
 void AVehicleSystemBase::Multicast_ChangedOwner_Implementation()
 {
+	InvalidateNetworkRole();
+	WakeFromRest();
 	ClearQueue();
+	ResetNetKeyframes(); //The new owner starts its own keyframe sequence
+	NetDelayEstimator.Reset(); //and has its own clock
+	ResetServerAuthoritative();
 	OwnerChanged();
 }
 
+void AVehicleSystemBase::SendInputFrame()
+{
+	FVehicleInputFrame Input = Drivetrain->GetInputFrame();
+	Input.Frame = NextInputFrame++;
+
+	//Where we are as this frame's inputs start, the server answers with where it was at the same point.
+	//Corrections still being blended in count as done, or they would come back as error and be applied twice
+	FVehiclePredictedState Prediction;
+	Prediction.Frame = Input.Frame;
+	Prediction.Position = VehicleMesh->GetComponentLocation() + ReconcileOffset;
+	Prediction.Rotation = ReconcileRotation * VehicleMesh->GetComponentQuat();
+	Prediction.Velocity = VehicleMesh->GetPhysicsLinearVelocity();
+	PredictionHistory.Add(Prediction);
+
+	RecentInputs.Insert(Input, 0);
+	if (RecentInputs.Num() > NetInputRedundancy)
+	{
+		RecentInputs.SetNum(NetInputRedundancy);
+	}
+	FVehicleInputBundle Bundle;
+	Bundle.Frames = RecentInputs;
+	Server_ReceiveInput(Bundle);
+}
+
+bool AVehicleSystemBase::Server_ReceiveInput_Validate(FVehicleInputBundle Inputs)
+{
+	return Inputs.Frames.Num() <= VEHICLE_NET_MAX_INPUT_FRAMES;
+}
+void AVehicleSystemBase::Server_ReceiveInput_Implementation(FVehicleInputBundle Inputs)
+{
+	if (!IsServerSimulating())
+	{
+		return;
+	}
+
+	//Oldest first, frames we already have were resent in case we lost them
+	for (int32 i = Inputs.Frames.Num() - 1; i >= 0; i--)
+	{
+		const FVehicleInputFrame& Input = Inputs.Frames[i];
+		if (!HasQueuedInput || Input.IsNewerThan(LastQueuedInputFrame))
+		{
+			PendingInputs.Add(Input);
+			LastQueuedInputFrame = Input.Frame;
+			HasQueuedInput = true;
+		}
+	}
+
+	//Skip ahead rather than fall further behind the driver
+	if (PendingInputs.Num() > NetMaxBufferedInputs)
+	{
+		VEHICLE_COUNTER_ADD(DroppedStates, PendingInputs.Num() - NetMaxBufferedInputs);
+		PendingInputs.RemoveAt(0, PendingInputs.Num() - NetMaxBufferedInputs, false);
+	}
+}
+
+void AVehicleSystemBase::ConsumeInputFrames(float DeltaTime)
+{
+	//One frame per send interval, the same rate the driver samples them, and never more than one per step.
+	//Frames applied in the same step would all answer with the same state and only the last would drive
+	InputConsumeTime += DeltaTime;
+	if (InputConsumeTime >= NetSendRate && PendingInputs.Num() > 0)
+	{
+		InputConsumeTime = FMath::Min(InputConsumeTime - NetSendRate, NetSendRate);
+		const FVehicleInputFrame Input = PendingInputs[0];
+		PendingInputs.RemoveAt(0, 1, false);
+
+		Client_ReceiveServerState(CreateNetStateForNow(), Input.Frame);
+		Drivetrain->ApplyInputFrame(Input);
+	}
+
+	//Out of inputs, the last ones are held and the next one is used as soon as it arrives
+	if (PendingInputs.Num() == 0)
+	{
+		InputConsumeTime = FMath::Min(InputConsumeTime, NetSendRate);
+	}
+}
+
+void AVehicleSystemBase::Client_ReceiveServerState_Implementation(FNetState State, uint16 InputFrame)
+{
+	if (IsPredicting())
+	{
+		ReconcileWithServer(State, InputFrame);
+	}
+}
+
+void AVehicleSystemBase::ReconcileWithServer(const FNetState& State, uint16 InputFrame)
+{
+	FVehiclePredictedState Predicted;
+	if (!PredictionHistory.PopUntil(InputFrame, Predicted))
+	{
+		return; //Arrived after a newer one
+	}
+
+	const FVector PositionError = State.position - Predicted.Position;
+	const FQuat ServerRotation = State.rotation.Quaternion();
+	if (PositionError.Size() <= NetReconcileTolerance && FMath::RadiansToDegrees(ServerRotation.AngularDistance(Predicted.Rotation)) <= NetReconcileAngleTolerance)
+	{
+		return;
+	}
+	const FQuat RotationError = ServerRotation * Predicted.Rotation.Inverse();
+	const FVector VelocityError = State.velocity - Predicted.Velocity;
+
+	//Everything predicted since then had the same error
+	PredictionHistory.ApplyCorrection(PositionError, RotationError, VelocityError);
+	VehicleMesh->SetPhysicsLinearVelocity(VelocityError, true);
+
+	if (PositionError.Size() > NetReconcileSnapDistance)
+	{
+		ReconcileOffset = FVector::ZeroVector;
+		ReconcileRotation = FQuat::Identity;
+		TeleportVehicle(GetActorLocation() + PositionError, RotationError * GetActorQuat());
+		return;
+	}
+
+	//Blended in over the next frames by ApplyReconcileOffset
+	ReconcileOffset += PositionError;
+	ReconcileRotation = RotationError * ReconcileRotation;
+}
+
+void AVehicleSystemBase::ApplyReconcileOffset(float DeltaTime)
+{
+	if (ReconcileOffset.IsZero() && ReconcileRotation.Equals(FQuat::Identity))
+	{
+		return;
+	}
+
+	const float Alpha = FMath::Min(1.0f, DeltaTime * NetReconcileRate);
+	const FVector Step = ReconcileOffset * Alpha;
+	const FQuat RotationStep = FQuat::Slerp(FQuat::Identity, ReconcileRotation, Alpha);
+	ReconcileOffset -= Step;
+	ReconcileRotation = RotationStep.Inverse() * ReconcileRotation;
+	if (ReconcileOffset.SizeSquared() < 0.01f && ReconcileRotation.Equals(FQuat::Identity, 0.0001f))
+	{
+		ReconcileOffset = FVector::ZeroVector;
+		ReconcileRotation = FQuat::Identity;
+	}
+
+	//Velocity is kept, it was corrected when the server's state arrived
+	SetActorLocationAndRotation(GetActorLocation() + Step, RotationStep * GetActorQuat(), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void AVehicleSystemBase::ResetServerAuthoritative()
+{
+	PredictionHistory.Reset();
+	RecentInputs.Reset();
+	ReconcileOffset = FVector::ZeroVector;
+	ReconcileRotation = FQuat::Identity;
+	PendingInputs.Reset();
+	HasQueuedInput = false;
+	InputConsumeTime = 0;
+}
+
 void AVehicleSystemBase::AddStateToQueue(FNetState StateToAdd)
 {
-	if (GetNetworkRole() != NetworkRoles::Owner)
+	SCOPE_CYCLE_COUNTER(STAT_VehicleAddStateToQueue);
+	if (GetCachedNetworkRole() != NetworkRoles::Owner && !IsServerSimulating())
 	{
-		//If we have 10 or more states we are flooded and should drop new states
-		if (StateQueue.Num() < 10)
+		const float Now = GetLocalWorldTime();
+		if (NetAdaptiveDelay)
 		{
-			StateToAdd.timestamp += NetTimeBehind; //Change the timestamp to the future so we can lerp
+			NetDelayEstimator.AddSample(StateToAdd.timestamp, Now);
+			NetDelayEstimator.UpdateDelay(NetTargetUnderrunRate, NetMinDelay, NetMaxDelay);
 
-			if(StateToAdd.timestamp < LastActiveTimestamp)
+			//Play states back at a measured offset from the owner's clock
+			StateToAdd.localtimestamp = NetDelayEstimator.GetPlayoutTime(StateToAdd.timestamp);
+			StateToAdd.timestamp += NetTimeBehind; //Keep timestamps comparable with LastActiveTimestamp
+			QueueLocalTimeOffset = StateToAdd.localtimestamp - StateToAdd.timestamp;
+			if (StateToAdd.localtimestamp < Now)
 			{
-				return; //This state is late and should be discarded
+				NetDelayEstimator.AddUnderrun(); //Arrived after it should have been reached
 			}
+		}
+		else
+		{
+			StateToAdd.timestamp += NetTimeBehind; //Change the timestamp to the future so we can lerp
 
-			if (StateQueue.IsValidIndex(0))
+			if (StateQueue.IsEmpty())
 			{
-				int8 lastindex = StateQueue.Num() - 1;
-				for (int8 i = lastindex; i >= 0; --i)
-				{
-					if (StateQueue.IsValidIndex(i))
-					{
-						if (StateQueue[i].timestamp < StateToAdd.timestamp)
-						{
-							StateQueue.Insert(StateToAdd, i + 1);
-							CalculateTimestamps();
-							StateToAdd.localtimestamp = StateQueue[i+1].timestamp;
-							break;
-						}
-					}
-				}
+				//The first state is our point of reference, later states keep the owner's spacing from it
+				StateToAdd.localtimestamp = Now + NetTimeBehind;
+				QueueLocalTimeOffset = StateToAdd.localtimestamp - StateToAdd.timestamp;
 			}
 			else
 			{
-				StateToAdd.localtimestamp = GetLocalWorldTime() + NetTimeBehind;
-				StateQueue.Insert(StateToAdd, 0); //If the queue is empty just add it in the first spot
+				StateToAdd.localtimestamp = StateToAdd.timestamp + QueueLocalTimeOffset;
+			}
+		}
+
+		const FVehicleStateBufferStats StatsBefore = StateQueue.Stats;
+		const float TargetTimestamp = StateQueue.IsEmpty() ? -1.0f : StateQueue.Front().timestamp;
+		if (StateQueue.Insert(StateToAdd, LastActiveTimestamp)) //Late states are discarded
+		{
+			QueueStarved = false;
+			if (!CreateNewStartState && TargetTimestamp == LastActiveTimestamp && StateQueue.Front().timestamp != TargetTimestamp)
+			{
+				CreateNewStartState = true; //A one state buffer had to drop the state we were lerping to, start again from here
 			}
 		}
+		else if (NetAdaptiveDelay && StateToAdd.timestamp < LastActiveTimestamp)
+		{
+			NetDelayEstimator.AddUnderrun();
+		}
+		VEHICLE_COUNTER_ADD(DroppedStates, StateQueue.Stats.Dropped - StatsBefore.Dropped);
+		VEHICLE_COUNTER_ADD(LateStates, StateQueue.Stats.Late - StatsBefore.Late);
 	}
 }
 
 void AVehicleSystemBase::ClearQueue()
 {
-	StateQueue.Empty();
+	StateQueue.Reset();
 	CreateNewStartState = true;
 	LastActiveTimestamp = 0;
+	HasLastAppliedState = false;
 }
 
-void AVehicleSystemBase::CalculateTimestamps()
+void AVehicleSystemBase::SyncPhysics()
 {
-	int8 lastindex = StateQueue.Num() - 1;
-	for (int8 i = 0; i <= lastindex; i++)
+	FVehicleNetInterpolationJob Job;
+	if (PrepareSyncPhysics(Job))
 	{
-		//The first state is always our point of reference and should not change
-		//Especially since it could be actively syncing
-		if(i != 0)
-		{
-			if (StateQueue.IsValidIndex(i))
-			{
-				//Calculate the time difference in the owners times and apply it to our local times
-				float timeDifference = StateQueue[i].timestamp - StateQueue[i-1].timestamp;
-				StateQueue[i].localtimestamp = StateQueue[i-1].localtimestamp + timeDifference;
-			}
-		}
+		Job.Compute();
+		ApplySyncPhysics(Job);
 	}
 }
 
-void AVehicleSystemBase::SyncPhysics()
+bool AVehicleSystemBase::PrepareSyncPhysics(FVehicleNetInterpolationJob& Job)
 {
+	SCOPE_CYCLE_COUNTER(STAT_VehicleSyncPhysics);
+	Job.Type = FVehicleNetInterpolationJob::EType::None;
+	Job.ApplyExact = false;
+
 	if(IsResting)
 	{
-		SetVehicleLocation(RestState.position, RestState.rotation);
+		//Nothing to do once we are at the rest state, stop ticking until it changes or something hits us
+		if(IsAtRestState() && (IsKinematicProxy || NetDormantWhenResting))
+		{
+			if(NetDormantWhenResting)
+			{
+				SetTickSuspended(true);
+			}
+		}
+		else
+		{
+			SetVehicleLocation(RestState.position, RestState.rotation);
+		}
 		if(StateQueue.Num() > 0)
 		{
 			ClearQueue(); //Queue should be empty while resting
 		}
-		return;
+		return false;
 	}
 
-	if (StateQueue.IsValidIndex(0))
+	float ServerTime = GetLocalWorldTime();
+	if (!StateQueue.IsEmpty())
 	{
-		FNetState NextState = StateQueue[0];
-		float ServerTime = GetLocalWorldTime();
+		FNetState NextState = StateQueue.Front();
 
 		//use physics until we are close enough to this timestamp
-		if (ServerTime >= (NextState.localtimestamp - NetLerpStart))
+		if (ServerTime >= (NextState.localtimestamp - GetNetLerpStart()))
 		{
 			if (CreateNewStartState)
 			{
@@ -289,9 +1129,9 @@ void AVehicleSystemBase::SyncPhysics()
                     FMath::IsNearlyEqual(LerpStartState.position.Y, NextState.position.Y, NetPositionTolerance) &&
                     FMath::IsNearlyEqual(LerpStartState.position.Z, NextState.position.Z, NetPositionTolerance))
 				{
-					StateQueue.RemoveAt(0);
+					StateQueue.PopFront();
 					CreateNewStartState = true;
-					return;
+					return false;
 				}
 			}
 			
@@ -301,63 +1141,165 @@ void AVehicleSystemBase::SyncPhysics()
 			//Our start state may have been created after the lerp start time, so choose whatever is latest
 			float lerpBeginTime = LerpStartState.timestamp;
 			float lerpPercent = FMath::Clamp(GetPercentBetweenValues(ServerTime, lerpBeginTime, NextState.localtimestamp), 0.0f, 1.0f);
-			FVector NewPosition = UKismetMathLibrary::VLerp(LerpStartState.position, NextState.position, lerpPercent);
-			FRotator NewRotation = UKismetMathLibrary::RLerp(LerpStartState.rotation, NextState.rotation, lerpPercent, true);
-			SetVehicleLocation(NewPosition, NewRotation);
+			Job.Type = FVehicleNetInterpolationJob::EType::Interpolate;
+			Job.Mode = NetInterpolationMode;
+			Job.From = FVehicleNetPose(LerpStartState);
+			Job.To = FVehicleNetPose(NextState);
+			Job.Duration = NextState.localtimestamp - lerpBeginTime;
+			Job.Alpha = lerpPercent;
+			FVehicleNetInterpolation::InterpolateHitches(LerpStartState, NextState, lerpPercent, Job.NumHitches, Job.HitchYaw, Job.HitchPitch);
 
 			if(lerpPercent >= 0.99f || lerpBeginTime > NextState.localtimestamp)
 			{
-				ApplyExactNetState(NextState);
-				StateQueue.RemoveAt(0);
+				Job.ApplyExact = true;
+				StateQueue.PopFront();
 				CreateNewStartState = true;
+				LastAppliedState = NextState;
+				HasLastAppliedState = true;
+
+				if (StateQueue.IsEmpty() && !QueueStarved)
+				{
+					QueueStarved = true;
+					NetSyncStats.Underruns++;
+					if (NetAdaptiveDelay)
+					{
+						NetDelayEstimator.AddUnderrun(); //Nothing left to lerp to
+					}
+				}
 			}
+			return true;
+		}
+	}
+
+	//Nothing to lerp to yet, keep moving along the last state's velocities for a limited time
+	if (HasLastAppliedState && NetMaxExtrapolationTime > 0)
+	{
+		float ExtrapolationTime = ServerTime - LastAppliedState.localtimestamp;
+		if (ExtrapolationTime > 0 && ExtrapolationTime <= NetMaxExtrapolationTime)
+		{
+			Job.Type = FVehicleNetInterpolationJob::EType::Extrapolate;
+			Job.From = FVehicleNetPose(LastAppliedState);
+			Job.ExtrapolationTime = ExtrapolationTime;
+			FVehicleNetInterpolation::InterpolateHitches(LastAppliedState, LastAppliedState, 0.0f, Job.NumHitches, Job.HitchYaw, Job.HitchPitch);
+			return true;
 		}
 	}
+	return false;
+}
+
+void AVehicleSystemBase::ApplySyncPhysics(const FVehicleNetInterpolationJob& Job)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VehicleSyncPhysics);
+	SetVehicleLocation(Job.Position, Job.Rotation);
+	if (Hitch && Job.NumHitches > 0)
+	{
+		Hitch->ApplyHitchAngles(Job.NumHitches, Job.HitchYaw, Job.HitchPitch);
+	}
+	if (Job.ApplyExact)
+	{
+		const float Error = FVector::Dist(VehicleMesh->GetComponentLocation(), Job.To.Position);
+		NetSyncStats.StatesReached++;
+		NetSyncStats.ErrorSum += Error;
+		NetSyncStats.ErrorSquaredSum += Error * Error;
+		NetSyncStats.MaxError = FMath::Max(NetSyncStats.MaxError, Error);
+		ApplyExactNetState(LastAppliedState); //The state the job reached
+	}
 }
 
 void AVehicleSystemBase::LerpToNetState(FNetState NextState, float CurrentServerTime)
 {
 	//Our start state may have been created after the lerp start time, so choose whatever is latest
-	float lerpBeginTime = FMath::Max(LerpStartState.timestamp, (NextState.timestamp - NetLerpStart));
+	float lerpBeginTime = FMath::Max(LerpStartState.timestamp, (NextState.timestamp - GetNetLerpStart()));
 
 	float lerpPercent = FMath::Clamp(GetPercentBetweenValues(CurrentServerTime, lerpBeginTime, NextState.timestamp), 0.0f, 1.0f);
 
-	FVector NewPosition = UKismetMathLibrary::VLerp(LerpStartState.position, NextState.position, lerpPercent);
-	FRotator NewRotation = UKismetMathLibrary::RLerp(LerpStartState.rotation, NextState.rotation, lerpPercent, true);
+	FVector NewPosition;
+	FRotator NewRotation;
+	FVehicleNetInterpolation::Interpolate(NetInterpolationMode, LerpStartState, NextState, NextState.timestamp - lerpBeginTime, lerpPercent, NewPosition, NewRotation);
 	SetVehicleLocation(NewPosition, NewRotation);
 }
 
 void AVehicleSystemBase::ApplyExactNetState(FNetState State)
 {
 	SetVehicleLocation(State.position, State.rotation);
-	VehicleMesh->SetPhysicsLinearVelocity(State.velocity);
-	VehicleMesh->SetPhysicsAngularVelocityInDegrees(State.angularVelocity);
+	if (!IsKinematicProxy)
+	{
+		VehicleMesh->SetPhysicsLinearVelocity(State.velocity);
+		VehicleMesh->SetPhysicsAngularVelocityInDegrees(State.angularVelocity);
+	}
 }
 
 void AVehicleSystemBase::SetVehicleLocation(FVector NewPosition, FRotator NewRotation)
 {
-	//Move vehicle chassis
-	if(FVector::DistXY(VehicleMesh->GetComponentLocation(), NewPosition) < 3000)
+	SCOPE_CYCLE_COUNTER(STAT_VehicleSetVehicleLocation);
+	const FVector Position = VehicleMesh->GetComponentLocation();
+	const FQuat Rotation = VehicleMesh->GetComponentQuat();
+	const FQuat TargetRotation = NewRotation.Quaternion();
+	const float Error = FVector::Dist(Position, NewPosition);
+	if (Error > NetTeleportDistance)
 	{
-		FVector SmoothPos = UKismetMathLibrary::VInterpTo(VehicleMesh->GetComponentLocation(), NewPosition, TickDeltaTime, NetSmoothing);
-		FRotator SmoothRot = UKismetMathLibrary::RInterpTo(VehicleMesh->GetComponentRotation(), NewRotation, TickDeltaTime, NetSmoothing);
-		SetActorLocationAndRotation(SmoothPos, SmoothRot, false, nullptr, TeleportFlagToEnum(false));
+		TeleportVehicle(NewPosition, TargetRotation);
+		return;
 	}
-	else
+	if (Error <= NetPositionTolerance && Rotation.AngularDistance(TargetRotation) <= KINDA_SMALL_NUMBER)
+	{
+		return; //Already there, skip the move
+	}
+
+	//Close large errors faster so they don't trail behind after a hitch, small ones stay smooth
+	const float Alpha = (NetSmoothing > 0) ? FMath::Min(TickDeltaTime * NetSmoothing * (1.0f + Error / NetCorrectionErrorScale), 1.0f) : 1.0f;
+	VehicleMesh->SetWorldLocationAndRotation(FMath::Lerp(Position, NewPosition, Alpha), FQuat::Slerp(Rotation, TargetRotation, Alpha), false, nullptr, ETeleportType::None);
+}
+
+void AVehicleSystemBase::TeleportVehicle(const FVector& NewPosition, const FQuat& NewRotation)
+{
+	VEHICLE_COUNTER_ADD(Teleports, 1);
+	const FTransform OldTransform = VehicleMesh->GetComponentTransform();
+	const FTransform NewTransform(NewRotation, NewPosition, OldTransform.GetScale3D());
+	const FQuat DeltaRotation = NewRotation * OldTransform.GetRotation().Inverse();
+
+	//Overlaps and attached components are updated once, after everything has moved
+	FScopedMovementUpdate ScopedUpdate(VehicleMesh, EScopedUpdate::DeferredUpdates);
+	VehicleMesh->SetWorldLocationAndRotation(NewPosition, NewRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	if (IsKinematicProxy)
+	{
+		return; //Wheels are attached to the chassis and nothing has velocity
+	}
+	VehicleMesh->SetPhysicsLinearVelocity(DeltaRotation.RotateVector(VehicleMesh->GetPhysicsLinearVelocity()));
+	VehicleMesh->SetPhysicsAngularVelocityInRadians(DeltaRotation.RotateVector(VehicleMesh->GetPhysicsAngularVelocityInRadians()));
+
+	//Wheels and trailers simulate on their own, constraints would drag them after the chassis
+	TArray<AActor*, TInlineAllocator<4>> Actors;
+	Actors.Add(this);
+	if (Hitch)
 	{
-		//Calculate offset of new position
-		FTransform VehicleTransform = VehicleMesh->GetComponentToWorld();
-		FVector OffsetLocation = NewPosition - VehicleTransform.GetLocation();
-		FRotator OffsetRotation = NewRotation - VehicleTransform.Rotator();
-		OffsetRotation.Normalize();
-		FTransform Offset = FTransform(OffsetRotation, OffsetLocation, FVector::OneVector);
-		
-		//Teleport Vehicle chassis
-		SetActorLocationAndRotation(NewPosition, NewRotation, false, nullptr, TeleportFlagToEnum(true));
-		VehicleMesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
-		VehicleMesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
-
-		//Teleport vehicle wheels
-		TeleportWheels();
-	}
-}
\ No newline at end of file
+		TArray<UPrimitiveComponent*> Trailers;
+		Hitch->GetTrailers(Trailers);
+		for (UPrimitiveComponent* Trailer : Trailers)
+		{
+			Actors.AddUnique(Trailer->GetOwner());
+		}
+	}
+
+	for (AActor* Actor : Actors)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+		for (UPrimitiveComponent* Body : Components)
+		{
+			if (Body == VehicleMesh || !Body->IsSimulatingPhysics() || Body->IsWelded())
+			{
+				continue;
+			}
+
+			//Same place relative to the chassis, physics is moved directly to skip the component's own overlap update
+			const FTransform BodyTransform = Body->GetComponentTransform().GetRelativeTransform(OldTransform) * NewTransform;
+			Body->SetWorldLocationAndRotationNoPhysics(BodyTransform.GetLocation(), BodyTransform.Rotator());
+			if (FBodyInstance* BodyInstance = Body->GetBodyInstance())
+			{
+				BodyInstance->SetBodyTransform(BodyTransform, ETeleportType::TeleportPhysics);
+			}
+			Body->SetPhysicsLinearVelocity(DeltaRotation.RotateVector(Body->GetPhysicsLinearVelocity()));
+			Body->SetPhysicsAngularVelocityInRadians(DeltaRotation.RotateVector(Body->GetPhysicsAngularVelocityInRadians()));
+		}
+	}
+}
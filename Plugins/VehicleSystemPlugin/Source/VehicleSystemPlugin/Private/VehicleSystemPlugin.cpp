@@ -5,6 +5,8 @@
 
 #define LOCTEXT_NAMESPACE "FVehicleSystemPluginModule"
 
+DEFINE_LOG_CATEGORY(LogVehicleSystem);
+
 void FVehicleSystemPluginModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
@@ -0,0 +1,35 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleSystemStats.h"
+
+DEFINE_STAT(STAT_VehicleTick);
+DEFINE_STAT(STAT_VehicleSyncPhysics);
+DEFINE_STAT(STAT_VehicleAddStateToQueue);
+DEFINE_STAT(STAT_VehicleNetStateSend);
+DEFINE_STAT(STAT_VehicleSetVehicleLocation);
+DEFINE_STAT(STAT_VehicleTickSubsystem);
+DEFINE_STAT(STAT_VehicleTickSubsystemCompute);
+DEFINE_STAT(STAT_VehicleRelayFlush);
+DEFINE_STAT(STAT_VehicleDrivetrain);
+DEFINE_STAT(STAT_VehicleSuspension);
+DEFINE_STAT(STAT_VehicleConstraintFlush);
+
+DEFINE_STAT(STAT_VehicleQueueDepth);
+DEFINE_STAT(STAT_VehicleDroppedStates);
+DEFINE_STAT(STAT_VehicleLateStates);
+DEFINE_STAT(STAT_VehicleTeleports);
+DEFINE_STAT(STAT_VehicleRestTransitions);
+DEFINE_STAT(STAT_VehicleBytesSent);
+DEFINE_STAT(STAT_VehicleConstraintUpdates);
+DEFINE_STAT(STAT_VehicleTicked);
+DEFINE_STAT(STAT_VehicleSuspensionTraces);
+
+CSV_DEFINE_CATEGORY_MODULE(VEHICLESYSTEMPLUGIN_API, VehicleSystem, true);
+
+TRACE_DECLARE_INT_COUNTER(VehicleDroppedStates, TEXT("Vehicle/Dropped States"));
+TRACE_DECLARE_INT_COUNTER(VehicleLateStates, TEXT("Vehicle/Late States"));
+TRACE_DECLARE_INT_COUNTER(VehicleTeleports, TEXT("Vehicle/Teleports"));
+TRACE_DECLARE_INT_COUNTER(VehicleRestTransitions, TEXT("Vehicle/Rest Transitions"));
+TRACE_DECLARE_INT_COUNTER(VehicleBytesSent, TEXT("Vehicle/Bytes Sent"));
+TRACE_DECLARE_INT_COUNTER(VehicleConstraintUpdates, TEXT("Vehicle/Constraint Updates"));
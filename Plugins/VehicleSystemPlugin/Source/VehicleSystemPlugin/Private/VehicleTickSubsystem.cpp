@@ -0,0 +1,167 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#include "VehicleTickSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Async/ParallelFor.h"
+#include "VehicleSystemStats.h"
+
+void FVehicleTickSubsystemTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Subsystem->TickVehicles(DeltaTime);
+	}
+}
+
+FString FVehicleTickSubsystemTickFunction::DiagnosticMessage()
+{
+	return TEXT("UVehicleTickSubsystem::TickVehicles");
+}
+
+bool UVehicleTickSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void UVehicleTickSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	for (AVehicleSystemBase* Vehicle : Vehicles)
+	{
+		if (Vehicle)
+		{
+			Vehicle->TickSlot = INDEX_NONE;
+		}
+	}
+	Vehicles.Empty();
+	Jobs.Empty();
+	Super::Deinitialize();
+}
+
+void UVehicleTickSubsystem::RegisterVehicle(AVehicleSystemBase* Vehicle)
+{
+	if (!Vehicle || Vehicle->TickSlot != INDEX_NONE)
+	{
+		return;
+	}
+
+	//Registered with the first vehicle, the persistent level doesn't exist yet when the subsystem is created
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		UWorld* World = GetWorld();
+		TickFunction.Subsystem = this;
+		TickFunction.bCanEverTick = true;
+		TickFunction.TickGroup = TG_PrePhysics;
+		TickFunction.RegisterTickFunction(World->PersistentLevel);
+		TickFunction.SetTickFunctionEnable(true);
+	}
+
+	Vehicle->TickSlot = Vehicles.Add(Vehicle);
+	Jobs.AddDefaulted();
+	Vehicle->SetActorTickEnabled(Vehicle->NeedsBlueprintTick());
+}
+
+void UVehicleTickSubsystem::UnregisterVehicle(AVehicleSystemBase* Vehicle)
+{
+	if (!Vehicle || !Vehicles.IsValidIndex(Vehicle->TickSlot) || Vehicles[Vehicle->TickSlot] != Vehicle)
+	{
+		return;
+	}
+
+	const int32 Slot = Vehicle->TickSlot;
+	Vehicle->TickSlot = INDEX_NONE;
+	if (Ticking)
+	{
+		Vehicles[Slot] = nullptr;
+		NeedsCompact = true;
+		return;
+	}
+
+	Vehicles.RemoveAtSwap(Slot, 1, false);
+	Jobs.RemoveAtSwap(Slot, 1, false);
+	if (Vehicles.IsValidIndex(Slot) && Vehicles[Slot])
+	{
+		Vehicles[Slot]->TickSlot = Slot;
+	}
+}
+
+void UVehicleTickSubsystem::Compact()
+{
+	for (int32 i = Vehicles.Num() - 1; i >= 0; --i)
+	{
+		if (!Vehicles[i])
+		{
+			Vehicles.RemoveAtSwap(i, 1, false);
+			Jobs.RemoveAtSwap(i, 1, false);
+			if (Vehicles.IsValidIndex(i) && Vehicles[i])
+			{
+				Vehicles[i]->TickSlot = i;
+			}
+		}
+	}
+	NeedsCompact = false;
+}
+
+void UVehicleTickSubsystem::TickVehicles(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VehicleTickSubsystem);
+	CSV_SCOPED_TIMING_STAT(VehicleSystem, TickVehicles);
+	Ticking = true;
+
+	//Prepare, anything that touches the actor or blueprints stays on the game thread
+	const int32 NumVehicles = Vehicles.Num();
+	int32 NumJobs = 0;
+	for (int32 i = 0; i < NumVehicles; i++)
+	{
+		Jobs[i].Type = FVehicleNetInterpolationJob::EType::None;
+
+		AVehicleSystemBase* Vehicle = Vehicles[i];
+		if (!Vehicle || Vehicle->IsPendingKill())
+		{
+			continue;
+		}
+
+		//Blueprints may spawn vehicles from here, which can grow the arrays
+		FVehicleNetInterpolationJob Job;
+		if (Vehicle->PrepareTick(DeltaTime * Vehicle->CustomTimeDilation, Vehicle->GetCachedNetworkRole(), Job))
+		{
+			Jobs[i] = Job;
+			NumJobs++;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_VehicleTicked, NumVehicles);
+	CSV_CUSTOM_STAT(VehicleSystem, TickedVehicles, NumVehicles, ECsvCustomStatOp::Set);
+
+	//Compute, pure math on the jobs
+	if (NumJobs > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_VehicleTickSubsystemCompute);
+		ParallelFor(NumVehicles, [this](int32 Index)
+		{
+			Jobs[Index].Compute();
+		}, NumJobs < MinJobsForParallel);
+	}
+
+	//Apply
+	for (int32 i = 0; i < NumVehicles && NumJobs > 0; i++)
+	{
+		AVehicleSystemBase* Vehicle = Vehicles[i];
+		if (Vehicle && Jobs[i].Type != FVehicleNetInterpolationJob::EType::None)
+		{
+			Vehicle->ApplySyncPhysics(Jobs[i]);
+		}
+	}
+
+	Ticking = false;
+	if (NeedsCompact)
+	{
+		Compact();
+	}
+}
@@ -0,0 +1,141 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VehicleNetState.h"
+#include "VehicleBenchmarkSubsystem.generated.h"
+
+class AVehicleSystemBase;
+
+/**
+ * Replication soak benchmark, meant to run headless with -nullrhi.
+ * Server: -VehicleBenchmark=<vehicles> -VehicleBenchmarkClass=<class path> [-VehicleBenchmarkClients=<clients>] [-VehicleBenchmarkDuration=<seconds>]
+ * Clients: -VehicleBenchmark
+ * The server waits for the clients, spawns the vehicles and drives them with forces, every machine records for the duration
+ * and writes its own JSON report to Saved/Profiling/VehicleBenchmark. Lag and loss come from the usual PktLag, PktLoss and PktOrder
+ * settings, which are copied into the report. -VehicleBenchmarkExit quits once the report is written.
+ * Clients sample every proxy each frame at the server's time and compare it with the owner's pose at that time, taken
+ * from the owner's states once they arrive. Benchmark vehicles are owned by the server, so state timestamps are server time.
+ * The class must be a vehicle blueprint with a simulating mesh, AVehicleSystemBase on its own has nothing to drive.
+ * From the console: VehicleBenchmark.Start <vehicles> <class path> [seconds] and VehicleBenchmark.Stop
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleBenchmarkSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	/** Servers spawn NumVehicles of the class at ClassPath and drive them, clients only record and ignore ClassPath */
+	void StartBenchmark(int32 NumVehicles, float Duration, const FString& ClassPath);
+	/** Ends the run early and writes the report */
+	void StopBenchmark();
+
+	bool IsRunning() const
+	{
+		return State != EBenchmarkState::Idle;
+	}
+
+	bool IsRecording() const
+	{
+		return State == EBenchmarkState::Recording;
+	}
+
+	/** Called by remote vehicles with each state they receive, resolved to an absolute position */
+	void RecordOwnerState(AVehicleSystemBase* Vehicle, const FNetState& OwnerState);
+
+	/** Owner states further apart than this don't give a ground truth for the time between them */
+	static constexpr float MaxOwnerStateGap = 1.0f;
+
+	/** Seconds recorded after the vehicles spawn, so spawning and settling are not measured */
+	static constexpr float WarmupTime = 5.0f;
+
+private:
+	enum class EBenchmarkState : uint8
+	{
+		Idle, WaitingForClients, WaitingForVehicles, WarmingUp, Recording
+	};
+
+	bool IsServer() const;
+	void SpawnVehicles();
+	void DriveVehicles(float Time);
+	void BeginRecording();
+	void RecordFrame(float DeltaTime);
+	void SampleProxies();
+	void ResolveProxySamples();
+	void RecordSecond();
+	void HarvestVehicleStats();
+	void FinishBenchmark();
+	void WriteReport();
+
+	EBenchmarkState State = EBenchmarkState::Idle;
+	bool bInitialized = false;
+	bool ExitWhenDone = false;
+
+	//Settings
+	int32 NumVehicles = 0;
+	int32 NumClients = 0;
+	float Duration = 60.0f;
+	FString VehicleClassPath;
+	UPROPERTY()
+	TSubclassOf<AVehicleSystemBase> VehicleClass;
+
+	//One remote vehicle's owner states and its own positions waiting for the owner's states to catch up
+	struct FOwnerSample
+	{
+		float ServerTime;
+		FVector Position;
+		FVector Velocity;
+	};
+	struct FProxySample
+	{
+		float ServerTime;
+		FVector Position;
+	};
+	struct FProxyTrack
+	{
+		TArray<FOwnerSample> OwnerStates;
+		TArray<FProxySample> ProxySamples;
+	};
+	TMap<TWeakObjectPtr<AVehicleSystemBase>, FProxyTrack> ProxyTracks;
+
+	float StateStartTime = 0;
+	float NextSecondTime = 0;
+	TArray<TWeakObjectPtr<AVehicleSystemBase>> SpawnedVehicles;
+
+	//Recorded
+	TArray<float> FrameMs;
+	TArray<float> GameThreadMs;
+	TArray<float> OutBytesPerSecond;
+	TArray<float> InBytesPerSecond;
+	TArray<float> VehicleStateBytesPerSecond;
+	TArray<int32> RelevantVehicles;
+	int64 StatesReached = 0;
+	int64 Underruns = 0;
+	int64 LateStates = 0;
+	int64 DroppedStates = 0;
+	int64 OutOfOrderStates = 0;
+	double ErrorSum = 0;
+	double ErrorSquaredSum = 0;
+	float MaxError = 0;
+	int64 PositionSamples = 0;
+	double PositionErrorSum = 0;
+	double PositionErrorSquaredSum = 0;
+	float MaxPositionError = 0;
+};
@@ -7,14 +7,71 @@
 #include "PhysicsEngine/PhysicsConstraintComponent.h"
 #include "VehicleConstraint.generated.h"
 
+/** Values to change on a set of constraints, only the groups that are enabled are applied */
+USTRUCT(BlueprintType)
+struct FVehicleConstraintSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	bool SetLinearSoftConstraint = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetLinearSoftConstraint"))
+	bool LinearSoftConstraint = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetLinearSoftConstraint"))
+	float LinearStiffness = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetLinearSoftConstraint"))
+	float LinearDamping = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	bool SetLinearLimit = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetLinearLimit"))
+	float LinearLimit = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	bool SetAngularDrive = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetAngularDrive"))
+	float AngularPositionStrength = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetAngularDrive"))
+	float AngularVelocityStrength = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (EditCondition = "SetAngularDrive"))
+	float AngularForceLimit = 0.0f;
+};
+
 /**
- * 
+ * Changes are written to the constraint's profile straight away and sent to physics at the end of the frame,
+ * every constraint changed that frame is updated under one physics scene write by UVehicleConstraintSubsystem.
  */
 UCLASS(ClassGroup=VehicleSystem, meta=(BlueprintSpawnableComponent), HideCategories=(Activation,"Components|Activation", Physics, Mobility), ShowCategories=("Physics|Components|PhysicsConstraint"))
 class VEHICLESYSTEMPLUGIN_API UVehicleConstraint : public UPhysicsConstraintComponent
 {
 	GENERATED_BODY()
-	
+
+public:
 	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
 	void SetLinearSoftConstraint(bool SoftConstraint, float Stiffness, float Damping);
+
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void ApplyConstraintSettings(const FVehicleConstraintSettings& Settings);
+
+	/** Applies the same settings to every constraint, like presets for all the wheels of a fleet */
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	static void ApplyConstraintSettingsToAll(const TArray<UVehicleConstraint*>& Constraints, const FVehicleConstraintSettings& Settings);
+
+	/** Sends the queued changes to physics, UVehicleConstraintSubsystem does this for every queued constraint under one scene write */
+	void FlushPendingUpdates();
+
+private:
+	enum EPendingUpdate : uint8
+	{
+		PendingLinearLimit = 1,
+		PendingAngularDrive = 2
+	};
+
+	void QueueUpdate(uint8 Update);
+
+	uint8 PendingUpdates = 0;
+	//Drive params are only stored in the profile when applied
+	float PendingAngularPositionStrength = 0;
+	float PendingAngularVelocityStrength = 0;
+	float PendingAngularForceLimit = 0;
 };
@@ -0,0 +1,46 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VehicleConstraintSubsystem.generated.h"
+
+class UVehicleConstraint;
+
+/**
+ * Sends the changes made to UVehicleConstraints to physics once a frame, after the actors have ticked.
+ * Every constraint changed that frame is updated once, however many times it was changed, under a single physics scene write.
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleConstraintSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	/** Called by the constraint the first time it is changed each frame */
+	void QueueConstraint(UVehicleConstraint* Constraint);
+
+	/** Sends everything queued so far instead of waiting for the end of the frame */
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void FlushConstraintUpdates();
+
+private:
+	bool bInitialized = false;
+	TArray<TWeakObjectPtr<UVehicleConstraint>> PendingConstraints;
+};
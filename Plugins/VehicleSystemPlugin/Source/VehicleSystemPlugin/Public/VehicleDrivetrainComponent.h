@@ -0,0 +1,172 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Curves/RichCurve.h"
+#include "VehicleNetState.h"
+#include "VehicleDrivetrainComponent.generated.h"
+
+class AVehicleSystemBase;
+struct FVehicleGear;
+
+/** A curve sampled at even steps, evaluated with one lerp instead of a key search. Clamped outside the curve's keys */
+struct VEHICLESYSTEMPLUGIN_API FVehicleCurveTable
+{
+	void Bake(const FRichCurve& Curve, int32 NumSamples);
+	void Reset()
+	{
+		Samples.Reset();
+	}
+
+	bool IsBaked() const
+	{
+		return Samples.Num() > 0;
+	}
+
+	float Eval(float X) const
+	{
+		const float Position = FMath::Clamp((X - MinX) * SamplesPerUnit, 0.0f, (float)(Samples.Num() - 1));
+		const int32 Index = FMath::Min((int32)Position, Samples.Num() - 2);
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+
+private:
+	TArray<float> Samples;
+	float MinX = 0;
+	float SamplesPerUnit = 0;
+};
+
+/** A FVehicleGear with the divisions done up front */
+struct FVehicleGearTableEntry
+{
+	float StartSpeed = 0;
+	float SpeedToPercent = 0;
+	float LowRPM = 0;
+	float RPMRange = 0;
+	float MaxTorque = 0;
+	float TorqueRange = 0;
+	float UpShiftSpeed = 0;
+	float DownShiftSpeed = 0;
+
+	void Bake(const FVehicleGear& Gear);
+
+	float GetPercent(float Speed) const
+	{
+		return FMath::Clamp((Speed - StartSpeed) * SpeedToPercent, 0.0f, 1.0f);
+	}
+};
+
+/**
+ * Engine RPM, gear selection, torque and steering of the vehicle it is added to, worked out natively from the vehicle's Gears and SteeringCurve.
+ * Updated by the vehicle in its tick, blueprints set the inputs and read the outputs.
+ * Each gear covers StartSpeed to EndSpeed, where RPM rises from LowRPM to HighRPM and torque falls from MaxTorque to MinTorque.
+ * Gears shift up above UpShift and down below DownShift, both speeds, the gap between them keeps the gearbox from hunting.
+ */
+UCLASS(ClassGroup=VehicleSystem, meta=(BlueprintSpawnableComponent))
+class VEHICLESYSTEMPLUGIN_API UVehicleDrivetrainComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVehicleDrivetrainComponent();
+
+	/** Bakes the vehicle's Gears, call again after changing them at runtime */
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void BakeGears();
+
+	/** Called by the vehicle every tick */
+	void UpdateDrivetrain(float DeltaTime);
+
+	//Inputs
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void SetThrottleInput(float Throttle);
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void SetSteeringInput(float Steering);
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void SetBrakeInput(float Brake);
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void SetHandbrakeInput(bool Handbrake);
+	/** Any input not at rest, raycast wheels keep pushing while it is */
+	bool HasInput() const;
+
+	/** All the inputs at once, what server authoritative vehicles send and apply */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	FVehicleInputFrame GetInputFrame() const;
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void ApplyInputFrame(const FVehicleInputFrame& Input);
+
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void ShiftUp();
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void ShiftDown();
+
+	/** Forward velocity (cm/s) is multiplied by this to get the speed Gears and SteeringCurve use, the default gives km/h */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission")
+	float SpeedScale = 0.036f;
+
+	/** Pick gears from the speed, otherwise only ShiftUp and ShiftDown change gear */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission")
+	bool AutomaticGears = true;
+
+	/** No torque and no further shifting for this long after a shift */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission", meta = (ClampMin = "0"))
+	float ShiftTime = 0.2f;
+
+	/** Brake torque at full brake, split evenly between the axles */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission", meta = (ClampMin = "0"))
+	float MaxBrakeTorque = 4000.0f;
+
+	/** Brake torque of the handbrake, rear wheels only */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission", meta = (ClampMin = "0"))
+	float HandbrakeTorque = 6000.0f;
+
+	/** Share of DriveTorque sent to the front axle */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission", meta = (ClampMin = "0", ClampMax = "1"))
+	float FrontTorqueSplit = 0.0f;
+
+	//Outputs
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float Speed = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	int32 CurrentGear = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float EngineRPM = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	bool IsShifting = false;
+	/** Torque for the current gear and throttle, negative when reversing */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float DriveTorque = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float FrontAxleTorque = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float RearAxleTorque = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float FrontBrakeTorque = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	float RearBrakeTorque = 0;
+	/** SteeringCurve at the current speed times the steering input, eased by the vehicle's SteeringSpeed */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - General")
+	float SteeringAngle = 0;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	void SelectGear();
+	void SetGear(int32 Gear);
+	/** Wakes a settled or sleeping vehicle when input goes from none to some */
+	void WakeOnInput(bool HadInput);
+
+	UPROPERTY()
+	AVehicleSystemBase* Vehicle = nullptr;
+
+	TArray<FVehicleGearTableEntry> GearTable;
+	float ThrottleInput = 0;
+	float SteeringInput = 0;
+	float BrakeInput = 0;
+	bool HandbrakeInput = false;
+	float ShiftEndTime = 0;
+};
@@ -0,0 +1,62 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "VehicleNetState.h"
+#include "VehicleHitchComponent.generated.h"
+
+/**
+ * Tow point of a vehicle or trailer, placed where the trailer couples on.
+ * Vehicles that simulate send each trailer's yaw and pitch at its hitch with their states, other machines don't simulate the trailers,
+ * they place each one from its hitch and those angles. A trailer with its own hitch component continues the chain.
+ */
+UCLASS(ClassGroup=VehicleSystem, meta=(BlueprintSpawnableComponent))
+class VEHICLESYSTEMPLUGIN_API UVehicleHitchComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Where the trailer couples, local to the trailer's component */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Trailer")
+	FVector TrailerHitchPoint = FVector::ZeroVector;
+
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void AttachTrailer(UPrimitiveComponent* TrailerComponent);
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void DetachTrailer();
+
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	bool HasTrailer() const
+	{
+		return Trailer != nullptr;
+	}
+
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	UPrimitiveComponent* GetTrailer() const
+	{
+		return Trailer;
+	}
+
+	/** Adds the trailer of every hitch in the chain, nearest first */
+	void GetTrailers(TArray<UPrimitiveComponent*>& OutTrailers) const;
+
+	/** Writes the angles of the whole chain into State */
+	void GetHitchAngles(FNetState& State);
+	/** Places the chain's trailers from this hitch, they stop simulating until angles are read from them again */
+	void ApplyHitchAngles(int32 NumHitches, const float* Yaw, const float* Pitch);
+
+private:
+	UVehicleHitchComponent* FindNextHitch() const;
+	void SetTrailerDriven(bool Driven);
+
+	UPROPERTY()
+	UPrimitiveComponent* Trailer = nullptr;
+	//The trailer's own hitch, if it tows another trailer
+	UPROPERTY()
+	UVehicleHitchComponent* NextHitch = nullptr;
+
+	bool TrailerDriven = false;
+};
@@ -0,0 +1,60 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Estimates the clock offset to a sender and the arrival jitter of its states,
+ * and picks an interpolation delay that keeps the underrun rate near a target.
+ */
+class VEHICLESYSTEMPLUGIN_API FVehicleNetDelayEstimator
+{
+public:
+	static const int32 WindowSize = 64;
+
+	FVehicleNetDelayEstimator()
+	{
+		Reset();
+	}
+
+	void Reset();
+
+	/** Record the arrival of a state sent at SenderTime and received at LocalTime */
+	void AddSample(float SenderTime, float LocalTime);
+
+	/** Record that the queue ran dry or a state arrived too late to be used */
+	void AddUnderrun();
+
+	/** Recalculates the delay, MinDelay and MaxDelay bound the result */
+	void UpdateDelay(float TargetUnderrunRate, float MinDelay, float MaxDelay);
+
+	bool HasEstimate() const { return NumSamples > 0; }
+
+	/** Smallest (LocalTime - SenderTime) seen recently, the offset of the fastest transit */
+	float GetClockOffset() const { return ClockOffset; }
+
+	/** The delay states are currently played back with, on top of the clock offset */
+	float GetDelay() const { return Delay; }
+
+	/** Fraction of recent states that were late or left the queue empty */
+	float GetUnderrunRate() const { return UnderrunRate; }
+
+	/** Local time a state sent at SenderTime should be reached at */
+	float GetPlayoutTime(float SenderTime) const
+	{
+		return SenderTime + ClockOffset + Delay;
+	}
+
+private:
+	float Offsets[WindowSize];
+	int32 NextSample;
+	int32 NumSamples;
+	int32 SamplesSinceUpdate;
+
+	float ClockOffset;
+	float Delay;
+	float UnderrunMargin;
+	float UnderrunRate;
+};
@@ -0,0 +1,79 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VehicleNetState.h"
+
+/** The part of a net state that interpolation reads, rotation already converted to a quaternion */
+struct VEHICLESYSTEMPLUGIN_API FVehicleNetPose
+{
+	FQuat Rotation = FQuat::Identity;
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector AngularVelocity = FVector::ZeroVector;
+
+	FVehicleNetPose() {}
+	explicit FVehicleNetPose(const FNetState& State);
+};
+
+/**
+ * Interpolation and extrapolation between net states.
+ * Everything here is pure math on its arguments and safe to call off the game thread.
+ */
+struct VEHICLESYSTEMPLUGIN_API FVehicleNetInterpolation
+{
+	/** Cubic Hermite position, velocities are in units per second and Duration is the time between the two states */
+	static FVector HermitePosition(const FVector& P0, const FVector& V0, const FVector& P1, const FVector& V1, float Duration, float Alpha);
+
+	/** Rotates Rotation by a world space angular velocity (degrees per second) for DeltaTime seconds */
+	static FQuat IntegrateRotation(const FQuat& Rotation, const FVector& AngularVelocity, float DeltaTime);
+
+	/**
+	 * Projects the start rotation forward and the end rotation backward along their angular velocities,
+	 * then slerps between the two projections.
+	 */
+	static FQuat BlendRotation(const FQuat& Q0, const FVector& W0, const FQuat& Q1, const FVector& W1, float Duration, float Alpha);
+
+	/** Transform between From and To, Duration is the local time between the two states */
+	static void Interpolate(ENetInterpolationMode Mode, const FVehicleNetPose& From, const FVehicleNetPose& To, float Duration, float Alpha, FVector& OutPosition, FRotator& OutRotation);
+	static void Interpolate(ENetInterpolationMode Mode, const FNetState& From, const FNetState& To, float Duration, float Alpha, FVector& OutPosition, FRotator& OutRotation);
+
+	/** Dead reckoning from Pose for DeltaTime seconds */
+	static void Extrapolate(const FVehicleNetPose& Pose, float DeltaTime, FVector& OutPosition, FRotator& OutRotation);
+
+	/** Hitch angles between From and To, To's when the trailer chain changed between them */
+	static void InterpolateHitches(const FNetState& From, const FNetState& To, float Alpha, uint8& OutNumHitches, float* OutYaw, float* OutPitch);
+};
+
+/**
+ * One vehicle's interpolation for this frame.
+ * Filled on the game thread, computed anywhere, then applied back on the game thread.
+ * Hitch angles are cheap and filled in directly when the job is prepared, Compute only does the transform.
+ */
+struct VEHICLESYSTEMPLUGIN_API FVehicleNetInterpolationJob
+{
+	enum class EType : uint8
+	{
+		None, Interpolate, Extrapolate
+	};
+
+	EType Type = EType::None;
+	ENetInterpolationMode Mode = ENetInterpolationMode::Hermite;
+	FVehicleNetPose From;
+	FVehicleNetPose To;
+	float Duration = 0;
+	float Alpha = 0;
+	float ExtrapolationTime = 0;
+	//To was reached, apply it exactly after moving
+	bool ApplyExact = false;
+
+	FVector Position = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	uint8 NumHitches = 0;
+	float HitchYaw[VEHICLE_NET_MAX_HITCHES];
+	float HitchPitch[VEHICLE_NET_MAX_HITCHES];
+
+	void Compute();
+};
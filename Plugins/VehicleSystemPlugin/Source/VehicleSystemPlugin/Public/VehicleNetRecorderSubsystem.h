@@ -0,0 +1,103 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VehicleNetState.h"
+#include "VehicleNetRecorderSubsystem.generated.h"
+
+class AVehicleSystemBase;
+
+/**
+ * Records the movement states this machine receives with their arrival times, and replays them later without a network.
+ * Recording: VehicleNet.Record [name] and VehicleNet.StopRecording, or -VehicleNetRecord=<name> for the whole session.
+ * Replay: VehicleNet.Replay <name> [speed] spawns a replay proxy for each recorded vehicle and feeds every state at the time
+ * it arrived, through the same ReceiveNetState and AddStateToQueue path as live states.
+ * Recordings are kept in Saved/VehicleNetRecordings.
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleNetRecorderSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	void StartRecording(const FString& Name);
+	void StopRecording();
+	bool IsRecording() const
+	{
+		return Recording;
+	}
+
+	/** States as received, before keyframe deltas are resolved */
+	void RecordState(AVehicleSystemBase* Vehicle, const FNetState& State);
+	void RecordRestState(AVehicleSystemBase* Vehicle, const FNetState& State);
+
+	bool StartReplay(const FString& Name, float Speed = 1.0f);
+	void StopReplay();
+	bool IsReplaying() const
+	{
+		return Replaying;
+	}
+
+	static FString GetRecordingPath(const FString& Name);
+
+	static const uint32 FileMagic = 0x31524E56; //VNR1
+	static const int32 FileVersion = 2;
+	//Recordings are written to disk whenever this much has been recorded
+	static const int32 FlushSize = 1024 * 1024;
+
+private:
+	enum class ERecordType : uint8
+	{
+		Vehicle, State, RestState
+	};
+
+	uint32 GetRecordedVehicleId(AVehicleSystemBase* Vehicle);
+	void WriteState(ERecordType Type, AVehicleSystemBase* Vehicle, const FNetState& State);
+	void FlushRecording();
+
+	void SpawnReplayVehicles(const TMap<uint32, FString>& VehicleClasses);
+	void LogReplaySummary();
+
+	bool bInitialized = false;
+
+	//Recording
+	bool Recording = false;
+	bool RecordingHeaderWritten = false;
+	FString RecordingPath;
+	TArray<uint8> RecordBuffer;
+	//UObject unique ids to the ids used in the file
+	TMap<uint32, uint32> RecordedVehicleIds;
+
+	//Replay
+	struct FReplayRecord
+	{
+		ERecordType Type;
+		uint32 VehicleId;
+		float LocalTime;
+		FNetState State;
+	};
+
+	bool Replaying = false;
+	float ReplaySpeed = 1.0f;
+	float ReplayTime = 0;
+	int32 NextReplayRecord = 0;
+	TArray<FReplayRecord> ReplayRecords;
+	TMap<uint32, TWeakObjectPtr<AVehicleSystemBase>> ReplayVehicles;
+};
@@ -0,0 +1,217 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "VehicleNetState.generated.h"
+
+/** Number of keyframe slots a receiver keeps, keyframe id 0 means "absolute position" */
+#define VEHICLE_NET_KEYFRAME_SLOTS 16
+
+/** Trailers in a chain whose hitch angles are sent with each state */
+#define VEHICLE_NET_MAX_HITCHES 3
+
+/** Input frames in one FVehicleInputBundle, the newest and the ones resent with it */
+#define VEHICLE_NET_MAX_INPUT_FRAMES 3
+
+UENUM(BlueprintType)
+enum class ENetRotationFormat : uint8
+{
+	/** Three full precision floats */
+	Full,
+	/** Three 16 bit axes */
+	CompressedRotator,
+	/** Smallest three quaternion packed into 32 bits */
+	PackedQuaternion
+};
+
+UENUM(BlueprintType)
+enum class ENetInterpolationMode : uint8
+{
+	/** Straight line between states, ignores velocities */
+	Linear,
+	/** Cubic Hermite curve through the states' positions and velocities */
+	Hermite
+};
+
+/** Controls how an FNetState is quantized when it is sent over the network */
+USTRUCT(BlueprintType)
+struct FNetStateQuantization
+{
+	GENERATED_BODY()
+
+	/** Quantize states, when disabled states are sent with full precision */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	bool Enabled = true;
+
+	/** Send positions relative to the last keyframe instead of in world space */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled"))
+	bool DeltaPosition = true;
+
+	/** Number of states sent between absolute keyframes */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled && DeltaPosition", ClampMin = "1", ClampMax = "64"))
+	int32 KeyframeInterval = 10;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled"))
+	ENetRotationFormat RotationFormat = ENetRotationFormat::PackedQuaternion;
+
+	/** Linear velocity is clamped to this range (cm/s), rounded up to the next power of two */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled", ClampMin = "256"))
+	float MaxLinearVelocity = 16384.0f;
+
+	/** Angular velocity is clamped to this range (deg/s), rounded up to the next power of two */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled", ClampMin = "16"))
+	float MaxAngularVelocity = 2048.0f;
+
+	/** Bits used per velocity component, including the sign */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "Enabled", ClampMin = "8", ClampMax = "23"))
+	int32 VelocityBits = 13;
+};
+
+/** How often a client receives a vehicle's states when it is within MaxDistance of it */
+USTRUCT(BlueprintType)
+struct FVehicleNetRateTier
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "0"))
+	float MaxDistance = 0.0f;
+
+	/** Minimum time between two states sent to the same client, 0 sends every state */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "0"))
+	float SendInterval = 0.0f;
+
+	FVehicleNetRateTier() {}
+	FVehicleNetRateTier(float InMaxDistance, float InSendInterval)
+		: MaxDistance(InMaxDistance)
+		, SendInterval(InSendInterval)
+	{}
+};
+
+USTRUCT(BlueprintType)
+struct FNetState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	float timestamp;
+	UPROPERTY(NotReplicated)
+	float localtimestamp;
+	UPROPERTY()
+	FVector position;
+	UPROPERTY()
+	FRotator rotation;
+	UPROPERTY()
+	FVector velocity;
+	UPROPERTY()
+	FVector angularVelocity;
+
+	/** Keyframe this state's position is relative to, 0 when the position is absolute */
+	UPROPERTY(NotReplicated)
+	uint8 keyframeId;
+	/** This state is a keyframe, receivers store its position under keyframeId */
+	UPROPERTY(NotReplicated)
+	bool isKeyframe;
+	/** Position of the keyframe on the sending side, subtracted from position when serializing */
+	UPROPERTY(NotReplicated)
+	FVector keyframeBase;
+	UPROPERTY(NotReplicated)
+	FNetStateQuantization quantization;
+
+	/** Yaw and pitch of each trailer relative to its hitch, first trailer first */
+	uint8 numHitches;
+	float hitchYaw[VEHICLE_NET_MAX_HITCHES];
+	float hitchPitch[VEHICLE_NET_MAX_HITCHES];
+
+	FNetState()
+	{
+		timestamp = 0.0f;
+		localtimestamp = 0.0f;
+		position = FVector::ZeroVector;
+		rotation = FRotator::ZeroRotator;
+		velocity = FVector::ZeroVector;
+		angularVelocity = FVector::ZeroVector;
+		keyframeId = 0;
+		isKeyframe = false;
+		keyframeBase = FVector::ZeroVector;
+		numHitches = 0;
+		for (int32 i = 0; i < VEHICLE_NET_MAX_HITCHES; i++)
+		{
+			hitchYaw[i] = 0.0f;
+			hitchPitch[i] = 0.0f;
+		}
+	}
+
+	/** Is position relative to a keyframe that still has to be resolved by the receiver */
+	bool IsDelta() const
+	{
+		return keyframeId != 0 && !isKeyframe;
+	}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FNetState> : public TStructOpsTypeTraitsBase2<FNetState>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/** A keyframe position as seen by a receiver */
+struct FNetKeyframe
+{
+	FVector position = FVector::ZeroVector;
+	float timestamp = 0.0f;
+	bool valid = false;
+};
+
+/** The driver's inputs for one send interval, what server authoritative clients send instead of states */
+USTRUCT(BlueprintType)
+struct FVehicleInputFrame
+{
+	GENERATED_BODY()
+
+	/** Sequence number, wraps */
+	uint16 Frame = 0;
+
+	UPROPERTY(BlueprintReadWrite, Category = "Vehicle - Network")
+	float Throttle = 0.0f;
+	UPROPERTY(BlueprintReadWrite, Category = "Vehicle - Network")
+	float Brake = 0.0f;
+	UPROPERTY(BlueprintReadWrite, Category = "Vehicle - Network")
+	float Steering = 0.0f;
+	UPROPERTY(BlueprintReadWrite, Category = "Vehicle - Network")
+	bool Handbrake = false;
+
+	/** Is this frame after Other, allowing for wrap around */
+	bool IsNewerThan(uint16 Other) const
+	{
+		return (int16)(Frame - Other) > 0;
+	}
+};
+
+/** The newest input frame followed by the ones before it, so a lost packet doesn't lose inputs */
+USTRUCT()
+struct FVehicleInputBundle
+{
+	GENERATED_BODY()
+
+	/** Newest first, consecutive frame numbers */
+	TArray<FVehicleInputFrame, TInlineAllocator<VEHICLE_NET_MAX_INPUT_FRAMES>> Frames;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FVehicleInputBundle> : public TStructOpsTypeTraitsBase2<FVehicleInputBundle>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
@@ -0,0 +1,124 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "VehicleRaycastWheelComponent.generated.h"
+
+class AVehicleSystemBase;
+
+/**
+ * A wheel without a body or constraint, placed on the vehicle where the top of its suspension is.
+ * The suspension subsystem traces down from it and pushes on the VehicleMesh with the spring, damper and tire forces,
+ * components attached to it are moved to the wheel's position, steering and spin for visuals.
+ * Forces are in the engine's units, so stiffness is force per cm of compression.
+ */
+UCLASS(ClassGroup=VehicleSystem, meta=(BlueprintSpawnableComponent))
+class VEHICLESYSTEMPLUGIN_API UVehicleRaycastWheelComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVehicleRaycastWheelComponent();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "1"))
+	float WheelRadius = 35.0f;
+
+	/** Travel from full extension to full compression */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "1"))
+	float SuspensionLength = 25.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float SpringStiffness = 60000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float SpringDamping = 4000.0f;
+
+	/** Sweep a sphere of WheelRadius instead of a line, better over kerbs and steps but more expensive */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	bool SphereTrace = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Sideways force per cm/s of sideways slip */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float CorneringStiffness = 200.0f;
+
+	/** Tire forces are limited to this times the load on the wheel */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float Grip = 1.2f;
+
+	/** Force against rolling per cm/s */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float RollingResistance = 5.0f;
+
+	/** The drivetrain's SteeringAngle is multiplied by this, 0 for wheels that don't steer and negative for rear steering */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	float SteeringScale = 0.0f;
+
+	/** Takes its torque from the drivetrain's front axle instead of the rear */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension")
+	bool FrontAxle = false;
+
+	/** Share of its axle's torque */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0", ClampMax = "1"))
+	float TorqueShare = 0.5f;
+
+	/** Below this speed (cm/s) with no drivetrain input held the vehicle counts as settled */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float RestSpeed = 5.0f;
+
+	/** Below this angular speed (deg/s) with no drivetrain input held the vehicle counts as settled */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float RestAngularSpeed = 2.0f;
+
+	/** Seconds settled before the wheel stops pushing and lets the body sleep, adding forces keeps it awake */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Suspension", meta = (ClampMin = "0"))
+	float RestDelay = 0.5f;
+
+	//Outputs
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	bool IsGrounded = false;
+	/** 0 at full extension, 1 at full compression */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	float Compression = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	float SteerAngle = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	float SpinAngle = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	FVector ContactPoint = FVector::ZeroVector;
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Suspension")
+	FVector ContactNormal = FVector::UpVector;
+
+	/** Starts this frame's trace, its result is used next frame */
+	void QueueTrace(UWorld* World);
+	/** Reads last frame's trace and pushes on the vehicle */
+	void ApplyTraceResult(UWorld* World, float DeltaTime);
+	/** Skipped while the vehicle rests or doesn't simulate, so sleeping vehicles aren't woken */
+	bool ShouldSimulate() const;
+
+	//Index of this wheel in the suspension subsystem
+	int32 SuspensionSlot = INDEX_NONE;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void UpdateVisuals(float SpringLength);
+
+	UPROPERTY()
+	AVehicleSystemBase* Vehicle = nullptr;
+
+	bool IsSettled(float DeltaTime);
+
+	FTraceHandle TraceHandle;
+	float LastCompression = 0;
+	float SettledTime = 0;
+};
@@ -0,0 +1,71 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "VehicleNetState.h"
+#include "VehicleReplicationRelay.generated.h"
+
+class AVehicleSystemBase;
+
+USTRUCT()
+struct FVehicleNetBatchEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	AVehicleSystemBase* Vehicle = nullptr;
+
+	UPROPERTY()
+	FNetState State;
+};
+
+/**
+ * States for several vehicles sent in one RPC.
+ * The sending side points the batch at its own scratch buffer so sending does not copy or allocate,
+ * the receiving side reads into ReceivedEntries.
+ */
+USTRUCT()
+struct FVehicleNetBatch
+{
+	GENERATED_BODY()
+
+	const FVehicleNetBatchEntry* SendEntries = nullptr;
+	int32 NumSendEntries = 0;
+
+	TArray<FVehicleNetBatchEntry> ReceivedEntries;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FVehicleNetBatch> : public TStructOpsTypeTraitsBase2<FVehicleNetBatch>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ * Spawned by the server for each client connection and only relevant to that connection's player controller.
+ * Carries every vehicle state the client needs in one bunch per net tick.
+ */
+UCLASS(NotBlueprintable, Transient)
+class VEHICLESYSTEMPLUGIN_API AVehicleReplicationRelay : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AVehicleReplicationRelay();
+
+	/** Largest number of states sent in a single batch, bigger batches are split so a lost packet costs less */
+	static const int32 MaxStatesPerBatch = 32;
+
+	UFUNCTION(Client, unreliable, WithValidation)
+		void Client_ReceiveVehicleStates(const FVehicleNetBatch& Batch);
+		virtual bool Client_ReceiveVehicleStates_Validate(const FVehicleNetBatch& Batch);
+		virtual void Client_ReceiveVehicleStates_Implementation(const FVehicleNetBatch& Batch);
+};
@@ -0,0 +1,97 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "VehicleNetState.h"
+#include "VehicleReplicationRelay.h"
+#include "VehicleReplicationSubsystem.generated.h"
+
+class AVehicleSystemBase;
+class APlayerController;
+class UNetConnection;
+
+/**
+ * Drives movement replication for every vehicle in the world.
+ * Replaces the per vehicle send timers with one pass per frame, and on the server gathers the states
+ * received from owners and relays them to every other connection in one batch per connection per frame.
+ * Each connection gets each vehicle at a rate based on distance and view direction, see AVehicleSystemBase::NetRateTiers.
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleReplicationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	/** Start or stop calling NetStateSend on this vehicle every NetSendRate */
+	void SetVehicleSending(AVehicleSystemBase* Vehicle, bool Sending);
+	void UnregisterVehicle(AVehicleSystemBase* Vehicle);
+
+	/**
+	 * Server only, relay a state received from the vehicle's owner to every other connection this frame.
+	 * ResolvedState is the same state with an absolute position, sent to connections that never got its keyframe.
+	 */
+	void QueueStateForRelay(AVehicleSystemBase* Vehicle, const FNetState& State, const FNetState& ResolvedState);
+
+private:
+	int32 GetOrAddSendSlot(AVehicleSystemBase* Vehicle);
+	void TickSends(float Now);
+	void UpdateRelays();
+	void FlushRelays();
+
+	struct FVehicleSendSlot
+	{
+		TWeakObjectPtr<AVehicleSystemBase> Vehicle;
+		float NextSendTime = 0;
+		bool Sending = false;
+	};
+
+	struct FPendingState
+	{
+		TWeakObjectPtr<AVehicleSystemBase> Vehicle;
+		UNetConnection* OwnerConnection = nullptr;
+		int32 SendSlot = INDEX_NONE;
+		FNetState State;
+		FNetState ResolvedState;
+	};
+
+	//What a connection last received for a vehicle
+	struct FVehicleRelayState
+	{
+		float LastSentTime = -BIG_NUMBER;
+		uint8 KeyframeId = 0;
+		float KeyframeTimestamp = 0;
+	};
+
+	struct FConnectionScratch
+	{
+		TWeakObjectPtr<APlayerController> PlayerController;
+		TWeakObjectPtr<AVehicleReplicationRelay> Relay;
+		//Reused every frame so relaying does not allocate once it has grown
+		TArray<FVehicleNetBatchEntry> Entries;
+		//Parallel to SendSlots, always the same length and swap removed together
+		TArray<FVehicleRelayState> VehicleStates;
+	};
+
+	//Vehicles keep the index of their slot, slots are swap removed
+	TArray<FVehicleSendSlot> SendSlots;
+	TArray<FPendingState> PendingStates;
+	TArray<FConnectionScratch> Connections;
+	bool bInitialized = false;
+};
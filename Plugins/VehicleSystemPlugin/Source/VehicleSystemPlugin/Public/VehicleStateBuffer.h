@@ -0,0 +1,145 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VehicleNetState.h"
+#include "VehicleStateBuffer.generated.h"
+
+USTRUCT(BlueprintType)
+struct FVehicleStateBufferStats
+{
+	GENERATED_BODY()
+
+	/** States thrown away because the buffer was full or they were duplicates */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	int32 Dropped = 0;
+
+	/** States that arrived after we had already synced past them */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	int32 Late = 0;
+
+	/** States that arrived before a state the owner sent earlier */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	int32 OutOfOrder = 0;
+};
+
+/**
+ * Fixed capacity circular buffer of net states sorted by timestamp.
+ * Memory is only allocated in Init, inserting and popping never allocate.
+ */
+class VEHICLESYSTEMPLUGIN_API FVehicleStateBuffer
+{
+public:
+	/** Allocates room for at least InCapacity states and empties the buffer */
+	void Init(int32 InCapacity);
+
+	/** Removes all states but keeps the allocation and stats */
+	void Reset()
+	{
+		Head = 0;
+		Count = 0;
+	}
+
+	int32 Num() const { return Count; }
+	int32 Capacity() const { return MaxCount; }
+	bool IsEmpty() const { return Count == 0; }
+	bool IsFull() const { return Count >= MaxCount; }
+
+	FNetState& operator[](int32 Index)
+	{
+		check(Index >= 0 && Index < Count);
+		return States[(Head + Index) & Mask];
+	}
+
+	const FNetState& operator[](int32 Index) const
+	{
+		check(Index >= 0 && Index < Count);
+		return States[(Head + Index) & Mask];
+	}
+
+	FNetState& Front() { return (*this)[0]; }
+	const FNetState& Front() const { return (*this)[0]; }
+	const FNetState& Back() const { return (*this)[Count - 1]; }
+
+	void PopFront()
+	{
+		if (Count > 0)
+		{
+			Head = (Head + 1) & Mask;
+			Count--;
+		}
+	}
+
+	/**
+	 * Inserts a state keeping the buffer sorted by timestamp.
+	 * States older than MinTimestamp are late and discarded. When full the oldest state is dropped,
+	 * skipping a front at MinTimestamp because that is the state currently being synced to.
+	 * @return false if the state was discarded
+	 */
+	bool Insert(const FNetState& State, float MinTimestamp);
+
+	FVehicleStateBufferStats Stats;
+
+private:
+	FNetState& At(int32 Index)
+	{
+		return States[(Head + Index) & Mask];
+	}
+
+	TArray<FNetState> States;
+	int32 Head = 0;
+	int32 Count = 0;
+	int32 MaxCount = 0;
+	int32 Mask = 0;
+};
+
+/** What the owner had predicted when it sent an input frame */
+struct FVehiclePredictedState
+{
+	uint16 Frame = 0;
+	FVector Position = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector Velocity = FVector::ZeroVector;
+};
+
+/**
+ * Fixed capacity circular buffer of an owner's predictions in the order they were sent.
+ * When full the oldest prediction is overwritten.
+ */
+class VEHICLESYSTEMPLUGIN_API FVehiclePredictionHistory
+{
+public:
+	void Init(int32 InCapacity);
+
+	void Reset()
+	{
+		Head = 0;
+		Count = 0;
+	}
+
+	int32 Num() const { return Count; }
+
+	void Add(const FVehiclePredictedState& State);
+
+	/**
+	 * Removes every prediction up to and including Frame.
+	 * @return false if Frame is older than the history or was never sent, nothing newer is removed
+	 */
+	bool PopUntil(uint16 Frame, FVehiclePredictedState& OutState);
+
+	/** Moves the remaining predictions by a correction applied to the vehicle, so it isn't corrected twice */
+	void ApplyCorrection(const FVector& PositionOffset, const FQuat& RotationOffset, const FVector& VelocityOffset);
+
+private:
+	FVehiclePredictedState& At(int32 Index)
+	{
+		return States[(Head + Index) & Mask];
+	}
+
+	TArray<FVehiclePredictedState> States;
+	int32 Head = 0;
+	int32 Count = 0;
+	int32 Mask = 0;
+};
@@ -0,0 +1,58 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleSuspensionSubsystem.generated.h"
+
+class UVehicleSuspensionSubsystem;
+class UVehicleRaycastWheelComponent;
+
+USTRUCT()
+struct FVehicleSuspensionTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UVehicleSuspensionSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FVehicleSuspensionTickFunction> : public TStructOpsTypeTraitsBase2<FVehicleSuspensionTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Updates every raycast wheel in the world once per frame, pre physics.
+ * Each frame applies the forces from the traces queued the frame before, then queues the next traces for every wheel,
+ * so the world runs them all as one batch of async scene queries off the game thread.
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleSuspensionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	void RegisterWheel(UVehicleRaycastWheelComponent* Wheel);
+	void UnregisterWheel(UVehicleRaycastWheelComponent* Wheel);
+
+	void TickSuspension(float DeltaTime);
+
+private:
+	FVehicleSuspensionTickFunction TickFunction;
+
+	//Indexed by each wheel's SuspensionSlot, swap removed
+	TArray<UVehicleRaycastWheelComponent*> Wheels;
+};
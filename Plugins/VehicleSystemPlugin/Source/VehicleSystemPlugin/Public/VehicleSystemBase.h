@@ -10,37 +10,19 @@
 #include "Runtime/Engine/Classes/Curves/CurveFloat.h"
 #include "Components/PrimitiveComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "PhysicsEngine/PhysicsConstraintComponent.h"
 #include "GameFramework/GameStateBase.h"
+#include "VehicleNetState.h"
+#include "VehicleStateBuffer.h"
+#include "VehicleNetDelayEstimator.h"
+#include "VehicleNetInterpolation.h"
+#include "VehicleDrivetrainComponent.h"
 #include "VehicleSystemBase.generated.h"
 
-USTRUCT(BlueprintType)
-struct FNetState
-{
-	GENERATED_BODY()
-
-	UPROPERTY()
-	float timestamp;
-	UPROPERTY(NotReplicated)
-	float localtimestamp;
-	UPROPERTY()
-	FVector position;
-	UPROPERTY()
-	FRotator rotation;
-	UPROPERTY()
-	FVector velocity;
-	UPROPERTY()
-	FVector angularVelocity;
-
-	FNetState()
-	{
-		timestamp = 0.0f;
-		localtimestamp = 0.0f;
-		position = FVector::ZeroVector;
-		rotation = FRotator::ZeroRotator;
-		velocity = FVector::ZeroVector;
-		angularVelocity = FVector::ZeroVector;
-	}
-};
+class UVehicleReplicationSubsystem;
+class UVehicleNetRecorderSubsystem;
+class UVehicleBenchmarkSubsystem;
+class UVehicleHitchComponent;
 
 UENUM(BlueprintType)
 enum class NetworkRoles : uint8
@@ -78,6 +60,38 @@ struct FVehicleGear
 	float MinTorque;
 };
 
+/** How closely a remote vehicle followed its owner, measured each time it reaches a state */
+USTRUCT(BlueprintType)
+struct FVehicleNetSyncStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	int32 StatesReached = 0;
+
+	/** Times the queue ran empty after reaching a state */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	int32 Underruns = 0;
+
+	/** Sum of the distances between the vehicle and each state it reached, just before snapping to it */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	float ErrorSum = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	float ErrorSquaredSum = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	float MaxError = 0;
+};
+
+//A body that was simulating before the vehicle became kinematic
+struct FVehicleKinematicBody
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	TWeakObjectPtr<USceneComponent> AttachParent;
+	FName AttachSocket;
+};
+
 UCLASS(Blueprintable)
 class VEHICLESYSTEMPLUGIN_API AVehicleSystemBase : public APawn
 {
@@ -86,6 +100,7 @@ class VEHICLESYSTEMPLUGIN_API AVehicleSystemBase : public APawn
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	AVehicleSystemBase();
@@ -96,6 +111,18 @@ public:
 
 	virtual void PossessedBy(AController* NewController) override;
 	virtual void UnPossessed() override;
+	virtual void OnRep_Controller() override;
+
+	/** Let the world's tick subsystem sync every vehicle in one batch instead of ticking each vehicle */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Vehicle - General")
+	bool NetUseTickManager = true;
+	//Index of this vehicle in the tick subsystem, INDEX_NONE while ticking itself
+	int32 TickSlot = INDEX_NONE;
+
+	/** Tick work done before the interpolation, returns true if Job needs to be computed and applied */
+	bool PrepareTick(float DeltaTime, NetworkRoles CurrentRole, FVehicleNetInterpolationJob& Job);
+	//The actor still has to tick when the blueprint uses Event Tick
+	bool NeedsBlueprintTick() const;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Vehicle - General")
 	UStaticMeshComponent* VehicleMesh;
@@ -110,6 +137,19 @@ public:
 	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
 	float GetSteeringFromCurve(float Speed);
 
+	/** Samples baked from SteeringCurve at BeginPlay */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - General", meta = (ClampMin = "2"))
+	int32 SteeringTableSize = 64;
+	FVehicleCurveTable SteeringTable;
+
+	/** Bakes SteeringCurve again, call after changing it at runtime */
+	UFUNCTION(BlueprintCallable, Category = "VehicleSystemPlugin")
+	void BakeSteeringCurve();
+
+	/** Found at BeginPlay, updated before the network sync every tick */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Transmission")
+	UVehicleDrivetrainComponent* Drivetrain = nullptr;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Transmission")
 	TArray<FVehicleGear> Gears;
 
@@ -121,21 +161,88 @@ public:
 	//UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "VehicleSystemPlugin")
 	void SetVehicleLocation(FVector NewPosition, FRotator NewRotation);
 
-	UFUNCTION(BlueprintImplementableEvent, Category = "VehicleSystemPlugin")
+	/** Moves the chassis and everything simulating with it, wheels and trailers, keeping their velocities relative to the chassis */
+	void TeleportVehicle(const FVector& NewPosition, const FQuat& NewRotation);
+
+	UFUNCTION(BlueprintImplementableEvent, Category = "VehicleSystemPlugin", meta = (DeprecatedFunction, DeprecationMessage = "No longer called, wheels are moved with the chassis by TeleportVehicle"))
 	void TeleportWheels();
 
 	//Networking
 	float GetLocalWorldTime()
 	{
-		return GetWorld()->GetTimeSeconds();
+		return IsReplayProxy ? ReplayTime : GetWorld()->GetTimeSeconds();
 	}
 
+	/** Spawned by UVehicleNetRecorderSubsystem to play back a recording, acts as a client and runs on the replay clock */
+	bool IsReplayProxy = false;
+	float ReplayTime = 0;
+	/** The recorder when this machine is recording received states */
+	UVehicleNetRecorderSubsystem* GetActiveNetRecorder() const;
+	/** The benchmark when this machine is recording one */
+	UVehicleBenchmarkSubsystem* GetActiveBenchmark() const;
+
 	bool ShouldSyncWithServer = true;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
 	bool ReplicateMovement;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
 	float NetSendRate;
+
+	/**
+	 * The server runs the vehicle from its driver's inputs instead of taking the driver's states.
+	 * The driver predicts locally and is pulled onto the server's states, needs a UVehicleDrivetrainComponent.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Vehicle - Network")
+	bool NetServerAuthoritative = false;
+	/** Input frames sent in each packet, the newest and the ones before it in case those were lost */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "1", ClampMax = "3"))
+	int32 NetInputRedundancy = 3;
+	/** Input frames the server holds before it skips ahead */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "1"))
+	int32 NetMaxBufferedInputs = 4;
+	/** Predictions the driver keeps waiting for the server's state of the same frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "8"))
+	int32 NetPredictionHistorySize = 64;
+	/** The driver ignores differences from the server smaller than this (cm) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "0"))
+	float NetReconcileTolerance = 5.0f;
+	/** The driver ignores rotation differences from the server smaller than this (degrees) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "0"))
+	float NetReconcileAngleTolerance = 2.0f;
+	/** How quickly the driver is blended onto the server's state, per second */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "0.1"))
+	float NetReconcileRate = 10.0f;
+	/** Differences larger than this (cm) are corrected at once instead of blended */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetServerAuthoritative", ClampMin = "0"))
+	float NetReconcileSnapDistance = 500.0f;
+
+	/** The server runs this vehicle for a remote driver */
+	bool IsServerSimulating()
+	{
+		return NetServerAuthoritative && GetCachedNetworkRole() == NetworkRoles::Server;
+	}
+	/** The driver's client predicts this vehicle for the server */
+	bool IsPredicting()
+	{
+		return NetServerAuthoritative && GetCachedNetworkRole() == NetworkRoles::Owner && !isServer();
+	}
+	/** Send through the world's replication subsystem, which relays all states to each client in one batch per frame */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Vehicle - Network")
+	bool NetUseReplicationBatcher = true;
+	/**
+	 * Send rate to each client by distance from its view, sorted by MaxDistance.
+	 * Clients further away than the last tier use the last tier's interval. Only used with NetUseReplicationBatcher.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetUseReplicationBatcher"))
+	TArray<FVehicleNetRateTier> NetRateTiers;
+	/** Send interval multiplier for clients that are not looking towards this vehicle */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetUseReplicationBatcher", ClampMin = "1"))
+	float NetOutOfViewRateScale = 2.0f;
+	/** Send interval for a client viewed from Location looking along Direction with the given field of view */
+	float GetNetSendIntervalFor(const FVector& ViewLocation, const FVector& ViewDirection, float ViewFOV) const;
+	//Index of this vehicle in the replication subsystem
+	int32 NetSendSlot = INDEX_NONE;
+	UVehicleReplicationSubsystem* GetReplicationSubsystem() const;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
 	float NetTimeBehind;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
@@ -144,24 +251,177 @@ public:
 	float NetPositionTolerance;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
 	float NetSmoothing;
+	/** Errors larger than this are teleported away instead of blended */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "0"))
+	float NetTeleportDistance = 3000.0f;
+	/** Blending speeds up with the error, at this distance it runs at twice NetSmoothing */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "1"))
+	float NetCorrectionErrorScale = 250.0f;
+
+	/** Size the interpolation delay from the measured jitter of each vehicle's states instead of using NetTimeBehind */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	bool NetAdaptiveDelay = false;
+	/** Fraction of states allowed to arrive too late or leave the queue empty */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetAdaptiveDelay", ClampMin = "0.001", ClampMax = "0.5"))
+	float NetTargetUnderrunRate = 0.02f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetAdaptiveDelay", ClampMin = "0"))
+	float NetMinDelay = 0.02f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetAdaptiveDelay", ClampMin = "0"))
+	float NetMaxDelay = 0.5f;
+
+	FVehicleNetDelayEstimator NetDelayEstimator;
+	bool QueueStarved = false;
+
+	/** The delay remote states are currently played back with */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	float GetNetInterpolationDelay() const
+	{
+		return NetAdaptiveDelay ? NetDelayEstimator.GetDelay() : NetTimeBehind;
+	}
+
+	/** Fraction of recent states that arrived too late or left the queue empty, only measured with NetAdaptiveDelay */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	float GetNetUnderrunRate() const
+	{
+		return NetDelayEstimator.GetUnderrunRate();
+	}
+
+	/** How long before a state's local time we start lerping to it, keeps NetLerpStart's lead over the delay */
+	float GetNetLerpStart() const
+	{
+		return NetLerpStart - NetTimeBehind + GetNetInterpolationDelay();
+	}
+
+	/** How movement states are quantized before they are sent */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	FNetStateQuantization NetQuantization;
+
+	/** Bytes per second this machine sends for this vehicle's movement, updated once per second */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	float NetBytesPerSecond = 0;
+
+	/** Bytes per second the same states would have cost with quantization disabled */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Network")
+	float NetBytesPerSecondUnquantized = 0;
+
+	int64 NetBitsThisWindow = 0;
+	int64 NetBitsUnquantizedThisWindow = 0;
+	float NetBandwidthWindowStart = 0;
+
+	//Sending side keyframe tracking
+	uint8 NetKeyframeId = 0;
+	int32 NetStatesSinceKeyframe = 0;
+	FVector NetKeyframePosition = FVector::ZeroVector;
+
+	//Receiving side keyframes, indexed by keyframe id
+	FNetKeyframe NetKeyframes[VEHICLE_NET_KEYFRAME_SLOTS];
+
+	/** Stop simulating physics on remote vehicles that are far from every local view or resting, they are only interpolated */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	bool NetKinematicLOD = true;
+	/** Remote vehicles within this distance of a local view are always simulated */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetKinematicLOD", ClampMin = "0"))
+	float NetKinematicDistance = 10000.0f;
+	/** Extra distance before a simulated vehicle becomes kinematic, so it doesn't switch back and forth at the edge */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetKinematicLOD", ClampMin = "0"))
+	float NetKinematicHysteresis = 2000.0f;
+	/** Seconds between distance checks */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetKinematicLOD", ClampMin = "0"))
+	float NetKinematicCheckInterval = 0.25f;
+
+	/** True while this remote vehicle is not simulating physics */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	bool IsNetKinematic() const
+	{
+		return IsKinematicProxy;
+	}
+
+	bool IsKinematicProxy = false;
+	float NextKinematicCheckTime = 0;
+	TArray<FVehicleKinematicBody> KinematicBodies;
+	TArray<TWeakObjectPtr<UPhysicsConstraintComponent>> KinematicConstraints;
+
+	void UpdateKinematicLOD(NetworkRoles CurrentRole);
+	void SetKinematicProxy(bool Kinematic);
+	float GetDistanceToLocalView() const;
+	bool IsAtRestState() const;
 
 	UPROPERTY(ReplicatedUsing=OnRep_RestState)
 	FNetState RestState;
 
 	UFUNCTION()
-	void OnRep_RestState()
-	{
-		IsResting = (RestState.position != FVector::ZeroVector);
-	}
+	void OnRep_RestState();
 	bool IsResting = false;
+
+	/** Make unpossessed vehicles net dormant and stop sending once their body falls asleep, wakes on any physics wake up */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	bool NetDormantWhenResting = true;
+	/** Seconds between checks for the body falling asleep, also the tick interval of resting vehicles with a blueprint tick */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (EditCondition = "NetDormantWhenResting", ClampMin = "0.1"))
+	float NetRestCheckInterval = 1.0f;
+
+	//Stopped sending because we are resting, waiting for the body to sleep or already dormant
+	bool RestSleeping = false;
+	//Native ticking stopped until something wakes the vehicle
+	bool TickSuspended = false;
+	float TickIntervalBeforeSuspend = 0;
+	FTimerHandle RestCheckTimer;
+
+	void BeginRestSleep();
+	UFUNCTION()
+	void CheckRestSleep();
+	void WakeFromRest();
+	void SetTickSuspended(bool Suspend);
+	UFUNCTION()
+	void OnVehicleMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
 	
-	TArray<FNetState> StateQueue;
+	/** Maximum number of states buffered for interpolation, the oldest state is dropped when full */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "2", ClampMax = "128"))
+	int32 NetStateBufferSize = 16;
+
+	FVehicleStateBuffer StateQueue;
+	//Difference between the owner's timestamps and our local times for the states in the queue
+	float QueueLocalTimeOffset = 0;
+
+	/** Dropped, late and out of order counters for the state queue */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	FVehicleStateBufferStats GetNetStateBufferStats() const
+	{
+		return StateQueue.Stats;
+	}
+
+	FVehicleNetSyncStats NetSyncStats;
+
+	/** Position error and underruns of this remote vehicle since the last reset */
+	UFUNCTION(BlueprintPure, Category = "VehicleSystemPlugin")
+	FVehicleNetSyncStats GetNetSyncStats() const
+	{
+		return NetSyncStats;
+	}
+
+	/** Hermite uses the replicated velocities to curve between states instead of cutting corners */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network")
+	ENetInterpolationMode NetInterpolationMode = ENetInterpolationMode::Hermite;
+
+	/** How long to dead reckon from the last state when no newer state has arrived, 0 disables extrapolation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Vehicle - Network", meta = (ClampMin = "0"))
+	float NetMaxExtrapolationTime = 0.25f;
+
 	FNetState LerpStartState;
 	bool CreateNewStartState = true;
 	float LastActiveTimestamp = 0;
+	FNetState LastAppliedState;
+	bool HasLastAppliedState = false;
 
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "VehicleSystemPlugin")
 	void SyncTrailerRotation(float DeltaTime);
+	//Without a hitch component SyncTrailerRotation is only called if the blueprint implements it
+	bool SyncTrailerInBlueprint = false;
+
+	/** The hitch on the vehicle itself, found at BeginPlay. Its trailer chain is sent with every state */
+	UPROPERTY(BlueprintReadOnly, Category = "Vehicle - Trailer")
+	UVehicleHitchComponent* Hitch = nullptr;
+	UVehicleHitchComponent* FindVehicleHitch() const;
 	
 	FTimerHandle NetSendTimer;
 	UFUNCTION()
@@ -172,11 +432,40 @@ public:
 	void SetShouldSyncWithServer(bool ShouldSync);
 	
 	void SetReplicationTimer(bool Enabled);
+	void SetNetSending(bool Sending);
 	FNetState CreateNetStateForNow();
+	void PrepareNetStateForSend(FNetState& State);
+	bool ResolveNetState(FNetState& State);
+	void ResetNetKeyframes();
+	void RecordNetStateSent(const FNetState& State);
+	//States and rest states from whoever runs the vehicle, to the server or straight to the relay when that is us
+	void SendNetState(const FNetState& State);
+	void SendRestState(const FNetState& State);
+	void RelayNetState(const FNetState& State);
+
+	//Server authoritative, driver side
+	void SendInputFrame();
+	void ReconcileWithServer(const FNetState& State, uint16 InputFrame);
+	void ApplyReconcileOffset(float DeltaTime);
+	FVehiclePredictionHistory PredictionHistory;
+	TArray<FVehicleInputFrame, TInlineAllocator<VEHICLE_NET_MAX_INPUT_FRAMES>> RecentInputs;
+	uint16 NextInputFrame = 0;
+	FVector ReconcileOffset = FVector::ZeroVector;
+	FQuat ReconcileRotation = FQuat::Identity;
+
+	//Server authoritative, server side
+	void ConsumeInputFrames(float DeltaTime);
+	void ResetServerAuthoritative();
+	TArray<FVehicleInputFrame> PendingInputs;
+	uint16 LastQueuedInputFrame = 0;
+	bool HasQueuedInput = false;
+	float InputConsumeTime = 0;
+	void ReceiveNetState(FNetState State);
 	void AddStateToQueue(FNetState StateToAdd);
 	void ClearQueue();
-	void CalculateTimestamps();
 	void SyncPhysics();
+	bool PrepareSyncPhysics(FVehicleNetInterpolationJob& Job);
+	void ApplySyncPhysics(const FVehicleNetInterpolationJob& Job);
 	void LerpToNetState(FNetState NextState, float CurrentServerTime);
 	void ApplyExactNetState(FNetState State);
 
@@ -186,8 +475,31 @@ public:
 		return World ? (World->GetNetMode() != NM_Client) : false;
 	}
 	
+	NetworkRoles CachedNetworkRole = NetworkRoles::None;
+	bool NetworkRoleDirty = true;
+
+	/** GetNetworkRole, only worked out again after possession or ownership changes */
+	NetworkRoles GetCachedNetworkRole()
+	{
+		if (NetworkRoleDirty)
+		{
+			CachedNetworkRole = GetNetworkRole();
+			NetworkRoleDirty = false;
+		}
+		return CachedNetworkRole;
+	}
+
+	void InvalidateNetworkRole()
+	{
+		NetworkRoleDirty = true;
+	}
+
 	NetworkRoles GetNetworkRole()
 	{
+		if(IsReplayProxy)
+		{
+			return NetworkRoles::Client;
+		}
 		if(IsLocallyControlled())
 		{
 			//I'm controlling this
@@ -237,6 +549,13 @@ public:
 		void Server_ReceiveRestState(FNetState State);
 		virtual bool Server_ReceiveRestState_Validate(FNetState State);
 		virtual void Server_ReceiveRestState_Implementation(FNetState State);
+	UFUNCTION(Server, unreliable, WithValidation)
+		void Server_ReceiveInput(FVehicleInputBundle Inputs);
+		virtual bool Server_ReceiveInput_Validate(FVehicleInputBundle Inputs);
+		virtual void Server_ReceiveInput_Implementation(FVehicleInputBundle Inputs);
+	UFUNCTION(Client, unreliable)
+		void Client_ReceiveServerState(FNetState State, uint16 InputFrame);
+		virtual void Client_ReceiveServerState_Implementation(FNetState State, uint16 InputFrame);
 	UFUNCTION(NetMulticast, reliable, WithValidation)
 		void Multicast_ChangedOwner();
 		virtual bool Multicast_ChangedOwner_Validate();
@@ -5,6 +5,8 @@
 
 #include "Modules/ModuleManager.h"
 
+VEHICLESYSTEMPLUGIN_API DECLARE_LOG_CATEGORY_EXTERN(LogVehicleSystem, Log, All);
+
 class FVehicleSystemPluginModule : public IModuleInterface
 {
 public:
@@ -0,0 +1,58 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+//"stat VehicleSystem" in game, the VehicleSystem category in CSV captures, and the Vehicle counters in Insights
+
+DECLARE_STATS_GROUP(TEXT("VehicleSystem"), STATGROUP_VehicleSystem, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_VehicleTick, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SyncPhysics"), STAT_VehicleSyncPhysics, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AddStateToQueue"), STAT_VehicleAddStateToQueue, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("NetStateSend"), STAT_VehicleNetStateSend, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SetVehicleLocation"), STAT_VehicleSetVehicleLocation, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick Subsystem"), STAT_VehicleTickSubsystem, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick Subsystem Compute"), STAT_VehicleTickSubsystemCompute, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Relay Flush"), STAT_VehicleRelayFlush, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Drivetrain"), STAT_VehicleDrivetrain, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Suspension"), STAT_VehicleSuspension, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Constraint Flush"), STAT_VehicleConstraintFlush, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+
+//Per frame, cleared every frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Queued States"), STAT_VehicleQueueDepth, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dropped States"), STAT_VehicleDroppedStates, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Late States"), STAT_VehicleLateStates, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Teleports"), STAT_VehicleTeleports, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rest Transitions"), STAT_VehicleRestTransitions, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bytes Sent"), STAT_VehicleBytesSent, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Constraint Updates"), STAT_VehicleConstraintUpdates, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+//Vehicles ticked by the tick subsystem
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Ticked Vehicles"), STAT_VehicleTicked, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+//Raycast wheels traced by the suspension subsystem
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Suspension Traces"), STAT_VehicleSuspensionTraces, STATGROUP_VehicleSystem, VEHICLESYSTEMPLUGIN_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(VEHICLESYSTEMPLUGIN_API, VehicleSystem);
+
+//Running totals in Insights
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleDroppedStates);
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleLateStates);
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleTeleports);
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleRestTransitions);
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleBytesSent);
+TRACE_DECLARE_INT_COUNTER_EXTERN(VehicleConstraintUpdates);
+
+/** Adds to a per frame stat, its CSV stat and its Insights total, Name is one of the counters above without the prefix */
+#define VEHICLE_COUNTER_ADD(Name, Amount) \
+	do \
+	{ \
+		const int32 VehicleCounterAmount = (int32)(Amount); \
+		INC_DWORD_STAT_BY(STAT_Vehicle##Name, VehicleCounterAmount); \
+		CSV_CUSTOM_STAT(VehicleSystem, Name, VehicleCounterAmount, ECsvCustomStatOp::Accumulate); \
+		TRACE_COUNTER_ADD(Vehicle##Name, VehicleCounterAmount); \
+	} while (0)
@@ -0,0 +1,71 @@
+// Copyright 2019-2020 Seven47 Software. All Rights Reserved.
+// Unauthorized copying of this file, via any medium is strictly prohibited
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VehicleNetInterpolation.h"
+#include "VehicleSystemBase.h"
+#include "VehicleTickSubsystem.generated.h"
+
+class UVehicleTickSubsystem;
+
+USTRUCT()
+struct FVehicleTickSubsystemTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UVehicleTickSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FVehicleTickSubsystemTickFunction> : public TStructOpsTypeTraitsBase2<FVehicleTickSubsystemTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Ticks every vehicle in the world in place of their own actor ticks.
+ * Runs pre physics like the actor ticks did, in three passes: prepare each vehicle on the game thread,
+ * compute every interpolated transform in parallel, then apply them all on the game thread.
+ */
+UCLASS()
+class VEHICLESYSTEMPLUGIN_API UVehicleTickSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/** Take over ticking this vehicle, its actor tick is disabled unless its blueprint uses Event Tick */
+	void RegisterVehicle(AVehicleSystemBase* Vehicle);
+	void UnregisterVehicle(AVehicleSystemBase* Vehicle);
+
+	void TickVehicles(float DeltaTime);
+
+	/** Below this many jobs the compute pass stays on the game thread */
+	static const int32 MinJobsForParallel = 16;
+
+private:
+	void Compact();
+
+	FVehicleTickSubsystemTickFunction TickFunction;
+
+	//Parallel arrays indexed by each vehicle's TickSlot, swap removed
+	UPROPERTY()
+	TArray<AVehicleSystemBase*> Vehicles;
+	TArray<FVehicleNetInterpolationJob> Jobs;
+
+	//Vehicles unregistered mid tick are nulled and removed afterwards
+	bool Ticking = false;
+	bool NeedsCompact = false;
+};
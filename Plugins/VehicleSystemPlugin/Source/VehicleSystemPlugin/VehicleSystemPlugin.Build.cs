@@ -11,7 +11,7 @@ public class VehicleSystemPlugin : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Projects", "Core", "CoreUObject", "Engine", "InputCore" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "PhysicsCore" });
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
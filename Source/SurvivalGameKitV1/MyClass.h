@@ -1,15 +0,0 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-
-/**
- * 
- */
-class SURVIVALGAMEKITV1_API MyClass
-{
-public:
-	MyClass();
-	~MyClass();
-};
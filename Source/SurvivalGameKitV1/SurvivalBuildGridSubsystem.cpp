@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalBuildGridSubsystem.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "SurvivalGameKitV1.h"
+
+static FAutoConsoleCommand SurvivalBuildGridBenchmarkCommand(
+	TEXT("Survival.BuildGrid.Benchmark"),
+	TEXT("Times adding, snapping, overlap tests and removal on a square base of foundations. Survival.BuildGrid.Benchmark [parts] [queries]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 NumParts = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000, 1);
+		const int32 NumQueries = FMath::Max(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100000, 1);
+		const float PartSize = 300.0f;
+		const int32 Side = FMath::CeilToInt(FMath::Sqrt(float(NumParts)));
+		const FName FoundationSocket(TEXT("Foundation"));
+		const FName WallSocket(TEXT("Wall"));
+		const FVector Edges[] = { FVector(1, 0, 0), FVector(-1, 0, 0), FVector(0, 1, 0), FVector(0, -1, 0) };
+
+		FSurvivalBuildGridIndex Index(PartSize);
+		TArray<int32> PartIds;
+		PartIds.Reserve(NumParts);
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumParts; i++)
+		{
+			const FVector Center((i % Side) * PartSize, (i / Side) * PartSize, 0);
+			const int32 PartId = Index.AddPart(FBox::BuildAABB(Center, FVector(PartSize * 0.5f, PartSize * 0.5f, 10.0f)));
+			for (const FVector& Edge : Edges)
+			{
+				Index.AddSocket(FoundationSocket, Center + Edge * PartSize, PartId);
+				Index.AddSocket(WallSocket, Center + Edge * PartSize * 0.5f, PartId);
+			}
+			PartIds.Add(PartId);
+		}
+		const double AddTime = FPlatformTime::Seconds() - StartTime;
+
+		FRandomStream Random(NumParts);
+		const float Extent = Side * PartSize;
+		TArray<FVector> Locations;
+		Locations.SetNumUninitialized(NumQueries);
+		for (FVector& Location : Locations)
+		{
+			Location = FVector(Random.FRandRange(0, Extent), Random.FRandRange(0, Extent), Random.FRandRange(-50.0f, 50.0f));
+		}
+
+		int32 Found = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Location : Locations)
+		{
+			Found += Index.FindNearestSocket(WallSocket, Location, PartSize * 0.5f) != INDEX_NONE;
+		}
+		const double SnapTime = FPlatformTime::Seconds() - StartTime;
+
+		int32 Blocked = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const FVector& Location : Locations)
+		{
+			Blocked += Index.IsOverlapping(FBox::BuildAABB(Location, FVector(PartSize * 0.5f, PartSize * 0.5f, 10.0f)));
+		}
+		const double OverlapTime = FPlatformTime::Seconds() - StartTime;
+
+		const int32 NumSockets = Index.NumSockets();
+		StartTime = FPlatformTime::Seconds();
+		for (int32 PartId : PartIds)
+		{
+			Index.RemovePart(PartId);
+		}
+		const double RemoveTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogSurvivalGame, Display, TEXT("Build grid: %d parts, %d sockets. Add %.2f us/part, snap %.0f ns/query (%d found), overlap %.0f ns/query (%d blocked), remove %.2f us/part"),
+			NumParts, NumSockets, AddTime * 1e6 / NumParts, SnapTime * 1e9 / NumQueries, Found, OverlapTime * 1e9 / NumQueries, Blocked, RemoveTime * 1e6 / NumParts);
+	}));
+
+FSurvivalBuildGridIndex::FSurvivalBuildGridIndex(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+{
+}
+
+FIntVector FSurvivalBuildGridIndex::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+int32 FSurvivalBuildGridIndex::AddPart(const FBox& Bounds)
+{
+	FPart Part;
+	Part.Bounds = Bounds;
+	const int32 PartId = Parts.Add(MoveTemp(Part));
+
+	const FIntVector Min = GetCell(Bounds.Min);
+	const FIntVector Max = GetCell(Bounds.Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				PartCells.FindOrAdd(FIntVector(X, Y, Z)).Add(PartId);
+			}
+		}
+	}
+	return PartId;
+}
+
+void FSurvivalBuildGridIndex::RemovePart(int32 PartId)
+{
+	if (!Parts.IsValidIndex(PartId))
+	{
+		return;
+	}
+
+	const TArray<int32> PartSockets = MoveTemp(Parts[PartId].Sockets);
+	for (int32 SocketId : PartSockets)
+	{
+		RemoveSocket(SocketId);
+	}
+
+	const FBox& Bounds = Parts[PartId].Bounds;
+	const FIntVector Min = GetCell(Bounds.Min);
+	const FIntVector Max = GetCell(Bounds.Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FIntVector Cell(X, Y, Z);
+				FCellEntries* Entries = PartCells.Find(Cell);
+				if (Entries)
+				{
+					Entries->RemoveSingleSwap(PartId, false);
+					if (Entries->Num() == 0)
+					{
+						PartCells.Remove(Cell);
+					}
+				}
+			}
+		}
+	}
+	Parts.RemoveAt(PartId);
+}
+
+int32 FSurvivalBuildGridIndex::AddSocket(FName SocketType, const FVector& Location, int32 PartId)
+{
+	FSocket Socket;
+	Socket.Location = Location;
+	Socket.SocketType = SocketType;
+	Socket.PartId = Parts.IsValidIndex(PartId) ? PartId : INDEX_NONE;
+	const int32 SocketId = Sockets.Add(Socket);
+
+	SocketCells.FindOrAdd(FSocketCell{ GetCell(Location), SocketType }).Add(SocketId);
+	if (Socket.PartId != INDEX_NONE)
+	{
+		Parts[PartId].Sockets.Add(SocketId);
+	}
+	return SocketId;
+}
+
+void FSurvivalBuildGridIndex::RemoveSocket(int32 SocketId)
+{
+	if (!Sockets.IsValidIndex(SocketId))
+	{
+		return;
+	}
+
+	const FSocket& Socket = Sockets[SocketId];
+	const FSocketCell Key{ GetCell(Socket.Location), Socket.SocketType };
+	if (FCellEntries* Entries = SocketCells.Find(Key))
+	{
+		Entries->RemoveSingleSwap(SocketId, false);
+		if (Entries->Num() == 0)
+		{
+			SocketCells.Remove(Key);
+		}
+	}
+	if (Parts.IsValidIndex(Socket.PartId))
+	{
+		Parts[Socket.PartId].Sockets.RemoveSingleSwap(SocketId, false);
+	}
+	Sockets.RemoveAt(SocketId);
+}
+
+void FSurvivalBuildGridIndex::Reset()
+{
+	Sockets.Empty();
+	Parts.Empty();
+	SocketCells.Empty();
+	PartCells.Empty();
+}
+
+int32 FSurvivalBuildGridIndex::FindNearestSocket(FName SocketType, const FVector& Location, float MaxDistance, int32 IgnorePart) const
+{
+	const FIntVector Min = GetCell(Location - FVector(MaxDistance));
+	const FIntVector Max = GetCell(Location + FVector(MaxDistance));
+	float BestDistanceSquared = FMath::Square(MaxDistance);
+	int32 Best = INDEX_NONE;
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FCellEntries* Entries = SocketCells.Find(FSocketCell{ FIntVector(X, Y, Z), SocketType });
+				if (!Entries)
+				{
+					continue;
+				}
+				for (int32 SocketId : *Entries)
+				{
+					const FSocket& Socket = Sockets[SocketId];
+					const float DistanceSquared = FVector::DistSquared(Socket.Location, Location);
+					if (DistanceSquared <= BestDistanceSquared && (IgnorePart == INDEX_NONE || Socket.PartId != IgnorePart))
+					{
+						BestDistanceSquared = DistanceSquared;
+						Best = SocketId;
+					}
+				}
+			}
+		}
+	}
+	return Best;
+}
+
+bool FSurvivalBuildGridIndex::IsOverlapping(const FBox& Bounds, int32 IgnorePart, float Tolerance) const
+{
+	//Parts that only touch, like a wall on a foundation, don't block
+	const FBox Query = Bounds.ExpandBy(-Tolerance);
+	if (Query.Min.X > Query.Max.X || Query.Min.Y > Query.Max.Y || Query.Min.Z > Query.Max.Z)
+	{
+		return false;
+	}
+
+	const FIntVector Min = GetCell(Query.Min);
+	const FIntVector Max = GetCell(Query.Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FCellEntries* Entries = PartCells.Find(FIntVector(X, Y, Z));
+				if (!Entries)
+				{
+					continue;
+				}
+				for (int32 PartId : *Entries)
+				{
+					if (PartId != IgnorePart && Parts[PartId].Bounds.Intersect(Query))
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void FSurvivalBuildGridIndex::FindParts(const FBox& Bounds, TArray<int32>& OutParts) const
+{
+	const FIntVector Min = GetCell(Bounds.Min);
+	const FIntVector Max = GetCell(Bounds.Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FCellEntries* Entries = PartCells.Find(FIntVector(X, Y, Z));
+				if (!Entries)
+				{
+					continue;
+				}
+				for (int32 PartId : *Entries)
+				{
+					//Parts spanning several cells are found once
+					if (Parts[PartId].Bounds.Intersect(Bounds))
+					{
+						OutParts.AddUnique(PartId);
+					}
+				}
+			}
+		}
+	}
+}
+
+void USurvivalBuildGridSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Index = FSurvivalBuildGridIndex(CellSize);
+}
+
+void USurvivalBuildGridSubsystem::Deinitialize()
+{
+	Index.Reset();
+	PartIds.Reset();
+	PartActors.Reset();
+	SocketIds.Reset();
+	SocketActors.Reset();
+	Super::Deinitialize();
+}
+
+FName USurvivalBuildGridSubsystem::GetSocketType(const AActor* Grid, FName SocketType)
+{
+	return SocketType.IsNone() ? Grid->GetClass()->GetFName() : SocketType;
+}
+
+int32 USurvivalBuildGridSubsystem::FindPartId(const AActor* Part) const
+{
+	const int32* PartId = Part ? PartIds.Find(Part) : nullptr;
+	return PartId ? *PartId : INDEX_NONE;
+}
+
+void USurvivalBuildGridSubsystem::RegisterPart(AActor* Part)
+{
+	if (!Part || PartIds.Contains(Part))
+	{
+		return;
+	}
+	//Grid actors are their own actors, so only the part's own collision is in its bounds
+	const int32 PartId = Index.AddPart(Part->GetComponentsBoundingBox(false));
+	if (PartActors.Num() <= PartId)
+	{
+		PartActors.SetNum(PartId + 1);
+	}
+	PartActors[PartId] = Part;
+	PartIds.Add(Part, PartId);
+}
+
+void USurvivalBuildGridSubsystem::UnregisterPart(AActor* Part)
+{
+	int32 PartId;
+	if (!PartIds.RemoveAndCopyValue(Part, PartId))
+	{
+		return;
+	}
+	for (int32 SocketId : Index.GetPartSockets(PartId))
+	{
+		SocketIds.Remove(SocketActors[SocketId].Key);
+		SocketActors[SocketId] = FSocketActor();
+	}
+	Index.RemovePart(PartId);
+	PartActors[PartId] = nullptr;
+}
+
+void USurvivalBuildGridSubsystem::RegisterSocket(AActor* Grid, FName SocketType)
+{
+	if (!Grid || SocketIds.Contains(Grid))
+	{
+		return;
+	}
+
+	const AActor* Part = Grid->GetParentActor() ? Grid->GetParentActor() : Grid->GetAttachParentActor();
+	const int32 SocketId = Index.AddSocket(GetSocketType(Grid, SocketType), Grid->GetActorLocation(), FindPartId(Part));
+	if (SocketActors.Num() <= SocketId)
+	{
+		SocketActors.SetNum(SocketId + 1);
+	}
+	SocketActors[SocketId].Actor = Grid;
+	SocketActors[SocketId].Key = Grid;
+	SocketIds.Add(Grid, SocketId);
+}
+
+void USurvivalBuildGridSubsystem::UnregisterSocket(AActor* Grid)
+{
+	int32 SocketId;
+	if (!SocketIds.RemoveAndCopyValue(Grid, SocketId))
+	{
+		return;
+	}
+	Index.RemoveSocket(SocketId);
+	SocketActors[SocketId] = FSocketActor();
+}
+
+bool USurvivalBuildGridSubsystem::FindSnapSocket(FName SocketType, FVector Location, float MaxDistance, AActor* IgnorePart, AActor*& Socket) const
+{
+	const int32 SocketId = Index.FindNearestSocket(SocketType, Location, MaxDistance, FindPartId(IgnorePart));
+	Socket = SocketId != INDEX_NONE ? SocketActors[SocketId].Actor.Get() : nullptr;
+	return Socket != nullptr;
+}
+
+bool USurvivalBuildGridSubsystem::IsPlacementBlocked(FBox Bounds, AActor* IgnorePart, float Tolerance) const
+{
+	return Index.IsOverlapping(Bounds, FindPartId(IgnorePart), Tolerance);
+}
+
+void USurvivalBuildGridSubsystem::GetTouchingParts(AActor* Part, float Tolerance, TArray<AActor*>& OutParts) const
+{
+	OutParts.Reset();
+	const int32 PartId = FindPartId(Part);
+	if (!Part)
+	{
+		return;
+	}
+
+	TArray<int32> Found;
+	Index.FindParts(Part->GetComponentsBoundingBox(false).ExpandBy(Tolerance), Found);
+	for (int32 FoundId : Found)
+	{
+		AActor* FoundPart = FoundId != PartId ? PartActors[FoundId].Get() : nullptr;
+		if (FoundPart)
+		{
+			OutParts.Add(FoundPart);
+		}
+	}
+}
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SurvivalBuildGridSubsystem.generated.h"
+
+/**
+ * Build sockets and part bounds hashed by cell, sockets also by type.
+ * A snap or overlap query only reads the few cells around it, however big the base is.
+ */
+class SURVIVALGAMEKITV1_API FSurvivalBuildGridIndex
+{
+public:
+	struct FSocket
+	{
+		FVector Location;
+		FName SocketType;
+		int32 PartId = INDEX_NONE;
+	};
+
+	explicit FSurvivalBuildGridIndex(float InCellSize = 400.0f);
+
+	/** Bounds are axis aligned, shrink them by the overlap you allow */
+	int32 AddPart(const FBox& Bounds);
+	/** Also removes the part's sockets */
+	void RemovePart(int32 PartId);
+	/** PartId is the part the socket belongs to, INDEX_NONE for none */
+	int32 AddSocket(FName SocketType, const FVector& Location, int32 PartId = INDEX_NONE);
+	void RemoveSocket(int32 SocketId);
+	void Reset();
+
+	/** Nearest socket of the type within MaxDistance, INDEX_NONE when there isn't one */
+	int32 FindNearestSocket(FName SocketType, const FVector& Location, float MaxDistance, int32 IgnorePart = INDEX_NONE) const;
+	/** Whether Bounds overlaps a part's bounds by more than Tolerance */
+	bool IsOverlapping(const FBox& Bounds, int32 IgnorePart = INDEX_NONE, float Tolerance = 1.0f) const;
+	/** Every part whose bounds intersect Bounds */
+	void FindParts(const FBox& Bounds, TArray<int32>& OutParts) const;
+
+	const FSocket& GetSocket(int32 SocketId) const
+	{
+		return Sockets[SocketId];
+	}
+
+	const TArray<int32>& GetPartSockets(int32 PartId) const
+	{
+		return Parts[PartId].Sockets;
+	}
+
+	int32 NumParts() const
+	{
+		return Parts.Num();
+	}
+
+	int32 NumSockets() const
+	{
+		return Sockets.Num();
+	}
+
+private:
+	struct FPart
+	{
+		FBox Bounds;
+		TArray<int32> Sockets;
+	};
+
+	struct FSocketCell
+	{
+		FIntVector Cell;
+		FName SocketType;
+
+		bool operator==(const FSocketCell& Other) const
+		{
+			return Cell == Other.Cell && SocketType == Other.SocketType;
+		}
+
+		friend uint32 GetTypeHash(const FSocketCell& Key)
+		{
+			return HashCombine(GetTypeHash(Key.Cell), GetTypeHash(Key.SocketType));
+		}
+	};
+
+	typedef TArray<int32, TInlineAllocator<4>> FCellEntries;
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	float CellSize;
+	TSparseArray<FSocket> Sockets;
+	TSparseArray<FPart> Parts;
+	TMap<FSocketCell, FCellEntries> SocketCells;
+	//A part is in every cell its bounds touch
+	TMap<FIntVector, FCellEntries> PartCells;
+};
+
+/**
+ * Native index of the build grid actors and build parts, so placement doesn't have to trace the Grid channel every frame.
+ * Grid actors register with RegisterSocket and parts with RegisterPart when they are placed, and unregister when demolished.
+ */
+UCLASS(config=Game)
+class SURVIVALGAMEKITV1_API USurvivalBuildGridSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Should be about the distance between sockets, so a snap query reads a handful of cells */
+	UPROPERTY(Config)
+	float CellSize = 400.0f;
+
+	/** Call when a part is placed, before its grid actors register */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void RegisterPart(AActor* Part);
+	/** Call when a part is demolished, its grid actors go with it */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void UnregisterPart(AActor* Part);
+
+	/** Adds a grid actor at its location. An empty SocketType uses its class name. It belongs to the registered part it is attached to */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void RegisterSocket(AActor* Grid, FName SocketType = NAME_None);
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void UnregisterSocket(AActor* Grid);
+
+	/** The closest grid actor of the type within MaxDistance, ignoring IgnorePart's own */
+	UFUNCTION(BlueprintCallable, Category = "Building", meta = (ReturnDisplayName = "Found"))
+	bool FindSnapSocket(FName SocketType, FVector Location, float MaxDistance, AActor* IgnorePart, AActor*& Socket) const;
+
+	/** Whether a part with these world bounds would overlap a placed part by more than Tolerance */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	bool IsPlacementBlocked(FBox Bounds, AActor* IgnorePart, float Tolerance = 1.0f) const;
+
+	/** Registered parts within Tolerance of Part's bounds, like the foundation a wall stands on */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void GetTouchingParts(AActor* Part, float Tolerance, TArray<AActor*>& OutParts) const;
+
+	const FSurvivalBuildGridIndex& GetIndex() const
+	{
+		return Index;
+	}
+
+private:
+	static FName GetSocketType(const AActor* Grid, FName SocketType);
+	int32 FindPartId(const AActor* Part) const;
+
+	FSurvivalBuildGridIndex Index;
+	TMap<const AActor*, int32> PartIds;
+	//By part id
+	TArray<TWeakObjectPtr<AActor>> PartActors;
+	TMap<const AActor*, int32> SocketIds;
+	//By socket id, the index only knows locations. The key stays to clean up SocketIds after the actor is gone
+	struct FSocketActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		const AActor* Key = nullptr;
+	};
+	TArray<FSocketActor> SocketActors;
+};
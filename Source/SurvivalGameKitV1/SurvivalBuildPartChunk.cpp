@@ -0,0 +1,449 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalBuildPartChunk.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "SurvivalBuildPartSubsystem.h"
+#include "SurvivalGameKitV1.h"
+#include "SurvivalSaveComponent.h"
+#include "SurvivalSaveSubsystem.h"
+
+namespace SurvivalBuildParts
+{
+	//Hidden instances keep their place so the component's bounds and tree don't change
+	FTransform GetHiddenTransform(const FTransform& Transform)
+	{
+		return FTransform(Transform.GetRotation(), Transform.GetLocation(), FVector::ZeroVector);
+	}
+}
+
+void FSurvivalBuildPartArray::PreReplicatedRemove(const TArrayView<int32>& RemovedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		for (int32 ItemIndex : RemovedIndices)
+		{
+			Owner->FreeInstance(Items[ItemIndex]);
+		}
+	}
+}
+
+void FSurvivalBuildPartArray::PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		for (int32 ItemIndex : AddedIndices)
+		{
+			Owner->UpdateInstance(Items[ItemIndex]);
+		}
+	}
+}
+
+void FSurvivalBuildPartArray::PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		for (int32 ItemIndex : ChangedIndices)
+		{
+			Owner->UpdateInstance(Items[ItemIndex]);
+		}
+	}
+}
+
+ASurvivalBuildPartChunk::ASurvivalBuildPartChunk()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+	bReplicates = true;
+	//Parts change rarely and every change forces an update
+	NetUpdateFrequency = 1.0f;
+	NetCullDistanceSquared = FMath::Square(30000.0f);
+	SetCanBeDamaged(true);
+}
+
+void ASurvivalBuildPartChunk::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Parts.Owner = this;
+}
+
+void ASurvivalBuildPartChunk::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(ASurvivalBuildPartChunk, Parts);
+}
+
+void ASurvivalBuildPartChunk::BeginPlay()
+{
+	Super::BeginPlay();
+	if (HasAuthority())
+	{
+		//Saved chunks get their parts and coordinate back here
+		if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+		{
+			SaveSubsystem->Register(this);
+		}
+		if (USurvivalBuildPartSubsystem* BuildParts = GetWorld()->GetSubsystem<USurvivalBuildPartSubsystem>())
+		{
+			BuildParts->RegisterChunk(this);
+		}
+	}
+}
+
+void ASurvivalBuildPartChunk::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const TPair<int32, AActor*>& Promoted : PromotedActors)
+	{
+		if (Promoted.Value)
+		{
+			Promoted.Value->OnDestroyed.RemoveDynamic(this, &ASurvivalBuildPartChunk::PromotedActorDestroyed);
+		}
+	}
+	if (HasAuthority())
+	{
+		if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+		{
+			SaveSubsystem->Unregister(this, EndPlayReason == EEndPlayReason::Destroyed);
+		}
+		if (USurvivalBuildPartSubsystem* BuildParts = GetWorld()->GetSubsystem<USurvivalBuildPartSubsystem>())
+		{
+			BuildParts->UnregisterChunk(this);
+		}
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+FSurvivalBuildMeshGroup& ASurvivalBuildPartChunk::GetMeshGroup(UStaticMesh* Mesh)
+{
+	FSurvivalBuildMeshGroup& Group = MeshGroups.FindOrAdd(Mesh);
+	if (!Group.Component)
+	{
+		Group.Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		Group.Component->SetStaticMesh(Mesh);
+		Group.Component->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		Group.Component->SetupAttachment(RootComponent);
+		Group.Component->RegisterComponent();
+	}
+	return Group;
+}
+
+void ASurvivalBuildPartChunk::UpdateInstance(FSurvivalBuildPartEntry& Entry)
+{
+	if (!Entry.Mesh)
+	{
+		return;
+	}
+
+	FSurvivalBuildMeshGroup& Group = GetMeshGroup(Entry.Mesh);
+	const FTransform Transform = Entry.bPromoted ? SurvivalBuildParts::GetHiddenTransform(Entry.Transform) : Entry.Transform;
+	if (Entry.InstanceIndex != INDEX_NONE)
+	{
+		Group.Component->UpdateInstanceTransform(Entry.InstanceIndex, Transform, true, true, true);
+		return;
+	}
+
+	if (Group.FreeInstances.Num() > 0)
+	{
+		Entry.InstanceIndex = Group.FreeInstances.Pop(false);
+		Group.Component->UpdateInstanceTransform(Entry.InstanceIndex, Transform, true, true, true);
+	}
+	else
+	{
+		Entry.InstanceIndex = Group.Component->AddInstanceWorldSpace(Transform);
+		if (Group.PartIds.Num() <= Entry.InstanceIndex)
+		{
+			Group.PartIds.SetNum(Entry.InstanceIndex + 1);
+		}
+	}
+	Group.PartIds[Entry.InstanceIndex] = Entry.PartId;
+}
+
+void ASurvivalBuildPartChunk::FreeInstance(FSurvivalBuildPartEntry& Entry)
+{
+	FSurvivalBuildMeshGroup* Group = Entry.Mesh ? MeshGroups.Find(Entry.Mesh) : nullptr;
+	if (!Group || !Group->Component || Entry.InstanceIndex == INDEX_NONE)
+	{
+		return;
+	}
+	Group->Component->UpdateInstanceTransform(Entry.InstanceIndex, SurvivalBuildParts::GetHiddenTransform(Entry.Transform), true, true, true);
+	Group->PartIds[Entry.InstanceIndex] = INDEX_NONE;
+	Group->FreeInstances.Add(Entry.InstanceIndex);
+	Entry.InstanceIndex = INDEX_NONE;
+}
+
+FSurvivalBuildPartEntry* ASurvivalBuildPartChunk::FindPart(int32 PartId)
+{
+	const int32* ItemIndex = PartLookup.Find(PartId);
+	return ItemIndex ? &Parts.Items[*ItemIndex] : nullptr;
+}
+
+void ASurvivalBuildPartChunk::RebuildPartLookup()
+{
+	PartLookup.Reset();
+	for (int32 i = 0; i < Parts.Items.Num(); i++)
+	{
+		PartLookup.Add(Parts.Items[i].PartId, i);
+	}
+}
+
+void ASurvivalBuildPartChunk::PartsChanged()
+{
+	if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+	{
+		SaveSubsystem->MarkDirty(this);
+	}
+	ForceNetUpdate();
+}
+
+int32 ASurvivalBuildPartChunk::AddPart(TSubclassOf<AActor> PartClass, UStaticMesh* Mesh, const FTransform& Transform, float Health)
+{
+	if (!HasAuthority() || !Mesh)
+	{
+		return INDEX_NONE;
+	}
+
+	FSurvivalBuildPartEntry& Entry = Parts.Items.AddDefaulted_GetRef();
+	Entry.PartId = NextPartId++;
+	Entry.PartClass = PartClass;
+	Entry.Mesh = Mesh;
+	Entry.Transform = Transform;
+	Entry.Health = Health;
+	PartLookup.Add(Entry.PartId, Parts.Items.Num() - 1);
+	UpdateInstance(Entry);
+	Parts.MarkItemDirty(Entry);
+	PartsChanged();
+	return Entry.PartId;
+}
+
+void ASurvivalBuildPartChunk::RemovePart(int32 PartId)
+{
+	const int32* ItemIndex = PartLookup.Find(PartId);
+	if (HasAuthority() && ItemIndex)
+	{
+		RemovePartAt(*ItemIndex);
+	}
+}
+
+void ASurvivalBuildPartChunk::RemovePartAt(int32 ItemIndex)
+{
+	const int32 PartId = Parts.Items[ItemIndex].PartId;
+	AActor* Promoted = nullptr;
+	if (PromotedActors.RemoveAndCopyValue(PartId, Promoted) && Promoted)
+	{
+		Promoted->OnDestroyed.RemoveDynamic(this, &ASurvivalBuildPartChunk::PromotedActorDestroyed);
+		Promoted->Destroy();
+	}
+
+	FreeInstance(Parts.Items[ItemIndex]);
+	PartLookup.Remove(PartId);
+	Parts.Items.RemoveAtSwap(ItemIndex, 1, false);
+	if (ItemIndex < Parts.Items.Num())
+	{
+		PartLookup.Add(Parts.Items[ItemIndex].PartId, ItemIndex);
+	}
+	Parts.MarkArrayDirty();
+	PartsChanged();
+	OnPartRemoved.Broadcast(this, PartId);
+}
+
+bool ASurvivalBuildPartChunk::DamagePart(int32 PartId, float Damage)
+{
+	FSurvivalBuildPartEntry* Entry = HasAuthority() ? FindPart(PartId) : nullptr;
+	if (!Entry || Damage <= 0)
+	{
+		return false;
+	}
+
+	Entry->Health -= Damage;
+	if (Entry->Health <= 0)
+	{
+		RemovePart(PartId);
+		return true;
+	}
+	Parts.MarkItemDirty(*Entry);
+	PartsChanged();
+	return false;
+}
+
+AActor* ASurvivalBuildPartChunk::PromotePart(int32 PartId)
+{
+	FSurvivalBuildPartEntry* Entry = HasAuthority() ? FindPart(PartId) : nullptr;
+	if (!Entry || !Entry->PartClass)
+	{
+		return nullptr;
+	}
+	if (AActor* Existing = PromotedActors.FindRef(PartId))
+	{
+		return Existing;
+	}
+
+	FActorSpawnParameters Params;
+	Params.Owner = this;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* PartActor = GetWorld()->SpawnActor<AActor>(Entry->PartClass, Entry->Transform, Params);
+	if (!PartActor)
+	{
+		return nullptr;
+	}
+	PartActor->OnDestroyed.AddDynamic(this, &ASurvivalBuildPartChunk::PromotedActorDestroyed);
+	PromotedActors.Add(PartId, PartActor);
+
+	//The actor's BeginPlay may have added parts
+	Entry = FindPart(PartId);
+	if (Entry->Payload.Num() > 0)
+	{
+		FMemoryReader Reader(Entry->Payload);
+		USurvivalSaveComponent::ReadActorState(PartActor, Reader);
+	}
+	Entry->bPromoted = true;
+	UpdateInstance(*Entry);
+	Parts.MarkItemDirty(*Entry);
+	ForceNetUpdate();
+	return PartActor;
+}
+
+void ASurvivalBuildPartChunk::DemotePart(AActor* PartActor)
+{
+	const int32* FoundId = PartActor && HasAuthority() ? PromotedActors.FindKey(PartActor) : nullptr;
+	if (!FoundId)
+	{
+		return;
+	}
+	const int32 PartId = *FoundId;
+	if (FSurvivalBuildPartEntry* Entry = FindPart(PartId))
+	{
+		Entry->Payload.Reset();
+		FMemoryWriter Writer(Entry->Payload);
+		USurvivalSaveComponent::WriteActorState(PartActor, Writer);
+	}
+	PromotedActors.Remove(PartId);
+	PartActor->OnDestroyed.RemoveDynamic(this, &ASurvivalBuildPartChunk::PromotedActorDestroyed);
+	PartActor->Destroy();
+
+	//The actor's EndPlay may have removed parts
+	if (FSurvivalBuildPartEntry* Entry = FindPart(PartId))
+	{
+		Entry->bPromoted = false;
+		UpdateInstance(*Entry);
+		Parts.MarkItemDirty(*Entry);
+		PartsChanged();
+	}
+}
+
+void ASurvivalBuildPartChunk::PromotedActorDestroyed(AActor* PartActor)
+{
+	//Destroyed by anything but DemotePart, so the part is gone
+	const int32* FoundId = PromotedActors.FindKey(PartActor);
+	if (FoundId)
+	{
+		const int32 PartId = *FoundId;
+		PromotedActors.Remove(PartId);
+		RemovePart(PartId);
+	}
+}
+
+int32 ASurvivalBuildPartChunk::GetPartFromHit(const FHitResult& Hit) const
+{
+	const UHierarchicalInstancedStaticMeshComponent* Component = Cast<UHierarchicalInstancedStaticMeshComponent>(Hit.GetComponent());
+	if (!Component || Component->GetOwner() != this)
+	{
+		return INDEX_NONE;
+	}
+	const FSurvivalBuildMeshGroup* Group = MeshGroups.Find(Component->GetStaticMesh());
+	return Group && Group->PartIds.IsValidIndex(Hit.Item) ? Group->PartIds[Hit.Item] : INDEX_NONE;
+}
+
+float ASurvivalBuildPartChunk::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	const float ActualDamage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	if (HasAuthority())
+	{
+		FHitResult Hit;
+		FVector Direction;
+		DamageEvent.GetBestHitInfo(this, DamageCauser, Hit, Direction);
+		const int32 PartId = GetPartFromHit(Hit);
+		if (PartId != INDEX_NONE)
+		{
+			DamagePart(PartId, DamageAmount);
+		}
+	}
+	return ActualDamage;
+}
+
+void ASurvivalBuildPartChunk::WriteSaveState(FArchive& Ar)
+{
+	Ar << ChunkCoord << NextPartId;
+	int32 NumParts = Parts.Items.Num();
+	Ar << NumParts;
+	for (FSurvivalBuildPartEntry& Entry : Parts.Items)
+	{
+		FString ClassPath = Entry.PartClass ? Entry.PartClass->GetPathName() : FString();
+		FString MeshPath = Entry.Mesh->GetPathName();
+		Ar << Entry.PartId << ClassPath << MeshPath << Entry.Transform << Entry.Health;
+
+		//Promoted parts are saved as they are now, not as they were when last demoted
+		if (AActor* Promoted = PromotedActors.FindRef(Entry.PartId))
+		{
+			TArray<uint8> Payload;
+			FMemoryWriter Writer(Payload);
+			USurvivalSaveComponent::WriteActorState(Promoted, Writer);
+			Ar << Payload;
+		}
+		else
+		{
+			Ar << Entry.Payload;
+		}
+	}
+}
+
+void ASurvivalBuildPartChunk::ReadSaveState(FArchive& Ar, int32 Version)
+{
+	for (FSurvivalBuildPartEntry& Entry : Parts.Items)
+	{
+		FreeInstance(Entry);
+	}
+	Parts.Items.Reset();
+
+	int32 NumParts = 0;
+	Ar << ChunkCoord << NextPartId << NumParts;
+	TMap<FString, UClass*> Classes;
+	TMap<FString, UStaticMesh*> Meshes;
+	for (int32 i = 0; i < NumParts && !Ar.IsError(); i++)
+	{
+		FSurvivalBuildPartEntry Entry;
+		FString ClassPath;
+		FString MeshPath;
+		Ar << Entry.PartId << ClassPath << MeshPath << Entry.Transform << Entry.Health;
+		if (Version >= 2)
+		{
+			Ar << Entry.Payload;
+		}
+
+		UClass*& PartClass = Classes.FindOrAdd(ClassPath);
+		if (!PartClass && !ClassPath.IsEmpty())
+		{
+			PartClass = LoadClass<AActor>(nullptr, *ClassPath);
+		}
+		UStaticMesh*& Mesh = Meshes.FindOrAdd(MeshPath);
+		if (!Mesh)
+		{
+			Mesh = LoadObject<UStaticMesh>(nullptr, *MeshPath);
+		}
+		if (!Mesh)
+		{
+			UE_LOG(LogSurvivalGame, Warning, TEXT("Build parts: can't load %s, part %d is dropped"), *MeshPath, Entry.PartId);
+			continue;
+		}
+		Entry.PartClass = PartClass;
+		Entry.Mesh = Mesh;
+		UpdateInstance(Parts.Items.Add_GetRef(Entry));
+	}
+	RebuildPartLookup();
+	Parts.MarkArrayDirty();
+}
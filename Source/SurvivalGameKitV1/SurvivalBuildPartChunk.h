@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "SurvivalSaveable.h"
+#include "SurvivalBuildPartChunk.generated.h"
+
+class ASurvivalBuildPartChunk;
+class UHierarchicalInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/** A placed part drawn as an instance instead of an actor */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalBuildPartEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 PartId = INDEX_NONE;
+
+	/** Spawned when the part is promoted */
+	UPROPERTY()
+	TSubclassOf<AActor> PartClass;
+
+	UPROPERTY()
+	UStaticMesh* Mesh = nullptr;
+
+	UPROPERTY()
+	FTransform Transform;
+
+	UPROPERTY()
+	float Health = 0.0f;
+
+	/** A full actor stands in for the part, its instance is hidden */
+	UPROPERTY()
+	bool bPromoted = false;
+
+	/** The promoted actor's state from USurvivalSaveComponent::WriteActorState, kept while it is demoted. Server only */
+	UPROPERTY(NotReplicated)
+	TArray<uint8> Payload;
+
+	//Instance in its mesh's component, each machine has its own
+	UPROPERTY(NotReplicated)
+	int32 InstanceIndex = INDEX_NONE;
+};
+
+/** Parts are only added and removed whole, so only new, changed and removed parts are replicated */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalBuildPartArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FSurvivalBuildPartEntry> Items;
+
+	UPROPERTY(NotReplicated, Transient)
+	ASurvivalBuildPartChunk* Owner = nullptr;
+
+	void PreReplicatedRemove(const TArrayView<int32>& RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FSurvivalBuildPartEntry, FSurvivalBuildPartArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSurvivalBuildPartArray> : public TStructOpsTypeTraitsBase2<FSurvivalBuildPartArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/** One instanced component per mesh. Removed instances are hidden and reused, so no other instance changes index */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalBuildMeshGroup
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent* Component = nullptr;
+
+	//By instance index, INDEX_NONE for free instances
+	TArray<int32> PartIds;
+	TArray<int32> FreeInstances;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSurvivalBuildPartEvent, ASurvivalBuildPartChunk*, Chunk, int32, PartId);
+
+/**
+ * The build parts in one chunk of the world, drawn as instances of one component per mesh.
+ * A part becomes its full actor only while something needs it, like a door being used, and goes back afterwards.
+ * Damage to an instance is applied to the part here. The server saves the chunk through USurvivalSaveSubsystem.
+ */
+UCLASS(NotBlueprintable)
+class SURVIVALGAMEKITV1_API ASurvivalBuildPartChunk : public AActor, public ISurvivalSaveable
+{
+	GENERATED_BODY()
+
+public:
+	ASurvivalBuildPartChunk();
+
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+	//ISurvivalSaveable
+	virtual void WriteSaveState(FArchive& Ar) override;
+	virtual void ReadSaveState(FArchive& Ar, int32 Version) override;
+	virtual int32 GetSaveVersion() const override
+	{
+		return 2;
+	}
+
+	/** Called on the server when a part is removed or destroyed by damage */
+	UPROPERTY(BlueprintAssignable, Category = "Building")
+	FSurvivalBuildPartEvent OnPartRemoved;
+
+	/** Returns the new part's id */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building")
+	int32 AddPart(TSubclassOf<AActor> PartClass, UStaticMesh* Mesh, const FTransform& Transform, float Health);
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building")
+	void RemovePart(int32 PartId);
+	/** Returns whether the part was destroyed */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building")
+	bool DamagePart(int32 PartId, float Damage);
+
+	/** Spawns the part's actor in place of its instance and gives it back its state. Returns the actor that is already there if it was promoted */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building")
+	AActor* PromotePart(int32 PartId);
+	/** Keeps the promoted actor's state with its part, destroys it and shows its instance again */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building")
+	void DemotePart(AActor* PartActor);
+
+	/** The part a trace or damage hit, INDEX_NONE when it didn't hit one of our instances */
+	UFUNCTION(BlueprintPure, Category = "Building")
+	int32 GetPartFromHit(const FHitResult& Hit) const;
+
+	UFUNCTION(BlueprintPure, Category = "Building")
+	int32 GetNumParts() const
+	{
+		return Parts.Items.Num();
+	}
+
+	/** Set by USurvivalBuildPartSubsystem when it spawns the chunk */
+	FIntPoint ChunkCoord = FIntPoint::ZeroValue;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	friend struct FSurvivalBuildPartArray;
+
+	FSurvivalBuildPartEntry* FindPart(int32 PartId);
+	void RemovePartAt(int32 ItemIndex);
+	void RebuildPartLookup();
+	/** Replicates soon and saves with the next save */
+	void PartsChanged();
+
+	FSurvivalBuildMeshGroup& GetMeshGroup(UStaticMesh* Mesh);
+	/** Gives the entry an instance if it has none, hidden while it is promoted */
+	void UpdateInstance(FSurvivalBuildPartEntry& Entry);
+	void FreeInstance(FSurvivalBuildPartEntry& Entry);
+
+	UFUNCTION()
+	void PromotedActorDestroyed(AActor* PartActor);
+
+	UPROPERTY(Replicated)
+	FSurvivalBuildPartArray Parts;
+
+	UPROPERTY(Transient)
+	TMap<UStaticMesh*, FSurvivalBuildMeshGroup> MeshGroups;
+
+	//Server only
+	UPROPERTY(Transient)
+	TMap<int32, AActor*> PromotedActors;
+
+	//Part id to position in Parts.Items
+	TMap<int32, int32> PartLookup;
+	int32 NextPartId = 0;
+};
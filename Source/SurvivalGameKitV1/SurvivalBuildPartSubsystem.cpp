@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalBuildPartSubsystem.h"
+#include "Engine/World.h"
+#include "SurvivalBuildPartChunk.h"
+
+void USurvivalBuildPartSubsystem::Deinitialize()
+{
+	Chunks.Reset();
+	Super::Deinitialize();
+}
+
+FIntPoint USurvivalBuildPartSubsystem::GetChunkCoord(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / ChunkSize), FMath::FloorToInt(Location.Y / ChunkSize));
+}
+
+ASurvivalBuildPartChunk* USurvivalBuildPartSubsystem::GetChunkAt(FVector Location, bool bCreate)
+{
+	const FIntPoint Coord = GetChunkCoord(Location);
+	if (ASurvivalBuildPartChunk* Chunk = Chunks.FindRef(Coord).Get())
+	{
+		return Chunk;
+	}
+	UWorld* World = GetWorld();
+	if (!bCreate || !World || World->GetNetMode() == NM_Client)
+	{
+		return nullptr;
+	}
+
+	const FTransform Transform(FVector((Coord.X + 0.5f) * ChunkSize, (Coord.Y + 0.5f) * ChunkSize, Location.Z));
+	ASurvivalBuildPartChunk* Chunk = World->SpawnActorDeferred<ASurvivalBuildPartChunk>(ASurvivalBuildPartChunk::StaticClass(), Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Chunk)
+	{
+		return nullptr;
+	}
+	Chunk->ChunkCoord = Coord;
+	Chunk->FinishSpawning(Transform);
+	RegisterChunk(Chunk);
+	return Chunk;
+}
+
+FSurvivalBuildPartHandle USurvivalBuildPartSubsystem::PlacePart(TSubclassOf<AActor> PartClass, UStaticMesh* Mesh, FTransform Transform, float Health)
+{
+	FSurvivalBuildPartHandle Handle;
+	Handle.Chunk = GetChunkAt(Transform.GetLocation(), true);
+	if (Handle.Chunk)
+	{
+		Handle.PartId = Handle.Chunk->AddPart(PartClass, Mesh, Transform, Health);
+	}
+	return Handle;
+}
+
+FSurvivalBuildPartHandle USurvivalBuildPartSubsystem::GetPartFromHit(const FHitResult& Hit)
+{
+	FSurvivalBuildPartHandle Handle;
+	Handle.Chunk = Cast<ASurvivalBuildPartChunk>(Hit.GetActor());
+	if (Handle.Chunk)
+	{
+		Handle.PartId = Handle.Chunk->GetPartFromHit(Hit);
+	}
+	return Handle;
+}
+
+void USurvivalBuildPartSubsystem::RegisterChunk(ASurvivalBuildPartChunk* Chunk)
+{
+	//A chunk spawned before its saved one loaded keeps working, new parts go to the first one registered
+	TWeakObjectPtr<ASurvivalBuildPartChunk>& Existing = Chunks.FindOrAdd(Chunk->ChunkCoord);
+	if (!Existing.IsValid())
+	{
+		Existing = Chunk;
+	}
+}
+
+void USurvivalBuildPartSubsystem::UnregisterChunk(ASurvivalBuildPartChunk* Chunk)
+{
+	if (Chunks.FindRef(Chunk->ChunkCoord).Get() == Chunk)
+	{
+		Chunks.Remove(Chunk->ChunkCoord);
+	}
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SurvivalBuildPartSubsystem.generated.h"
+
+class ASurvivalBuildPartChunk;
+class UStaticMesh;
+
+/** A part in a build part chunk */
+USTRUCT(BlueprintType)
+struct SURVIVALGAMEKITV1_API FSurvivalBuildPartHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Building")
+	ASurvivalBuildPartChunk* Chunk = nullptr;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Building")
+	int32 PartId = INDEX_NONE;
+
+	bool IsValid() const
+	{
+		return Chunk && PartId != INDEX_NONE;
+	}
+};
+
+/**
+ * Places build parts as instances in one ASurvivalBuildPartChunk per square of the world, on the server.
+ * Interact with a part by promoting it on its chunk, and demote it when done.
+ */
+UCLASS(config=Game)
+class SURVIVALGAMEKITV1_API USurvivalBuildPartSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Width of a chunk, bigger chunks mean fewer actors but bigger updates when a part changes */
+	UPROPERTY(Config)
+	float ChunkSize = 5000.0f;
+
+	/** Adds the part to the chunk it stands in, spawning the chunk if needed */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	FSurvivalBuildPartHandle PlacePart(TSubclassOf<AActor> PartClass, UStaticMesh* Mesh, FTransform Transform, float Health = 100.0f);
+
+	/** The part a trace hit, invalid when it hit something else */
+	UFUNCTION(BlueprintPure, Category = "Building")
+	static FSurvivalBuildPartHandle GetPartFromHit(const FHitResult& Hit);
+
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	ASurvivalBuildPartChunk* GetChunkAt(FVector Location, bool bCreate);
+
+	void RegisterChunk(ASurvivalBuildPartChunk* Chunk);
+	void UnregisterChunk(ASurvivalBuildPartChunk* Chunk);
+
+private:
+	FIntPoint GetChunkCoord(const FVector& Location) const;
+
+	TMap<FIntPoint, TWeakObjectPtr<ASurvivalBuildPartChunk>> Chunks;
+};
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalFoliageResourceReplicator.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "SurvivalFoliageResourceSubsystem.h"
+
+void FSurvivalFoliageWordArray::PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		Owner->WordsReplicated(AddedIndices);
+	}
+}
+
+void FSurvivalFoliageWordArray::PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		Owner->WordsReplicated(ChangedIndices);
+	}
+}
+
+ASurvivalFoliageResourceReplicator::ASurvivalFoliageResourceReplicator()
+{
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	//Every harvest forces an update
+	NetUpdateFrequency = 1.0f;
+}
+
+void ASurvivalFoliageResourceReplicator::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Words.Owner = this;
+}
+
+void ASurvivalFoliageResourceReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(ASurvivalFoliageResourceReplicator, Words);
+}
+
+void ASurvivalFoliageResourceReplicator::BeginPlay()
+{
+	Super::BeginPlay();
+	if (!HasAuthority())
+	{
+		if (USurvivalFoliageResourceSubsystem* Foliage = GetWorld()->GetSubsystem<USurvivalFoliageResourceSubsystem>())
+		{
+			Foliage->SetReplicator(this);
+		}
+	}
+}
+
+void ASurvivalFoliageResourceReplicator::SetWord(UInstancedStaticMeshComponent* Component, int32 WordIndex, uint32 Bits)
+{
+	const TPair<const UInstancedStaticMeshComponent*, int32> Key(Component, WordIndex);
+	if (const int32* ItemIndex = WordLookup.Find(Key))
+	{
+		FSurvivalFoliageWord& Word = Words.Items[*ItemIndex];
+		if (Word.Bits != Bits)
+		{
+			Word.Bits = Bits;
+			Words.MarkItemDirty(Word);
+			ForceNetUpdate();
+		}
+		return;
+	}
+	if (Bits == 0)
+	{
+		return;
+	}
+
+	//Words are never removed, a regrown word is sent as 0
+	FSurvivalFoliageWord& Word = Words.Items.AddDefaulted_GetRef();
+	Word.Component = Component;
+	Word.WordIndex = WordIndex;
+	Word.Bits = Bits;
+	WordLookup.Add(Key, Words.Items.Num() - 1);
+	Words.MarkItemDirty(Word);
+	ForceNetUpdate();
+}
+
+void ASurvivalFoliageResourceReplicator::WordsReplicated(const TArrayView<int32>& ChangedIndices) const
+{
+	USurvivalFoliageResourceSubsystem* Foliage = GetWorld()->GetSubsystem<USurvivalFoliageResourceSubsystem>();
+	if (!Foliage)
+	{
+		return;
+	}
+	for (int32 ItemIndex : ChangedIndices)
+	{
+		const FSurvivalFoliageWord& Word = Words.Items[ItemIndex];
+		//Components in levels that aren't loaded here yet get their words when they register
+		if (Word.Component)
+		{
+			Foliage->ApplyReplicatedWord(Word.Component, Word.WordIndex, Word.Bits);
+		}
+	}
+}
+
+void ASurvivalFoliageResourceReplicator::ApplyWords(UInstancedStaticMeshComponent* Component) const
+{
+	USurvivalFoliageResourceSubsystem* Foliage = GetWorld()->GetSubsystem<USurvivalFoliageResourceSubsystem>();
+	if (!Foliage || !Component)
+	{
+		return;
+	}
+	for (const FSurvivalFoliageWord& Word : Words.Items)
+	{
+		if (Word.Component == Component)
+		{
+			Foliage->ApplyReplicatedWord(Component, Word.WordIndex, Word.Bits);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "SurvivalFoliageResourceReplicator.generated.h"
+
+class ASurvivalFoliageResourceReplicator;
+class UInstancedStaticMeshComponent;
+
+/** 32 instances' harvested bits of one foliage component */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalFoliageWord : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Component = nullptr;
+
+	UPROPERTY()
+	int32 WordIndex = 0;
+
+	UPROPERTY()
+	uint32 Bits = 0;
+};
+
+/** Only the words that changed are sent, joining clients get every word that was ever harvested */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalFoliageWordArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FSurvivalFoliageWord> Items;
+
+	UPROPERTY(NotReplicated, Transient)
+	ASurvivalFoliageResourceReplicator* Owner = nullptr;
+
+	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FSurvivalFoliageWord, FSurvivalFoliageWordArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSurvivalFoliageWordArray> : public TStructOpsTypeTraitsBase2<FSurvivalFoliageWordArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/** Spawned by USurvivalFoliageResourceSubsystem on the server to replicate harvested foliage to every client */
+UCLASS(NotBlueprintable, NotPlaceable, Transient)
+class SURVIVALGAMEKITV1_API ASurvivalFoliageResourceReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ASurvivalFoliageResourceReplicator();
+
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Server only */
+	void SetWord(UInstancedStaticMeshComponent* Component, int32 WordIndex, uint32 Bits);
+	/** Gives a component that loaded after its words arrived its harvested state */
+	void ApplyWords(UInstancedStaticMeshComponent* Component) const;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	friend struct FSurvivalFoliageWordArray;
+
+	void WordsReplicated(const TArrayView<int32>& ChangedIndices) const;
+
+	UPROPERTY(Replicated)
+	FSurvivalFoliageWordArray Words;
+
+	//Component and word index to position in Words.Items, server only
+	TMap<TPair<const UInstancedStaticMeshComponent*, int32>, int32> WordLookup;
+};
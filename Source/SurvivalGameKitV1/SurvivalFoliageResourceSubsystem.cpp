@@ -0,0 +1,453 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalFoliageResourceSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "SurvivalFoliageResourceReplicator.h"
+#include "SurvivalGameKitV1.h"
+#include "SurvivalSaveSubsystem.h"
+
+void FSurvivalTimerWheel::Schedule(uint64 Payload, uint32 DelayTicks)
+{
+	const uint32 Longest = MaxDelay;
+	FTimer Timer;
+	Timer.Payload = Payload;
+	Timer.Expiry = Now + FMath::Clamp<uint32>(DelayTicks, 1, Longest);
+	Insert(Timer);
+	NumTimers++;
+}
+
+void FSurvivalTimerWheel::Insert(const FTimer& Timer)
+{
+	//The lowest level whose turn reaches the expiry, due timers land in level 0's current slot
+	const uint32 Delta = Timer.Expiry - Now;
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= (1u << (SlotBits * (Level + 1))))
+	{
+		Level++;
+	}
+	Slots[Level][(Timer.Expiry >> (SlotBits * Level)) & (NumSlots - 1)].Add(Timer);
+}
+
+void FSurvivalTimerWheel::Advance(uint32 Ticks, TArray<uint64>& OutExpired)
+{
+	for (uint32 i = 0; i < Ticks; i++)
+	{
+		Now++;
+
+		//Every level whose turn starts now moves its slot down, highest first so nothing lands in a slot that was already moved
+		int32 Level = 0;
+		while (Level < NumLevels - 1 && (Now & ((1u << (SlotBits * (Level + 1))) - 1)) == 0)
+		{
+			Level++;
+		}
+		for (; Level > 0; Level--)
+		{
+			const TArray<FTimer> Cascade = MoveTemp(Slots[Level][(Now >> (SlotBits * Level)) & (NumSlots - 1)]);
+			for (const FTimer& Timer : Cascade)
+			{
+				Insert(Timer);
+			}
+		}
+
+		TArray<FTimer>& Due = Slots[0][Now & (NumSlots - 1)];
+		for (const FTimer& Timer : Due)
+		{
+			OutExpired.Add(Timer.Payload);
+		}
+		NumTimers -= Due.Num();
+		Due.Reset();
+	}
+}
+
+void FSurvivalTimerWheel::Reset()
+{
+	for (int32 Level = 0; Level < NumLevels; Level++)
+	{
+		for (int32 Slot = 0; Slot < NumSlots; Slot++)
+		{
+			Slots[Level][Slot].Empty();
+		}
+	}
+	Now = 0;
+	NumTimers = 0;
+}
+
+bool USurvivalFoliageResourceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void USurvivalFoliageResourceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	bInitialized = true;
+}
+
+void USurvivalFoliageResourceSubsystem::Deinitialize()
+{
+	if (bRegisteredForSave)
+	{
+		if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+		{
+			SaveSubsystem->Unregister(this, false);
+		}
+	}
+	bInitialized = false;
+	States.Reset();
+	StateIds.Reset();
+	StateIdsByComponent.Reset();
+	Regrowth.Reset();
+	DueRegrowth.Reset();
+	Replicator = nullptr;
+	Super::Deinitialize();
+}
+
+bool USurvivalFoliageResourceSubsystem::IsTickable() const
+{
+	return bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId USurvivalFoliageResourceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USurvivalFoliageResourceSubsystem, STATGROUP_Tickables);
+}
+
+bool USurvivalFoliageResourceSubsystem::IsServer() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Client;
+}
+
+void USurvivalFoliageResourceSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (!IsServer() || !World->HasBegunPlay())
+	{
+		return;
+	}
+
+	//The net mode isn't known when the subsystem is created
+	if (!Replicator)
+	{
+		Replicator = World->SpawnActor<ASurvivalFoliageResourceReplicator>();
+		for (int32 StateId = 0; StateId < States.Num(); StateId++)
+		{
+			const TBitArray<>& Harvested = States[StateId].Harvested;
+			for (int32 WordIndex = 0; WordIndex * 32 < Harvested.Num(); WordIndex++)
+			{
+				WordChanged(StateId, WordIndex * 32);
+			}
+		}
+	}
+	if (!bRegisteredForSave)
+	{
+		if (USurvivalSaveSubsystem* SaveSubsystem = World->GetSubsystem<USurvivalSaveSubsystem>())
+		{
+			SaveSubsystem->Register(this);
+		}
+		bRegisteredForSave = true;
+	}
+
+	RegrowthAccumulator += DeltaTime;
+	const float TickInterval = FMath::Max(RegrowthTickInterval, 0.01f);
+	const uint32 Ticks = FMath::FloorToInt(RegrowthAccumulator / TickInterval);
+	if (Ticks > 0)
+	{
+		RegrowthAccumulator -= Ticks * TickInterval;
+		Regrowth.Advance(Ticks, DueRegrowth);
+	}
+	ProcessRegrowth();
+}
+
+void USurvivalFoliageResourceSubsystem::ProcessRegrowth()
+{
+	const int32 NumToProcess = FMath::Min(DueRegrowth.Num(), MaxRegrowthsPerFrame);
+	if (NumToProcess <= 0)
+	{
+		return;
+	}
+
+	TSet<UInstancedStaticMeshComponent*> Changed;
+	for (int32 i = 0; i < NumToProcess; i++)
+	{
+		const uint64 Payload = DueRegrowth.Pop(false);
+		const int32 StateId = int32(Payload >> 32);
+		const int32 InstanceIndex = int32(Payload & 0xFFFFFFFF);
+		if (!States.IsValidIndex(StateId))
+		{
+			continue;
+		}
+		FFoliageState& State = States[StateId];
+		SetHarvested(State, InstanceIndex, false, false);
+		WordChanged(StateId, InstanceIndex);
+		if (UInstancedStaticMeshComponent* Component = State.Component.Get())
+		{
+			Changed.Add(Component);
+		}
+	}
+	for (UInstancedStaticMeshComponent* Component : Changed)
+	{
+		Component->MarkRenderStateDirty();
+	}
+
+	if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+	{
+		SaveSubsystem->MarkDirty(this);
+	}
+}
+
+int32 USurvivalFoliageResourceSubsystem::FindOrAddState(const FString& Key)
+{
+	if (const int32* StateId = StateIds.Find(Key))
+	{
+		return *StateId;
+	}
+	const int32 StateId = States.AddDefaulted();
+	States[StateId].Key = Key;
+	States[StateId].RegrowthTime = DefaultRegrowthTime;
+	StateIds.Add(Key, StateId);
+	return StateId;
+}
+
+int32 USurvivalFoliageResourceSubsystem::FindOrAddState(UInstancedStaticMeshComponent* Component)
+{
+	//A streamed out component's entry can outlive it, so the state has to still point at this one
+	const int32* FoundId = StateIdsByComponent.Find(Component);
+	if (FoundId && States[*FoundId].Component.Get() == Component)
+	{
+		return *FoundId;
+	}
+
+	const int32 StateId = FindOrAddState(UWorld::RemovePIEPrefix(Component->GetPathName()));
+	StateIdsByComponent.Add(Component, StateId);
+	FFoliageState& State = States[StateId];
+	State.Component = Component;
+
+	//Bits loaded before the component was, or a level that was streamed out and back in
+	const TBitArray<> Harvested = State.Harvested;
+	State.Harvested.Init(false, Component->GetInstanceCount());
+	State.HiddenTransforms.Reset();
+	bool bAnyHarvested = false;
+	for (TConstSetBitIterator<> It(Harvested); It; ++It)
+	{
+		SetHarvested(State, It.GetIndex(), true, false);
+		bAnyHarvested = true;
+	}
+	if (bAnyHarvested)
+	{
+		Component->MarkRenderStateDirty();
+	}
+	return StateId;
+}
+
+void USurvivalFoliageResourceSubsystem::SetHarvested(FFoliageState& State, int32 InstanceIndex, bool bHarvested, bool bMarkRenderStateDirty)
+{
+	if (!State.Harvested.IsValidIndex(InstanceIndex) || State.Harvested[InstanceIndex] == bHarvested)
+	{
+		return;
+	}
+	State.Harvested[InstanceIndex] = bHarvested;
+
+	UInstancedStaticMeshComponent* Component = State.Component.Get();
+	if (!Component)
+	{
+		return;
+	}
+	if (bHarvested)
+	{
+		//Scaled to nothing rather than removed, so no other instance changes index
+		FTransform Transform;
+		Component->GetInstanceTransform(InstanceIndex, Transform);
+		State.HiddenTransforms.Add(InstanceIndex, Transform);
+		Component->UpdateInstanceTransform(InstanceIndex, FTransform(Transform.GetRotation(), Transform.GetLocation(), FVector::ZeroVector), false, bMarkRenderStateDirty, true);
+	}
+	else
+	{
+		FTransform Transform;
+		if (State.HiddenTransforms.RemoveAndCopyValue(InstanceIndex, Transform))
+		{
+			Component->UpdateInstanceTransform(InstanceIndex, Transform, false, bMarkRenderStateDirty, true);
+		}
+	}
+}
+
+void USurvivalFoliageResourceSubsystem::ScheduleRegrowth(int32 StateId, int32 InstanceIndex)
+{
+	const float TickInterval = FMath::Max(RegrowthTickInterval, 0.01f);
+	const uint32 Ticks = FMath::CeilToInt(FMath::Max(States[StateId].RegrowthTime, 0.0f) / TickInterval);
+	Regrowth.Schedule((uint64(StateId) << 32) | uint32(InstanceIndex), Ticks);
+}
+
+void USurvivalFoliageResourceSubsystem::WordChanged(int32 StateId, int32 InstanceIndex)
+{
+	const FFoliageState& State = States[StateId];
+	UInstancedStaticMeshComponent* Component = State.Component.Get();
+	if (!Replicator || !Component)
+	{
+		return;
+	}
+
+	const int32 WordIndex = InstanceIndex / 32;
+	uint32 Bits = 0;
+	const int32 FirstBit = WordIndex * 32;
+	const int32 NumBits = FMath::Min(32, State.Harvested.Num() - FirstBit);
+	for (int32 Bit = 0; Bit < NumBits; Bit++)
+	{
+		Bits |= State.Harvested[FirstBit + Bit] ? 1u << Bit : 0;
+	}
+	Replicator->SetWord(Component, WordIndex, Bits);
+}
+
+void USurvivalFoliageResourceSubsystem::RegisterFoliage(UInstancedStaticMeshComponent* Component, float RegrowthTime)
+{
+	if (!Component)
+	{
+		return;
+	}
+	const int32* ExistingId = StateIdsByComponent.Find(Component);
+	const bool bNew = !ExistingId || States[*ExistingId].Component.Get() != Component;
+	const int32 StateId = FindOrAddState(Component);
+	States[StateId].RegrowthTime = RegrowthTime > 0 ? RegrowthTime : DefaultRegrowthTime;
+	if (!bNew)
+	{
+		return;
+	}
+
+	if (IsServer())
+	{
+		for (int32 WordIndex = 0; WordIndex * 32 < States[StateId].Harvested.Num(); WordIndex++)
+		{
+			WordChanged(StateId, WordIndex * 32);
+		}
+	}
+	else if (Replicator)
+	{
+		Replicator->ApplyWords(Component);
+	}
+}
+
+bool USurvivalFoliageResourceSubsystem::HarvestInstance(UInstancedStaticMeshComponent* Component, int32 InstanceIndex)
+{
+	if (!Component || !IsServer())
+	{
+		return false;
+	}
+	const int32 StateId = FindOrAddState(Component);
+	FFoliageState& State = States[StateId];
+	if (!State.Harvested.IsValidIndex(InstanceIndex) || State.Harvested[InstanceIndex])
+	{
+		return false;
+	}
+
+	SetHarvested(State, InstanceIndex, true, true);
+	ScheduleRegrowth(StateId, InstanceIndex);
+	WordChanged(StateId, InstanceIndex);
+	if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+	{
+		SaveSubsystem->MarkDirty(this);
+	}
+	return true;
+}
+
+bool USurvivalFoliageResourceSubsystem::IsHarvested(const UInstancedStaticMeshComponent* Component, int32 InstanceIndex) const
+{
+	const int32* StateId = StateIdsByComponent.Find(Component);
+	return StateId && States[*StateId].Component.Get() == Component && States[*StateId].Harvested.IsValidIndex(InstanceIndex) && States[*StateId].Harvested[InstanceIndex];
+}
+
+void USurvivalFoliageResourceSubsystem::SetReplicator(ASurvivalFoliageResourceReplicator* InReplicator)
+{
+	Replicator = InReplicator;
+	for (const TPair<const UInstancedStaticMeshComponent*, int32>& Pair : StateIdsByComponent)
+	{
+		if (UInstancedStaticMeshComponent* Component = States[Pair.Value].Component.Get())
+		{
+			Replicator->ApplyWords(Component);
+		}
+	}
+}
+
+void USurvivalFoliageResourceSubsystem::ApplyReplicatedWord(UInstancedStaticMeshComponent* Component, int32 WordIndex, uint32 Bits)
+{
+	FFoliageState& State = States[FindOrAddState(Component)];
+	const int32 FirstBit = WordIndex * 32;
+	const int32 NumBits = FMath::Min(32, State.Harvested.Num() - FirstBit);
+	bool bChanged = false;
+	for (int32 Bit = 0; Bit < NumBits; Bit++)
+	{
+		const bool bHarvested = (Bits & (1u << Bit)) != 0;
+		if (State.Harvested[FirstBit + Bit] != bHarvested)
+		{
+			SetHarvested(State, FirstBit + Bit, bHarvested, false);
+			bChanged = true;
+		}
+	}
+	if (bChanged)
+	{
+		Component->MarkRenderStateDirty();
+	}
+}
+
+void USurvivalFoliageResourceSubsystem::WriteSaveState(FArchive& Ar)
+{
+	int32 NumStates = States.Num();
+	Ar << NumStates;
+	for (FFoliageState& State : States)
+	{
+		int32 NumBits = State.Harvested.Num();
+		Ar << State.Key << NumBits;
+		if (NumBits > 0)
+		{
+			Ar.Serialize(State.Harvested.GetData(), FMath::DivideAndRoundUp(NumBits, 32) * sizeof(uint32));
+		}
+	}
+}
+
+void USurvivalFoliageResourceSubsystem::ReadSaveState(FArchive& Ar, int32 Version)
+{
+	int32 NumStates = 0;
+	Ar << NumStates;
+	for (int32 i = 0; i < NumStates && !Ar.IsError(); i++)
+	{
+		FString Key;
+		int32 NumBits = 0;
+		Ar << Key << NumBits;
+		if (NumBits < 0 || NumBits > Ar.TotalSize() * 8)
+		{
+			UE_LOG(LogSurvivalGame, Warning, TEXT("Foliage resources: save is corrupt, harvested foliage resets"));
+			return;
+		}
+		TBitArray<> Saved(false, NumBits);
+		if (NumBits > 0)
+		{
+			Ar.Serialize(Saved.GetData(), FMath::DivideAndRoundUp(NumBits, 32) * sizeof(uint32));
+		}
+
+		//Regrowth times aren't saved, everything harvested regrows a full regrowth time after loading
+		const int32 StateId = FindOrAddState(Key);
+		FFoliageState& State = States[StateId];
+		if (State.Component.IsValid())
+		{
+			for (TConstSetBitIterator<> It(Saved); It; ++It)
+			{
+				SetHarvested(State, It.GetIndex(), true, false);
+			}
+			State.Component->MarkRenderStateDirty();
+		}
+		else
+		{
+			State.Harvested = Saved;
+		}
+		for (TConstSetBitIterator<> It(State.Harvested); It; ++It)
+		{
+			ScheduleRegrowth(StateId, It.GetIndex());
+		}
+		for (int32 WordIndex = 0; WordIndex * 32 < State.Harvested.Num(); WordIndex++)
+		{
+			WordChanged(StateId, WordIndex * 32);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SurvivalSaveable.h"
+#include "SurvivalFoliageResourceSubsystem.generated.h"
+
+class ASurvivalFoliageResourceReplicator;
+class UInstancedStaticMeshComponent;
+
+/**
+ * Timers in 4 levels of 64 slots, each level's slot covering a whole turn of the level below.
+ * Scheduling is O(1), and advancing a tick costs the timers that expire plus, once every 64 ticks or more, moving one slot down a level.
+ */
+class SURVIVALGAMEKITV1_API FSurvivalTimerWheel
+{
+public:
+	/** Expires after DelayTicks, at least 1 and at most MaxDelay */
+	void Schedule(uint64 Payload, uint32 DelayTicks);
+	/** Moves the wheel forward and outs the payloads that expired */
+	void Advance(uint32 Ticks, TArray<uint64>& OutExpired);
+	void Reset();
+
+	int32 Num() const
+	{
+		return NumTimers;
+	}
+
+	static const int32 SlotBits = 6;
+	static const int32 NumSlots = 1 << SlotBits;
+	static const int32 NumLevels = 4;
+	static const uint32 MaxDelay = (1u << (SlotBits * NumLevels)) - 1;
+
+private:
+	struct FTimer
+	{
+		uint64 Payload;
+		uint32 Expiry;
+	};
+
+	void Insert(const FTimer& Timer);
+
+	TArray<FTimer> Slots[NumLevels][NumSlots];
+	uint32 Now = 0;
+	int32 NumTimers = 0;
+};
+
+/**
+ * Harvested resource foliage, kept as one bit per instance of each foliage component.
+ * Harvested instances are hidden until a timer wheel regrows them. The server replicates changed 32 bit words
+ * and saves the raw bits, so the cost of a frame doesn't depend on how much of the map has been harvested.
+ */
+UCLASS(config=Game)
+class SURVIVALGAMEKITV1_API USurvivalFoliageResourceSubsystem : public UWorldSubsystem, public FTickableGameObject, public ISurvivalSaveable
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	//ISurvivalSaveable
+	virtual void WriteSaveState(FArchive& Ar) override;
+	virtual void ReadSaveState(FArchive& Ar, int32 Version) override;
+	virtual bool IsSavedByLocation() const override
+	{
+		return false;
+	}
+	virtual FString GetSaveId() const override
+	{
+		return TEXT("FoliageResources");
+	}
+
+	/** Seconds until a harvested instance regrows, for components registered without their own */
+	UPROPERTY(Config)
+	float DefaultRegrowthTime = 600.0f;
+	/** Length of a timer wheel tick, regrowth is this precise */
+	UPROPERTY(Config)
+	float RegrowthTickInterval = 1.0f;
+	/** Regrown instances shown per frame, the rest wait for the next frame */
+	UPROPERTY(Config)
+	int32 MaxRegrowthsPerFrame = 64;
+
+	/** Call from the foliage component's BeginPlay, on the server and clients. A RegrowthTime of 0 uses DefaultRegrowthTime */
+	UFUNCTION(BlueprintCallable, Category = "Resources")
+	void RegisterFoliage(UInstancedStaticMeshComponent* Component, float RegrowthTime = 0.0f);
+
+	/** Hides the instance until it regrows. False when it was already harvested or isn't an instance */
+	UFUNCTION(BlueprintCallable, Category = "Resources")
+	bool HarvestInstance(UInstancedStaticMeshComponent* Component, int32 InstanceIndex);
+
+	UFUNCTION(BlueprintPure, Category = "Resources")
+	bool IsHarvested(const UInstancedStaticMeshComponent* Component, int32 InstanceIndex) const;
+
+	void SetReplicator(ASurvivalFoliageResourceReplicator* InReplicator);
+	/** Applies a word of harvested bits from the server */
+	void ApplyReplicatedWord(UInstancedStaticMeshComponent* Component, int32 WordIndex, uint32 Bits);
+
+private:
+	struct FFoliageState
+	{
+		TWeakObjectPtr<UInstancedStaticMeshComponent> Component;
+		//Path of the component without the PIE prefix, the same every time the level loads
+		FString Key;
+		TBitArray<> Harvested;
+		//What harvested instances looked like before they were hidden
+		TMap<int32, FTransform> HiddenTransforms;
+		float RegrowthTime = 0.0f;
+	};
+
+	bool IsServer() const;
+	int32 FindOrAddState(const FString& Key);
+	int32 FindOrAddState(UInstancedStaticMeshComponent* Component);
+	void SetHarvested(FFoliageState& State, int32 InstanceIndex, bool bHarvested, bool bMarkRenderStateDirty);
+	void ScheduleRegrowth(int32 StateId, int32 InstanceIndex);
+	void WordChanged(int32 StateId, int32 InstanceIndex);
+	void ProcessRegrowth();
+
+	bool bInitialized = false;
+	bool bRegisteredForSave = false;
+	TArray<FFoliageState> States;
+	TMap<FString, int32> StateIds;
+	TMap<const UInstancedStaticMeshComponent*, int32> StateIdsByComponent;
+
+	FSurvivalTimerWheel Regrowth;
+	//Expired regrowth waiting for a frame with room
+	TArray<uint64> DueRegrowth;
+	float RegrowthAccumulator = 0.0f;
+
+	UPROPERTY(Transient)
+	ASurvivalFoliageResourceReplicator* Replicator = nullptr;
+};
@@ -2,5 +2,29 @@
 
 #include "SurvivalGameKitV1.h"
 #include "Modules/ModuleManager.h"
+#if WITH_EDITOR
+#include "GameDelegates.h"
+#include "SurvivalItemRegistry.h"
+#endif
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, SurvivalGameKitV1, "SurvivalGameKitV1" );
+class FSurvivalGameKitV1Module : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+#if WITH_EDITOR
+		FGameDelegates::Get().GetCookModificationDelegate().BindStatic(&USurvivalItemRegistry::OnCookStarted);
+#endif
+	}
+
+	virtual void ShutdownModule() override
+	{
+#if WITH_EDITOR
+		FGameDelegates::Get().GetCookModificationDelegate().Unbind();
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FSurvivalGameKitV1Module, SurvivalGameKitV1, "SurvivalGameKitV1" );
+
+DEFINE_LOG_CATEGORY(LogSurvivalGame);
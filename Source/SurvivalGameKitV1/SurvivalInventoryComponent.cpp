@@ -0,0 +1,400 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalInventoryComponent.h"
+#include "GameFramework/Actor.h"
+#include "Net/UnrealNetwork.h"
+#include "SurvivalItemRegistry.h"
+#include "SurvivalSaveComponent.h"
+
+void FSurvivalInventorySlotArray::PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		Owner->RebuildSlotLookup();
+		Owner->SlotsReplicated(AddedIndices);
+	}
+}
+
+void FSurvivalInventorySlotArray::PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize)
+{
+	if (Owner)
+	{
+		Owner->SlotsReplicated(ChangedIndices);
+	}
+}
+
+USurvivalInventoryComponent::USurvivalInventoryComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void USurvivalInventoryComponent::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Slots.Owner = this;
+}
+
+void USurvivalInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(USurvivalInventoryComponent, Slots);
+}
+
+void USurvivalInventoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	if (GetOwner()->HasAuthority())
+	{
+		InitSlots();
+	}
+}
+
+void USurvivalInventoryComponent::InitSlots()
+{
+	if (Slots.Items.Num() == 0)
+	{
+		Slots.Items.SetNum(NumSlots);
+		for (int32 i = 0; i < NumSlots; i++)
+		{
+			Slots.Items[i].Index = i;
+		}
+		Slots.MarkArrayDirty();
+		RebuildSlotLookup();
+	}
+}
+
+void USurvivalInventoryComponent::RebuildSlotLookup()
+{
+	int32 NumSlotIndices = Slots.Items.Num();
+	for (const FSurvivalInventorySlot& Slot : Slots.Items)
+	{
+		NumSlotIndices = FMath::Max(NumSlotIndices, Slot.Index + 1);
+	}
+	SlotLookup.Init(INDEX_NONE, NumSlotIndices);
+	for (int32 i = 0; i < Slots.Items.Num(); i++)
+	{
+		if (Slots.Items[i].Index >= 0)
+		{
+			SlotLookup[Slots.Items[i].Index] = i;
+		}
+	}
+}
+
+void USurvivalInventoryComponent::SlotsReplicated(const TArrayView<int32>& ChangedIndices)
+{
+	for (int32 ItemIndex : ChangedIndices)
+	{
+		OnSlotChanged.Broadcast(this, Slots.Items[ItemIndex].Index);
+	}
+}
+
+const FSurvivalInventorySlot* USurvivalInventoryComponent::FindSlot(int32 SlotIndex) const
+{
+	if (!SlotLookup.IsValidIndex(SlotIndex) || SlotLookup[SlotIndex] == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	return &Slots.Items[SlotLookup[SlotIndex]];
+}
+
+FSurvivalInventorySlot USurvivalInventoryComponent::GetSlot(int32 SlotIndex) const
+{
+	const FSurvivalInventorySlot* Slot = FindSlot(SlotIndex);
+	return Slot ? *Slot : FSurvivalInventorySlot();
+}
+
+int32 USurvivalInventoryComponent::GetItemCount(FName ItemId) const
+{
+	int32 Count = 0;
+	for (const FSurvivalInventorySlot& Slot : Slots.Items)
+	{
+		if (!Slot.IsEmpty() && Slot.ItemId == ItemId)
+		{
+			Count += Slot.Quantity;
+		}
+	}
+	return Count;
+}
+
+int32 USurvivalInventoryComponent::FindEmptySlot() const
+{
+	for (int32 SlotIndex = 0; SlotIndex < SlotLookup.Num(); SlotIndex++)
+	{
+		const FSurvivalInventorySlot* Slot = FindSlot(SlotIndex);
+		if (Slot && Slot->IsEmpty())
+		{
+			return SlotIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 USurvivalInventoryComponent::GetMaxStackSize_Implementation(FName ItemId) const
+{
+	const USurvivalItemRegistry* Registry = USurvivalItemRegistry::Get(this);
+	const int32 RegistryId = Registry ? Registry->FindItemId(ItemId) : INDEX_NONE;
+	return (RegistryId != INDEX_NONE) ? Registry->GetMaxStackSize(RegistryId) : DefaultMaxStackSize;
+}
+
+bool USurvivalInventoryComponent::CanTransferWith_Implementation(const USurvivalInventoryComponent* Other) const
+{
+	if (!Other)
+	{
+		return false;
+	}
+	const AActor* Owner = GetOwner();
+	const AActor* OtherOwner = Other->GetOwner();
+	if (Owner == OtherOwner)
+	{
+		return true;
+	}
+	return Other->bAllowExternalAccess && Owner->GetSquaredDistanceTo(OtherOwner) <= FMath::Square(MaxTransferDistance);
+}
+
+void USurvivalInventoryComponent::WriteSlot(int32 SlotIndex, FName ItemId, int32 Quantity)
+{
+	FSurvivalInventorySlot& Slot = Slots.Items[SlotLookup[SlotIndex]];
+	Slot.ItemId = (Quantity > 0) ? ItemId : NAME_None;
+	Slot.Quantity = FMath::Max(Quantity, 0);
+	Slots.MarkItemDirty(Slot);
+	OnSlotChanged.Broadcast(this, SlotIndex);
+	USurvivalSaveComponent::MarkActorDirty(GetOwner());
+}
+
+void USurvivalInventoryComponent::WriteSaveState(FArchive& Ar)
+{
+	//Only filled slots, by index so a changed NumSlots keeps what still fits
+	int32 NumFilled = 0;
+	for (const FSurvivalInventorySlot& Slot : Slots.Items)
+	{
+		NumFilled += Slot.IsEmpty() ? 0 : 1;
+	}
+	Ar << NumFilled;
+	for (FSurvivalInventorySlot& Slot : Slots.Items)
+	{
+		if (!Slot.IsEmpty())
+		{
+			FString ItemName = Slot.ItemId.ToString();
+			Ar << Slot.Index << ItemName << Slot.Quantity;
+		}
+	}
+}
+
+void USurvivalInventoryComponent::ReadSaveState(FArchive& Ar, int32 Version)
+{
+	//Loaded before BeginPlay when the save component comes first
+	InitSlots();
+	TArray<FSurvivalInventorySlot> Saved;
+	int32 NumFilled = 0;
+	Ar << NumFilled;
+	for (int32 i = 0; i < NumFilled && !Ar.IsError(); i++)
+	{
+		FSurvivalInventorySlot& Slot = Saved.AddDefaulted_GetRef();
+		FString ItemName;
+		Ar << Slot.Index << ItemName << Slot.Quantity;
+		Slot.ItemId = FName(*ItemName);
+	}
+	if (Ar.IsError())
+	{
+		return;
+	}
+
+	ClearInventory();
+	for (const FSurvivalInventorySlot& Slot : Saved)
+	{
+		if (FindSlot(Slot.Index))
+		{
+			WriteSlot(Slot.Index, Slot.ItemId, Slot.Quantity);
+		}
+	}
+}
+
+void USurvivalInventoryComponent::SetSlot(int32 SlotIndex, FName ItemId, int32 Quantity)
+{
+	if (GetOwner()->HasAuthority() && FindSlot(SlotIndex))
+	{
+		WriteSlot(SlotIndex, ItemId, Quantity);
+	}
+}
+
+void USurvivalInventoryComponent::ClearInventory()
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+	for (int32 SlotIndex = 0; SlotIndex < SlotLookup.Num(); SlotIndex++)
+	{
+		if (!GetSlot(SlotIndex).IsEmpty())
+		{
+			WriteSlot(SlotIndex, NAME_None, 0);
+		}
+	}
+}
+
+int32 USurvivalInventoryComponent::AddItem(FName ItemId, int32 Quantity)
+{
+	if (!GetOwner()->HasAuthority() || ItemId.IsNone() || Quantity <= 0)
+	{
+		return Quantity;
+	}
+
+	//Top up the item's stacks before starting new ones
+	const int32 MaxStack = GetMaxStackSize(ItemId);
+	for (int32 Pass = 0; Pass < 2 && Quantity > 0; Pass++)
+	{
+		for (int32 SlotIndex = 0; SlotIndex < SlotLookup.Num() && Quantity > 0; SlotIndex++)
+		{
+			const FSurvivalInventorySlot* Slot = FindSlot(SlotIndex);
+			const bool Matches = Slot && ((Pass == 0) ? (!Slot->IsEmpty() && Slot->ItemId == ItemId) : Slot->IsEmpty());
+			const int32 Added = Matches ? FMath::Min(Quantity, MaxStack - Slot->Quantity) : 0;
+			if (Added > 0)
+			{
+				WriteSlot(SlotIndex, ItemId, Slot->Quantity + Added);
+				Quantity -= Added;
+			}
+		}
+	}
+	return Quantity;
+}
+
+int32 USurvivalInventoryComponent::RemoveItem(FName ItemId, int32 Quantity)
+{
+	if (!GetOwner()->HasAuthority() || Quantity <= 0)
+	{
+		return 0;
+	}
+
+	int32 Removed = 0;
+	for (int32 SlotIndex = SlotLookup.Num() - 1; SlotIndex >= 0 && Removed < Quantity; SlotIndex--)
+	{
+		const FSurvivalInventorySlot* Slot = FindSlot(SlotIndex);
+		if (Slot && !Slot->IsEmpty() && Slot->ItemId == ItemId)
+		{
+			const int32 Taken = FMath::Min(Quantity - Removed, Slot->Quantity);
+			WriteSlot(SlotIndex, ItemId, Slot->Quantity - Taken);
+			Removed += Taken;
+		}
+	}
+	return Removed;
+}
+
+bool USurvivalInventoryComponent::MoveBetween(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity)
+{
+	if (!From || !To || (From == To && FromSlot == ToSlot))
+	{
+		return false;
+	}
+	const FSurvivalInventorySlot* Source = From->FindSlot(FromSlot);
+	const FSurvivalInventorySlot* Target = To->FindSlot(ToSlot);
+	if (!Source || !Target || Source->IsEmpty())
+	{
+		return false;
+	}
+
+	//Copies, writing the first slot changes what the pointers see
+	const FName SourceItem = Source->ItemId;
+	const int32 SourceQuantity = Source->Quantity;
+	const FName TargetItem = Target->ItemId;
+	const int32 TargetQuantity = Target->Quantity;
+	Quantity = (Quantity <= 0) ? SourceQuantity : FMath::Min(Quantity, SourceQuantity);
+
+	if (Target->IsEmpty() || TargetItem == SourceItem)
+	{
+		const int32 Moved = FMath::Min(Quantity, To->GetMaxStackSize(SourceItem) - TargetQuantity);
+		if (Moved <= 0)
+		{
+			return false;
+		}
+		From->WriteSlot(FromSlot, SourceItem, SourceQuantity - Moved);
+		To->WriteSlot(ToSlot, SourceItem, TargetQuantity + Moved);
+		return true;
+	}
+
+	//Different items only swap whole stacks, and only if each fits where it goes
+	if (Quantity != SourceQuantity || SourceQuantity > To->GetMaxStackSize(SourceItem) || TargetQuantity > From->GetMaxStackSize(TargetItem))
+	{
+		return false;
+	}
+	From->WriteSlot(FromSlot, TargetItem, TargetQuantity);
+	To->WriteSlot(ToSlot, SourceItem, SourceQuantity);
+	return true;
+}
+
+void USurvivalInventoryComponent::TransferItem(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity)
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		Server_TransferItem(From, FromSlot, To, ToSlot, Quantity);
+		return;
+	}
+	if (!From || !To)
+	{
+		return;
+	}
+	//Clients can only move items in or out of their own inventories, never between two others
+	const bool bInvolvesOwner = From->GetOwner() == GetOwner() || To->GetOwner() == GetOwner();
+	if (bInvolvesOwner && CanTransferWith(From) && CanTransferWith(To))
+	{
+		MoveBetween(From, FromSlot, To, ToSlot, Quantity);
+	}
+}
+
+bool USurvivalInventoryComponent::Server_TransferItem_Validate(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity)
+{
+	return FromSlot >= 0 && ToSlot >= 0 && Quantity >= 0;
+}
+void USurvivalInventoryComponent::Server_TransferItem_Implementation(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity)
+{
+	TransferItem(From, FromSlot, To, ToSlot, Quantity);
+}
+
+void USurvivalInventoryComponent::MoveItem(int32 FromSlot, int32 ToSlot)
+{
+	TransferItem(this, FromSlot, this, ToSlot, 0);
+}
+
+void USurvivalInventoryComponent::SplitStack(int32 SlotIndex, int32 Quantity)
+{
+	//The client's view of empty slots can be stale, the server moves onto the same item or fails
+	const int32 EmptySlot = FindEmptySlot();
+	if (EmptySlot != INDEX_NONE && Quantity > 0 && Quantity < GetSlot(SlotIndex).Quantity)
+	{
+		TransferItem(this, SlotIndex, this, EmptySlot, Quantity);
+	}
+}
+
+void USurvivalInventoryComponent::StackItems()
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		Server_StackItems();
+		return;
+	}
+
+	for (int32 SlotIndex = 0; SlotIndex < SlotLookup.Num(); SlotIndex++)
+	{
+		const FSurvivalInventorySlot* Slot = FindSlot(SlotIndex);
+		if (!Slot || Slot->IsEmpty())
+		{
+			continue;
+		}
+		const FName ItemId = Slot->ItemId;
+		const int32 MaxStack = GetMaxStackSize(ItemId);
+		for (int32 Other = SlotIndex + 1; Other < SlotLookup.Num() && Slot->Quantity < MaxStack; Other++)
+		{
+			const FSurvivalInventorySlot* OtherSlot = FindSlot(Other);
+			if (OtherSlot && !OtherSlot->IsEmpty() && OtherSlot->ItemId == ItemId)
+			{
+				MoveBetween(this, Other, this, SlotIndex, 0);
+			}
+		}
+	}
+}
+
+void USurvivalInventoryComponent::Server_StackItems_Implementation()
+{
+	StackItems();
+}
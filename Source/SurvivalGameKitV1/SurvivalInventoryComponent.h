@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "SurvivalSaveable.h"
+#include "SurvivalInventoryComponent.generated.h"
+
+class USurvivalInventoryComponent;
+
+/** One inventory slot, empty when Quantity is 0 */
+USTRUCT(BlueprintType)
+struct SURVIVALGAMEKITV1_API FSurvivalInventorySlot : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Row name of the item in the item table */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	FName ItemId;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 Quantity = 0;
+
+	/** Position in the inventory, clients can receive the slots in any order */
+	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
+	int32 Index = INDEX_NONE;
+
+	bool IsEmpty() const
+	{
+		return Quantity <= 0;
+	}
+};
+
+/** Every slot is created up front and never removed, so only the slots that change are replicated */
+USTRUCT()
+struct SURVIVALGAMEKITV1_API FSurvivalInventorySlotArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FSurvivalInventorySlot> Items;
+
+	UPROPERTY(NotReplicated, Transient)
+	USurvivalInventoryComponent* Owner = nullptr;
+
+	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FSurvivalInventorySlot, FSurvivalInventorySlotArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSurvivalInventorySlotArray> : public TStructOpsTypeTraitsBase2<FSurvivalInventorySlotArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSurvivalInventorySlotChanged, USurvivalInventoryComponent*, Inventory, int32, SlotIndex);
+
+/**
+ * A fixed number of item slots, replicated slot by slot.
+ * The server makes every change. Clients request moves through an inventory their player owns,
+ * and those moves can go to and from another inventory, like a storage box.
+ * Saved with its actor when the actor has a USurvivalSaveComponent.
+ */
+UCLASS(Blueprintable, ClassGroup=(Survival), meta=(BlueprintSpawnableComponent))
+class SURVIVALGAMEKITV1_API USurvivalInventoryComponent : public UActorComponent, public ISurvivalSaveable
+{
+	GENERATED_BODY()
+
+public:
+	USurvivalInventoryComponent();
+
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	//ISurvivalSaveable, written by the actor's USurvivalSaveComponent rather than registered on its own
+	virtual void WriteSaveState(FArchive& Ar) override;
+	virtual void ReadSaveState(FArchive& Ar, int32 Version) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "1"))
+	int32 NumSlots = 24;
+
+	/** What GetMaxStackSize returns for items the item registry doesn't know */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "1"))
+	int32 DefaultMaxStackSize = 99;
+
+	/** Used by CanTransferWith, items can't be moved to or from inventories further than this from our owner */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = "0"))
+	float MaxTransferDistance = 500.0f;
+
+	/** Lets inventories on other actors move items to and from this one, for storage like chests. Player inventories leave this off */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Inventory")
+	bool bAllowExternalAccess = false;
+
+	/** Called on the server when a slot changes, and on clients when the change arrives */
+	UPROPERTY(BlueprintAssignable, Category = "Inventory")
+	FSurvivalInventorySlotChanged OnSlotChanged;
+
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	FSurvivalInventorySlot GetSlot(int32 SlotIndex) const;
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	int32 GetItemCount(FName ItemId) const;
+	/** INDEX_NONE when the inventory is full */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	int32 FindEmptySlot() const;
+
+	UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "Inventory")
+	int32 GetMaxStackSize(FName ItemId) const;
+
+	/** Whether items can move between this inventory and Other. By default this is when they share an owner, or Other allows external access and is within MaxTransferDistance */
+	UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "Inventory")
+	bool CanTransferWith(const USurvivalInventoryComponent* Other) const;
+
+	/** Tops up stacks of the item, then fills empty slots. Returns how many didn't fit */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Inventory")
+	int32 AddItem(FName ItemId, int32 Quantity);
+	/** Takes from the last slots first. Returns how many were removed */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Inventory")
+	int32 RemoveItem(FName ItemId, int32 Quantity);
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Inventory")
+	void SetSlot(int32 SlotIndex, FName ItemId, int32 Quantity);
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Inventory")
+	void ClearInventory();
+
+	/**
+	 * Moves Quantity items from one slot to another, or the whole stack when Quantity is 0. The inventories may be the same.
+	 * Onto an empty slot or the same item, as many move as fit. Onto a different item, whole stacks swap.
+	 * On clients the request goes to the server through this component, so call it on an inventory the player owns.
+	 * One side must share this component's owner, the other must pass CanTransferWith.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void TransferItem(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity = 0);
+
+	/** TransferItem within this inventory */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void MoveItem(int32 FromSlot, int32 ToSlot);
+	/** Moves Quantity off a stack into the first empty slot */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void SplitStack(int32 SlotIndex, int32 Quantity);
+	/** Merges partial stacks of the same item into the earliest slots */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void StackItems();
+
+protected:
+	virtual void BeginPlay() override;
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void Server_TransferItem(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity);
+	UFUNCTION(Server, Reliable)
+	void Server_StackItems();
+
+private:
+	friend struct FSurvivalInventorySlotArray;
+
+	static bool MoveBetween(USurvivalInventoryComponent* From, int32 FromSlot, USurvivalInventoryComponent* To, int32 ToSlot, int32 Quantity);
+
+	void InitSlots();
+	const FSurvivalInventorySlot* FindSlot(int32 SlotIndex) const;
+	void WriteSlot(int32 SlotIndex, FName ItemId, int32 Quantity);
+	void RebuildSlotLookup();
+	void SlotsReplicated(const TArrayView<int32>& ChangedIndices);
+
+	UPROPERTY(Replicated)
+	FSurvivalInventorySlotArray Slots;
+
+	//Slot index to position in Slots.Items, clients add them in the order they arrive
+	TArray<int32> SlotLookup;
+};
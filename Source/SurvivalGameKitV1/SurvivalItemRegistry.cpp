@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalItemRegistry.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "SurvivalGameKitV1.h"
+#if WITH_EDITOR
+#include "DataTableUtils.h"
+#include "Engine/DataTable.h"
+#include "Serialization/BufferArchive.h"
+#endif
+
+void FSurvivalItemRegistryData::Reset()
+{
+	SourceHash = FSHAHash();
+	Names.Reset();
+	Records.Reset();
+	Costs.Reset();
+	Loot.Reset();
+	LootProbability.Reset();
+	LootAlias.Reset();
+	IdsByName.Reset();
+}
+
+int32 FSurvivalItemRegistryData::AddItem(FName Name)
+{
+	const int32 Id = Names.Add(Name);
+	Records.AddDefaulted();
+	IdsByName.Add(Name, Id);
+	return Id;
+}
+
+void FSurvivalItemRegistryData::BuildLootTable(const TArray<float>& Weights)
+{
+	//Vose's alias method, every column holds its own entry up to its probability and one alias for the rest
+	const int32 Num = Weights.Num();
+	LootProbability.Init(1.0f, Num);
+	LootAlias.Init(0, Num);
+	float TotalWeight = 0;
+	for (float Weight : Weights)
+	{
+		TotalWeight += Weight;
+	}
+	if (TotalWeight <= 0)
+	{
+		return;
+	}
+
+	TArray<float> Scaled;
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Scaled.SetNumUninitialized(Num);
+	for (int32 i = 0; i < Num; i++)
+	{
+		Scaled[i] = Weights[i] * Num / TotalWeight;
+		LootAlias[i] = i;
+		(Scaled[i] < 1.0f ? Small : Large).Add(i);
+	}
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+		LootProbability[Less] = Scaled[Less];
+		LootAlias[Less] = More;
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0f;
+		(Scaled[More] < 1.0f ? Small : Large).Add(More);
+	}
+	//Whatever is left is full up to rounding error
+}
+
+bool FSurvivalItemRegistryData::Serialize(FArchive& Ar)
+{
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	Ar << FileMagic << FileVersion;
+	if (Ar.IsLoading() && (FileMagic != Magic || FileVersion != Version))
+	{
+		return false;
+	}
+	Ar << SourceHash;
+
+	//Names are stored as strings and interned once here, lookups never touch them again
+	int32 NumItems = Names.Num();
+	Ar << NumItems;
+	if (Ar.IsLoading())
+	{
+		if (NumItems < 0 || NumItems > Ar.TotalSize())
+		{
+			return false;
+		}
+		Names.SetNum(NumItems);
+	}
+	for (FName& Name : Names)
+	{
+		FString NameString = Name.ToString();
+		Ar << NameString;
+		if (Ar.IsLoading())
+		{
+			Name = FName(*NameString);
+		}
+	}
+	Ar << Records << Costs << Loot << LootProbability << LootAlias;
+
+	if (Ar.IsLoading())
+	{
+		if (Ar.IsError() || !IsValid())
+		{
+			Reset();
+			return false;
+		}
+		IdsByName.Reset();
+		IdsByName.Reserve(Names.Num());
+		for (int32 i = 0; i < Names.Num(); i++)
+		{
+			IdsByName.Add(Names[i], i);
+		}
+	}
+	return !Ar.IsError();
+}
+
+bool FSurvivalItemRegistryData::IsValid() const
+{
+	if (Records.Num() != Names.Num() || LootProbability.Num() != Loot.Num() || LootAlias.Num() != Loot.Num())
+	{
+		return false;
+	}
+	for (const FSurvivalItemRecord& Record : Records)
+	{
+		if (Record.FirstCost < 0 || Record.NumCosts < 0 || Record.FirstCost + Record.NumCosts > Costs.Num())
+		{
+			return false;
+		}
+	}
+	for (const FSurvivalItemCost& Cost : Costs)
+	{
+		if (!Records.IsValidIndex(Cost.ItemId))
+		{
+			return false;
+		}
+	}
+	for (int32 i = 0; i < Loot.Num(); i++)
+	{
+		if (!Records.IsValidIndex(Loot[i].ItemId) || !Loot.IsValidIndex(LootAlias[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+USurvivalItemRegistry* USurvivalItemRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	return GameInstance ? GameInstance->GetSubsystem<USurvivalItemRegistry>() : nullptr;
+}
+
+FString USurvivalItemRegistry::GetRegistryFilePath() const
+{
+	return FPaths::ProjectContentDir() / RegistryFile;
+}
+
+void USurvivalItemRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	LootStream.GenerateNewSeed();
+
+#if WITH_EDITOR
+	if (GIsEditor)
+	{
+		FString Error;
+		if (!CompileTables(Data, Error))
+		{
+			UE_LOG(LogSurvivalGame, Warning, TEXT("Item registry: %s"), *Error);
+		}
+		return;
+	}
+#endif
+
+	const FString Path = GetRegistryFilePath();
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: can't read %s, it is written when cooking or by the SurvivalItemRegistry commandlet"), *Path);
+		return;
+	}
+	FMemoryReader Reader(Bytes);
+	if (!Data.Serialize(Reader))
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: %s is corrupt or out of date"), *Path);
+		return;
+	}
+	UE_LOG(LogSurvivalGame, Log, TEXT("Item registry: loaded %d items and %d loot entries"), Data.Names.Num(), Data.Loot.Num());
+}
+
+int32 USurvivalItemRegistry::RollLoot(int32& Quantity) const
+{
+	const FSurvivalLootEntry* Entry = Data.RollLoot(LootStream);
+	Quantity = Entry ? LootStream.RandRange(Entry->MinQuantity, Entry->MaxQuantity) : 0;
+	return Entry ? Entry->ItemId : INDEX_NONE;
+}
+
+#if WITH_EDITOR
+namespace SurvivalItemRegistry
+{
+	//Blueprint struct members have generated suffixes, columns are matched by the name the table shows
+	const FProperty* FindColumn(const UStruct* Struct, const FString& Column)
+	{
+		if (!Struct || Column.IsEmpty())
+		{
+			return nullptr;
+		}
+		for (TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			if (DataTableUtils::GetPropertyExportName(*It) == Column)
+			{
+				return *It;
+			}
+		}
+		return nullptr;
+	}
+
+	double ReadNumber(const FProperty* Property, const void* Container, double Default)
+	{
+		const FNumericProperty* Numeric = CastField<FNumericProperty>(Property);
+		if (!Numeric)
+		{
+			return Default;
+		}
+		const void* Value = Numeric->ContainerPtrToValuePtr<void>(Container);
+		return Numeric->IsFloatingPoint() ? Numeric->GetFloatingPointPropertyValue(Value) : (double)Numeric->GetSignedIntPropertyValue(Value);
+	}
+
+	FName ReadName(const FProperty* Property, const void* Container)
+	{
+		if (!Property)
+		{
+			return NAME_None;
+		}
+		const void* Value = Property->ContainerPtrToValuePtr<void>(Container);
+		if (const FNameProperty* NameProperty = CastField<FNameProperty>(Property))
+		{
+			return NameProperty->GetPropertyValue(Value);
+		}
+		if (const FStrProperty* StrProperty = CastField<FStrProperty>(Property))
+		{
+			return FName(*StrProperty->GetPropertyValue(Value));
+		}
+		const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+		if (StructProperty && StructProperty->Struct == FDataTableRowHandle::StaticStruct())
+		{
+			return static_cast<const FDataTableRowHandle*>(Value)->RowName;
+		}
+		return NAME_None;
+	}
+}
+
+bool USurvivalItemRegistry::CompileTables(FSurvivalItemRegistryData& OutData, FString& OutError) const
+{
+	using namespace SurvivalItemRegistry;
+	OutData.Reset();
+
+	const UDataTable* Items = Cast<UDataTable>(ItemTable.TryLoad());
+	if (!Items || !Items->GetRowStruct())
+	{
+		OutError = FString::Printf(TEXT("can't load item table %s"), *ItemTable.ToString());
+		return false;
+	}
+	const UScriptStruct* ItemStruct = Items->GetRowStruct();
+	const UDataTable* LootRows = LootTable.IsNull() ? nullptr : Cast<UDataTable>(LootTable.TryLoad());
+
+	//Anything that changes the compiled data changes the hash
+	FSHA1 Sha;
+	const FString Source = FString::Join(TArray<FString>{ Items->GetTableAsJSON(), LootRows ? LootRows->GetTableAsJSON() : FString(),
+		StackSizeColumn, WeightColumn, CostsColumn, CostItemColumn, CostQuantityColumn, LootItemColumn, LootWeightColumn, LootMinColumn, LootMaxColumn }, TEXT("\n"));
+	Sha.UpdateWithString(*Source, Source.Len());
+	Sha.Final();
+	Sha.GetHash(OutData.SourceHash.Hash);
+
+	const FProperty* StackSize = FindColumn(ItemStruct, StackSizeColumn);
+	const FProperty* Weight = FindColumn(ItemStruct, WeightColumn);
+	const FArrayProperty* CostArray = CastField<FArrayProperty>(FindColumn(ItemStruct, CostsColumn));
+	const FStructProperty* CostStruct = CostArray ? CastField<FStructProperty>(CostArray->Inner) : nullptr;
+	const FProperty* CostItem = CostStruct ? FindColumn(CostStruct->Struct, CostItemColumn) : nullptr;
+	const FProperty* CostQuantity = CostStruct ? FindColumn(CostStruct->Struct, CostQuantityColumn) : nullptr;
+
+	//Ids follow the table's row order, every name is added first so costs can refer to any item
+	const TMap<FName, uint8*>& ItemRows = Items->GetRowMap();
+	for (const TPair<FName, uint8*>& Row : ItemRows)
+	{
+		OutData.AddItem(Row.Key);
+	}
+	for (const TPair<FName, uint8*>& Row : ItemRows)
+	{
+		FSurvivalItemRecord& Record = OutData.Records[OutData.FindItemId(Row.Key)];
+		Record.MaxStackSize = FMath::Max(FMath::RoundToInt(ReadNumber(StackSize, Row.Value, 1)), 1);
+		Record.Weight = (float)ReadNumber(Weight, Row.Value, 0);
+		Record.FirstCost = OutData.Costs.Num();
+		if (CostItem)
+		{
+			FScriptArrayHelper Array(CostArray, CostArray->ContainerPtrToValuePtr<void>(Row.Value));
+			for (int32 i = 0; i < Array.Num(); i++)
+			{
+				const uint8* Element = Array.GetRawPtr(i);
+				FSurvivalItemCost Cost;
+				Cost.ItemId = OutData.FindItemId(ReadName(CostItem, Element));
+				Cost.Quantity = FMath::RoundToInt(ReadNumber(CostQuantity, Element, 1));
+				if (Cost.ItemId == INDEX_NONE)
+				{
+					UE_LOG(LogSurvivalGame, Warning, TEXT("Item registry: %s costs an item that isn't in %s"), *Row.Key.ToString(), *Items->GetName());
+					continue;
+				}
+				OutData.Costs.Add(Cost);
+			}
+		}
+		Record.NumCosts = OutData.Costs.Num() - Record.FirstCost;
+	}
+
+	if (LootRows && LootRows->GetRowStruct())
+	{
+		const UScriptStruct* LootStruct = LootRows->GetRowStruct();
+		const FProperty* LootItem = FindColumn(LootStruct, LootItemColumn);
+		const FProperty* LootWeight = FindColumn(LootStruct, LootWeightColumn);
+		const FProperty* LootMin = FindColumn(LootStruct, LootMinColumn);
+		const FProperty* LootMax = FindColumn(LootStruct, LootMaxColumn);
+
+		TArray<float> Weights;
+		for (const TPair<FName, uint8*>& Row : LootRows->GetRowMap())
+		{
+			//Without an item column the row name is the item
+			FSurvivalLootEntry Entry;
+			Entry.ItemId = OutData.FindItemId(LootItem ? ReadName(LootItem, Row.Value) : Row.Key);
+			Entry.MinQuantity = FMath::Max(FMath::RoundToInt(ReadNumber(LootMin, Row.Value, 1)), 1);
+			Entry.MaxQuantity = FMath::Max(FMath::RoundToInt(ReadNumber(LootMax, Row.Value, Entry.MinQuantity)), Entry.MinQuantity);
+			const float EntryWeight = (float)ReadNumber(LootWeight, Row.Value, 1);
+			if (Entry.ItemId != INDEX_NONE && EntryWeight > 0)
+			{
+				OutData.Loot.Add(Entry);
+				Weights.Add(EntryWeight);
+			}
+		}
+		OutData.BuildLootTable(Weights);
+	}
+	else if (!LootTable.IsNull())
+	{
+		OutError = FString::Printf(TEXT("can't load loot table %s"), *LootTable.ToString());
+		return false;
+	}
+	return true;
+}
+
+bool USurvivalItemRegistry::WriteRegistryFile(const FString& Path, FString& OutError) const
+{
+	FSurvivalItemRegistryData Compiled;
+	if (!CompileTables(Compiled, OutError))
+	{
+		return false;
+	}
+	FBufferArchive Writer;
+	Compiled.Serialize(Writer);
+	if (!FFileHelper::SaveArrayToFile(Writer, *Path))
+	{
+		OutError = FString::Printf(TEXT("can't write %s"), *Path);
+		return false;
+	}
+	UE_LOG(LogSurvivalGame, Display, TEXT("Item registry: wrote %d items, %d costs and %d loot entries to %s (%d bytes)"), Compiled.Names.Num(), Compiled.Costs.Num(), Compiled.Loot.Num(), *Path, Writer.Num());
+	return true;
+}
+
+void USurvivalItemRegistry::OnCookStarted(TArray<FString>& ExtraPackagesToCook)
+{
+	//Errors fail the cook, a stale file would ship item ids that don't match the tables
+	const USurvivalItemRegistry* Registry = GetDefault<USurvivalItemRegistry>();
+	const FString Path = Registry->GetRegistryFilePath();
+	FSurvivalItemRegistryData Compiled;
+	FString Error;
+	if (!Registry->CompileTables(Compiled, Error))
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: %s"), *Error);
+		return;
+	}
+
+	FSurvivalItemRegistryData Existing;
+	TArray<uint8> Bytes;
+	if (FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+	{
+		FMemoryReader Reader(Bytes);
+		if (Existing.Serialize(Reader) && Existing.SourceHash == Compiled.SourceHash)
+		{
+			UE_LOG(LogSurvivalGame, Display, TEXT("Item registry: %s is up to date"), *Path);
+			return;
+		}
+	}
+
+	if (!Registry->CompileOnCook)
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: %s doesn't match the item tables, run the SurvivalItemRegistry commandlet"), *Path);
+		return;
+	}
+	if (!Registry->WriteRegistryFile(Path, Error))
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: %s"), *Error);
+	}
+}
+#endif
@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "SurvivalItemRegistry.generated.h"
+
+/** An item and how many of it, items are registry ids */
+USTRUCT(BlueprintType)
+struct SURVIVALGAMEKITV1_API FSurvivalItemCost
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Items")
+	int32 ItemId = INDEX_NONE;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Items")
+	int32 Quantity = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSurvivalItemCost& Cost)
+	{
+		return Ar << Cost.ItemId << Cost.Quantity;
+	}
+};
+
+/** Everything hot paths need about an item, indexed by item id */
+struct FSurvivalItemRecord
+{
+	int32 MaxStackSize = 1;
+	float Weight = 0;
+	//Range of the item's crafting cost in FSurvivalItemRegistryData::Costs
+	int32 FirstCost = 0;
+	int32 NumCosts = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSurvivalItemRecord& Record)
+	{
+		return Ar << Record.MaxStackSize << Record.Weight << Record.FirstCost << Record.NumCosts;
+	}
+};
+
+struct FSurvivalLootEntry
+{
+	int32 ItemId = INDEX_NONE;
+	int32 MinQuantity = 1;
+	int32 MaxQuantity = 1;
+
+	friend FArchive& operator<<(FArchive& Ar, FSurvivalLootEntry& Entry)
+	{
+		return Ar << Entry.ItemId << Entry.MinQuantity << Entry.MaxQuantity;
+	}
+};
+
+/**
+ * The item and loot tables compiled into flat arrays.
+ * Item ids are positions in these arrays. Names are interned once when the data is loaded.
+ * Loot is rolled with an alias table, so a roll costs the same however long the loot list is.
+ */
+struct SURVIVALGAMEKITV1_API FSurvivalItemRegistryData
+{
+	static const uint32 Magic = 0x53474952; //"SGIR"
+	static const int32 Version = 2;
+
+	/** Hash of the tables and columns this was compiled from, the cook checks it against the current tables */
+	FSHAHash SourceHash;
+	TArray<FName> Names;
+	TArray<FSurvivalItemRecord> Records;
+	TArray<FSurvivalItemCost> Costs;
+	TArray<FSurvivalLootEntry> Loot;
+	TArray<float> LootProbability;
+	TArray<int32> LootAlias;
+
+	void Reset();
+	int32 AddItem(FName Name);
+	/** Builds LootProbability and LootAlias from the weight of each Loot entry */
+	void BuildLootTable(const TArray<float>& Weights);
+	/** Returns false when loading a file that is corrupt or from another version */
+	bool Serialize(FArchive& Ar);
+
+	int32 FindItemId(FName Name) const
+	{
+		const int32* Id = IdsByName.Find(Name);
+		return Id ? *Id : INDEX_NONE;
+	}
+
+	const FSurvivalLootEntry* RollLoot(FRandomStream& Stream) const
+	{
+		if (Loot.Num() == 0)
+		{
+			return nullptr;
+		}
+		const int32 Column = Stream.RandHelper(Loot.Num());
+		return &Loot[(Stream.GetFraction() < LootProbability[Column]) ? Column : LootAlias[Column]];
+	}
+
+private:
+	bool IsValid() const;
+
+	TMap<FName, int32> IdsByName;
+};
+
+/**
+ * Item metadata looked up by id, loaded at startup from the file the cook writes, or USurvivalItemRegistryCommandlet by hand.
+ * In the editor the tables are compiled directly, so the file never goes stale while working.
+ * The tables' columns are found by their names in the config below, the row name of an item is its name.
+ */
+UCLASS(config=Game)
+class SURVIVALGAMEKITV1_API USurvivalItemRegistry : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static USurvivalItemRegistry* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	UPROPERTY(Config)
+	FSoftObjectPath ItemTable = FSoftObjectPath(TEXT("/Game/SurvivalGameKit/Blueprints/Items/ItemList.ItemList"));
+	UPROPERTY(Config)
+	FSoftObjectPath LootTable = FSoftObjectPath(TEXT("/Game/SurvivalGameKit/Blueprints/Items/LootSpawnList.LootSpawnList"));
+	/** Relative to the project's content directory */
+	UPROPERTY(Config)
+	FString RegistryFile = TEXT("ItemRegistry/ItemRegistry.bin");
+	/** Recompile the file when cooking, otherwise the cook only fails if the file doesn't match the tables */
+	UPROPERTY(Config)
+	bool CompileOnCook = true;
+
+	UPROPERTY(Config)
+	FString StackSizeColumn = TEXT("StackSize");
+	UPROPERTY(Config)
+	FString WeightColumn = TEXT("Weight");
+	UPROPERTY(Config)
+	FString CostsColumn = TEXT("CraftingCost");
+	UPROPERTY(Config)
+	FString CostItemColumn = TEXT("Item");
+	UPROPERTY(Config)
+	FString CostQuantityColumn = TEXT("Amount");
+	UPROPERTY(Config)
+	FString LootItemColumn = TEXT("Item");
+	UPROPERTY(Config)
+	FString LootWeightColumn = TEXT("Chance");
+	UPROPERTY(Config)
+	FString LootMinColumn = TEXT("MinAmount");
+	UPROPERTY(Config)
+	FString LootMaxColumn = TEXT("MaxAmount");
+
+	/** INDEX_NONE for unknown names */
+	UFUNCTION(BlueprintPure, Category = "Items")
+	int32 FindItemId(FName ItemName) const
+	{
+		return Data.FindItemId(ItemName);
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Items")
+	bool IsValidItem(int32 ItemId) const
+	{
+		return Data.Records.IsValidIndex(ItemId);
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Items")
+	FName GetItemName(int32 ItemId) const
+	{
+		return IsValidItem(ItemId) ? Data.Names[ItemId] : NAME_None;
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Items")
+	int32 GetMaxStackSize(int32 ItemId) const
+	{
+		return IsValidItem(ItemId) ? Data.Records[ItemId].MaxStackSize : 1;
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Items")
+	float GetItemWeight(int32 ItemId) const
+	{
+		return IsValidItem(ItemId) ? Data.Records[ItemId].Weight : 0.0f;
+	}
+
+	UFUNCTION(BlueprintPure, Category = "Items")
+	TArray<FSurvivalItemCost> GetCraftingCosts(int32 ItemId) const
+	{
+		const TArrayView<const FSurvivalItemCost> Costs = GetCraftingCostView(ItemId);
+		return TArray<FSurvivalItemCost>(Costs.GetData(), Costs.Num());
+	}
+
+	/** Picks an entry of the loot table by its weight, INDEX_NONE if the table is empty */
+	UFUNCTION(BlueprintCallable, Category = "Items")
+	int32 RollLoot(int32& Quantity) const;
+
+	TArrayView<const FSurvivalItemCost> GetCraftingCostView(int32 ItemId) const
+	{
+		if (!IsValidItem(ItemId))
+		{
+			return TArrayView<const FSurvivalItemCost>();
+		}
+		const FSurvivalItemRecord& Record = Data.Records[ItemId];
+		return TArrayView<const FSurvivalItemCost>(Data.Costs.GetData() + Record.FirstCost, Record.NumCosts);
+	}
+
+	const FSurvivalItemRegistryData& GetData() const
+	{
+		return Data;
+	}
+
+#if WITH_EDITOR
+	/** Reads the tables into OutData, what the commandlet saves */
+	bool CompileTables(FSurvivalItemRegistryData& OutData, FString& OutError) const;
+	/** Compiles the tables and writes them to Path */
+	bool WriteRegistryFile(const FString& Path, FString& OutError) const;
+	/** Bound to the cook by the game module, brings the file up to date before anything is staged */
+	static void OnCookStarted(TArray<FString>& ExtraPackagesToCook);
+#endif
+
+	FString GetRegistryFilePath() const;
+
+private:
+	FSurvivalItemRegistryData Data;
+	mutable FRandomStream LootStream;
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalItemRegistryCommandlet.h"
+#include "SurvivalGameKitV1.h"
+#include "SurvivalItemRegistry.h"
+
+USurvivalItemRegistryCommandlet::USurvivalItemRegistryCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USurvivalItemRegistryCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	const USurvivalItemRegistry* Registry = GetDefault<USurvivalItemRegistry>();
+	FString OutputPath = Registry->GetRegistryFilePath();
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	FString Error;
+	if (!Registry->WriteRegistryFile(OutputPath, Error))
+	{
+		UE_LOG(LogSurvivalGame, Error, TEXT("Item registry: %s"), *Error);
+		return 1;
+	}
+	return 0;
+#else
+	return 1;
+#endif
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SurvivalItemRegistryCommandlet.generated.h"
+
+/**
+ * Compiles the item and loot tables into the file USurvivalItemRegistry loads. Cooking does the same,
+ * run it by hand when CompileOnCook is off or to write the file somewhere else:
+ * UE4Editor-Cmd.exe SurvivalGameKitV1.uproject -run=SurvivalItemRegistry [-Output=Path]
+ */
+UCLASS()
+class SURVIVALGAMEKITV1_API USurvivalItemRegistryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USurvivalItemRegistryCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
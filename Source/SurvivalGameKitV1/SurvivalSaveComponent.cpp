@@ -0,0 +1,223 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalSaveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "SurvivalSaveSubsystem.h"
+#include "TimerManager.h"
+
+namespace SurvivalSaveComponent
+{
+	bool HasSaveGameProperties(const UClass* Class)
+	{
+		for (TFieldIterator<FProperty> It(Class); It; ++It)
+		{
+			if (It->HasAnyPropertyFlags(CPF_SaveGame))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Only properties ticked SaveGame, objects and names as strings so they survive a restart
+	void SerializeSaveGameProperties(UObject* Object, FArchive& Ar)
+	{
+		FObjectAndNameAsStringProxyArchive Proxy(Ar, true);
+		Proxy.ArIsSaveGame = true;
+		Object->Serialize(Proxy);
+	}
+
+	//The actor is saved under an empty name, its components under theirs
+	FString GetEntryName(const UObject* Object)
+	{
+		return Cast<AActor>(Object) ? FString() : Object->GetName();
+	}
+}
+
+USurvivalSaveComponent::USurvivalSaveComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void USurvivalSaveComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	if (GetOwner()->HasAuthority())
+	{
+		TryRegister();
+	}
+}
+
+void USurvivalSaveComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRegistered)
+	{
+		if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+		{
+			SaveSubsystem->Unregister(this, EndPlayReason == EEndPlayReason::Destroyed);
+		}
+		bRegistered = false;
+	}
+	GetWorld()->GetTimerManager().ClearAllTimersForObject(this);
+	Super::EndPlay(EndPlayReason);
+}
+
+void USurvivalSaveComponent::TryRegister()
+{
+	//A player state gets its net id after it begins play, players are registered once it is there
+	if (SaveAsPlayer && GetSaveId().IsEmpty())
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &USurvivalSaveComponent::TryRegister);
+		return;
+	}
+	if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+	{
+		SaveSubsystem->Register(this);
+		bRegistered = true;
+	}
+}
+
+FString USurvivalSaveComponent::GetSaveId() const
+{
+	if (!SaveAsPlayer)
+	{
+		return FString();
+	}
+	const APlayerState* PlayerState = Cast<APlayerState>(GetOwner());
+	if (const APawn* Pawn = Cast<APawn>(GetOwner()))
+	{
+		PlayerState = Pawn->GetPlayerState();
+	}
+	else if (const AController* Controller = Cast<AController>(GetOwner()))
+	{
+		PlayerState = Controller->PlayerState;
+	}
+	return (PlayerState && PlayerState->GetUniqueId().IsValid()) ? TEXT("Player_") + PlayerState->GetUniqueId().ToString() : FString();
+}
+
+void USurvivalSaveComponent::MarkDirty()
+{
+	if (!bRegistered)
+	{
+		return;
+	}
+	if (USurvivalSaveSubsystem* SaveSubsystem = GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+	{
+		SaveSubsystem->MarkDirty(this);
+	}
+}
+
+void USurvivalSaveComponent::MarkActorDirty(AActor* Actor)
+{
+	for (AActor* Saved = Actor; Saved; Saved = Saved->GetOwner())
+	{
+		if (USurvivalSaveComponent* SaveComponent = Saved->FindComponentByClass<USurvivalSaveComponent>())
+		{
+			SaveComponent->MarkDirty();
+			return;
+		}
+		if (Cast<ISurvivalSaveable>(Saved))
+		{
+			//Ignored unless it registered
+			if (USurvivalSaveSubsystem* SaveSubsystem = Saved->GetWorld()->GetSubsystem<USurvivalSaveSubsystem>())
+			{
+				SaveSubsystem->MarkDirty(Saved);
+			}
+			return;
+		}
+	}
+}
+
+void USurvivalSaveComponent::WriteSaveState(FArchive& Ar)
+{
+	WriteActorState(GetOwner(), Ar);
+}
+
+void USurvivalSaveComponent::ReadSaveState(FArchive& Ar, int32 Version)
+{
+	ReadActorState(GetOwner(), Ar);
+}
+
+void USurvivalSaveComponent::WriteActorState(AActor* Actor, FArchive& Ar)
+{
+	using namespace SurvivalSaveComponent;
+
+	TArray<UObject*, TInlineAllocator<8>> Objects;
+	Objects.Add(Actor);
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component && !Component->IsA<USurvivalSaveComponent>() && (Cast<ISurvivalSaveable>(Component) || HasSaveGameProperties(Component->GetClass())))
+		{
+			Objects.Add(Component);
+		}
+	}
+
+	//Each entry is sized so changed or removed components are skipped on load
+	int32 NumEntries = Objects.Num();
+	Ar << NumEntries;
+	for (UObject* Object : Objects)
+	{
+		FString Name = GetEntryName(Object);
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+		ISurvivalSaveable* Saveable = Cast<AActor>(Object) ? nullptr : Cast<ISurvivalSaveable>(Object);
+		int32 Version = Saveable ? Saveable->GetSaveVersion() : 0;
+		if (Saveable)
+		{
+			Saveable->WriteSaveState(Writer);
+		}
+		else
+		{
+			SerializeSaveGameProperties(Object, Writer);
+		}
+		Ar << Name << Version << Bytes;
+	}
+}
+
+void USurvivalSaveComponent::ReadActorState(AActor* Actor, FArchive& Ar)
+{
+	using namespace SurvivalSaveComponent;
+
+	TMap<FString, UObject*> Objects;
+	Objects.Add(FString(), Actor);
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component && !Component->IsA<USurvivalSaveComponent>())
+		{
+			Objects.Add(GetEntryName(Component), Component);
+		}
+	}
+
+	int32 NumEntries = 0;
+	Ar << NumEntries;
+	for (int32 i = 0; i < NumEntries && !Ar.IsError(); i++)
+	{
+		FString Name;
+		int32 Version = 0;
+		TArray<uint8> Bytes;
+		Ar << Name << Version << Bytes;
+		UObject* Object = Objects.FindRef(Name);
+		if (!Object)
+		{
+			continue;
+		}
+
+		FMemoryReader Reader(Bytes);
+		ISurvivalSaveable* Saveable = Cast<AActor>(Object) ? nullptr : Cast<ISurvivalSaveable>(Object);
+		if (Saveable)
+		{
+			Saveable->ReadSaveState(Reader, Version);
+		}
+		else
+		{
+			SerializeSaveGameProperties(Object, Reader);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SurvivalSaveable.h"
+#include "SurvivalSaveComponent.generated.h"
+
+/**
+ * Saves the actor it is added to, how Blueprint actors like players, item pickups and storage take part in USurvivalSaveSubsystem.
+ * The actor's and its components' variables ticked SaveGame are saved, components implementing ISurvivalSaveable,
+ * like USurvivalInventoryComponent, save their own state. Call MarkDirty after changing a SaveGame variable.
+ * For players add it to the player state with SaveAsPlayer, the state follows the player's net id wherever they log in.
+ */
+UCLASS(ClassGroup=(Survival), meta=(BlueprintSpawnableComponent))
+class SURVIVALGAMEKITV1_API USurvivalSaveComponent : public UActorComponent, public ISurvivalSaveable
+{
+	GENERATED_BODY()
+
+public:
+	USurvivalSaveComponent();
+
+	/** Saved under the owning player's net id in the global chunk instead of where the actor stands */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Save")
+	bool SaveAsPlayer = false;
+
+	/** The actor is saved with the next save */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	void MarkDirty();
+
+	/** Marks Actor's save component dirty, or the first of its owners that is saved, like the build chunk of a promoted part */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	static void MarkActorDirty(AActor* Actor);
+
+	/** The SaveGame variables of Actor and its components, and the state of its ISurvivalSaveable components */
+	static void WriteActorState(AActor* Actor, FArchive& Ar);
+	static void ReadActorState(AActor* Actor, FArchive& Ar);
+
+	//ISurvivalSaveable
+	virtual void WriteSaveState(FArchive& Ar) override;
+	virtual void ReadSaveState(FArchive& Ar, int32 Version) override;
+	virtual bool IsSavedByLocation() const override
+	{
+		return !SaveAsPlayer;
+	}
+	virtual FString GetSaveId() const override;
+	virtual AActor* GetSavedActor() const override
+	{
+		return GetOwner();
+	}
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void TryRegister();
+
+	bool bRegistered = false;
+};
@@ -0,0 +1,619 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalSaveSubsystem.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "SurvivalGameKitV1.h"
+#include "SurvivalSaveable.h"
+
+namespace SurvivalSave
+{
+	const uint32 Magic = 0x53475356; //"SGSV"
+	const int32 FileVersion = 1;
+	//Chunks are at most this big uncompressed, anything larger is a corrupt header
+	const int32 MaxChunkSize = 256 * 1024 * 1024;
+	//Objects that aren't saved by location
+	const FIntPoint GlobalChunk(MAX_int32, MAX_int32);
+
+	void SerializeRecord(FArchive& Ar, FSurvivalSaveChunkSnapshot::FRecord& Record)
+	{
+		Ar << Record.Id << Record.ClassPath << Record.Transform << Record.Version << Record.Removed;
+		if (Ar.IsLoading())
+		{
+			Record.Payload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+			Ar << *Record.Payload;
+		}
+		else if (Record.Payload)
+		{
+			Ar << *Record.Payload;
+		}
+		else
+		{
+			TArray<uint8> Empty;
+			Ar << Empty;
+		}
+	}
+}
+
+bool FSurvivalSaveChunkSnapshot::Write()
+{
+	TArray<uint8> Body;
+	FMemoryWriter BodyWriter(Body);
+	int32 NumRecords = Records.Num();
+	BodyWriter << NumRecords;
+	for (FRecord& Record : Records)
+	{
+		SurvivalSave::SerializeRecord(BodyWriter, Record);
+	}
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Body.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Body.GetData(), Body.Num()))
+	{
+		return false;
+	}
+
+	TArray<uint8> File;
+	FMemoryWriter FileWriter(File);
+	uint32 Magic = SurvivalSave::Magic;
+	int32 Version = SurvivalSave::FileVersion;
+	int32 UncompressedSize = Body.Num();
+	FileWriter << Magic << Version << UncompressedSize << CompressedSize;
+	FileWriter.Serialize(Compressed.GetData(), CompressedSize);
+
+	//Written next to the old file and swapped in, a crash while writing leaves the last good save
+	const FString TempPath = Path + TEXT(".tmp");
+	return FFileHelper::SaveArrayToFile(File, *TempPath) && IFileManager::Get().Move(*Path, *TempPath, true, true);
+}
+
+bool FSurvivalSaveChunkSnapshot::Read()
+{
+	TArray<uint8> File;
+	if (!FFileHelper::LoadFileToArray(File, *Path))
+	{
+		return false;
+	}
+
+	FMemoryReader FileReader(File);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 UncompressedSize = 0;
+	int32 CompressedSize = 0;
+	FileReader << Magic << Version << UncompressedSize << CompressedSize;
+	if (FileReader.IsError() || Magic != SurvivalSave::Magic || Version != SurvivalSave::FileVersion ||
+		UncompressedSize < 0 || UncompressedSize > SurvivalSave::MaxChunkSize || CompressedSize != File.Num() - FileReader.Tell())
+	{
+		return false;
+	}
+
+	TArray<uint8> Body;
+	Body.SetNumUninitialized(UncompressedSize);
+	if (!FCompression::UncompressMemory(NAME_Zlib, Body.GetData(), UncompressedSize, File.GetData() + FileReader.Tell(), CompressedSize))
+	{
+		return false;
+	}
+
+	FMemoryReader BodyReader(Body);
+	int32 NumRecords = 0;
+	BodyReader << NumRecords;
+	if (NumRecords < 0 || NumRecords > Body.Num())
+	{
+		return false;
+	}
+	Records.SetNum(NumRecords);
+	for (FRecord& Record : Records)
+	{
+		SurvivalSave::SerializeRecord(BodyReader, Record);
+	}
+	return !BodyReader.IsError();
+}
+
+bool USurvivalSaveSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	UWorld* World = Cast<UWorld>(Outer);
+	return Super::ShouldCreateSubsystem(Outer) && World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE);
+}
+
+void USurvivalSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	FindChunksOnDisk();
+	NextAutosaveTime = AutosaveInterval;
+	bInitialized = true;
+}
+
+void USurvivalSaveSubsystem::Deinitialize()
+{
+	//Everything still dirty is written before the world goes
+	CompleteSaves(true);
+	if (CanSave())
+	{
+		SaveNow();
+		CompleteSaves(true);
+	}
+	for (auto& Load : PendingLoads)
+	{
+		Load.Value.Wait();
+	}
+	PendingLoads.Reset();
+	bInitialized = false;
+	Super::Deinitialize();
+}
+
+bool USurvivalSaveSubsystem::IsTickable() const
+{
+	return bInitialized && !HasAnyFlags(RF_ClassDefaultObject);
+}
+
+TStatId USurvivalSaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USurvivalSaveSubsystem, STATGROUP_Tickables);
+}
+
+bool USurvivalSaveSubsystem::CanSave() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Client;
+}
+
+void USurvivalSaveSubsystem::Tick(float DeltaTime)
+{
+	if (!CanSave())
+	{
+		return;
+	}
+	CompleteSaves(false);
+	CompleteLoads();
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextLoadCheckTime)
+	{
+		NextLoadCheckTime = Now + LoadCheckInterval;
+		LoadNearbyChunks();
+	}
+	ProcessLoadedRecords();
+
+	if (AutosaveInterval > 0 && Now >= NextAutosaveTime)
+	{
+		NextAutosaveTime = Now + AutosaveInterval;
+		SaveNow();
+	}
+}
+
+FString USurvivalSaveSubsystem::GetSaveDirectory() const
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / SaveSlot;
+}
+
+FString USurvivalSaveSubsystem::GetChunkPath(FIntPoint Chunk) const
+{
+	if (Chunk == SurvivalSave::GlobalChunk)
+	{
+		return GetSaveDirectory() / TEXT("Global.sav");
+	}
+	return GetSaveDirectory() / FString::Printf(TEXT("%d_%d.sav"), Chunk.X, Chunk.Y);
+}
+
+USurvivalSaveSubsystem::FChunk& USurvivalSaveSubsystem::GetChunk(FIntPoint Chunk)
+{
+	return Chunks.FindOrAdd(Chunk);
+}
+
+bool USurvivalSaveSubsystem::IsPlacedInLevel(UObject* Object)
+{
+	const AActor* Actor = Cast<AActor>(Object);
+	if (!Actor)
+	{
+		Actor = Object->GetTypedOuter<AActor>();
+	}
+	return Actor && Actor->HasAnyFlags(RF_WasLoaded);
+}
+
+AActor* USurvivalSaveSubsystem::GetSavedActor(UObject* Object, ISurvivalSaveable* Saveable)
+{
+	AActor* Actor = Saveable ? Saveable->GetSavedActor() : nullptr;
+	return Actor ? Actor : Cast<AActor>(Object);
+}
+
+FIntPoint USurvivalSaveSubsystem::GetChunkFor(UObject* Object, ISurvivalSaveable* Saveable) const
+{
+	if (!Saveable->IsSavedByLocation())
+	{
+		return SurvivalSave::GlobalChunk;
+	}
+	const AActor* Actor = Cast<AActor>(Object);
+	if (!Actor)
+	{
+		Actor = Object->GetTypedOuter<AActor>();
+	}
+	const FVector Location = Actor ? Actor->GetActorLocation() : FVector::ZeroVector;
+	return FIntPoint(FMath::FloorToInt(Location.X / ChunkSize), FMath::FloorToInt(Location.Y / ChunkSize));
+}
+
+void USurvivalSaveSubsystem::MoveRecordToChunk(const FString& Id, FSurvivalSaveRecord& Record, FIntPoint Chunk)
+{
+	if (FChunk* OldChunk = Chunks.Find(Record.Chunk))
+	{
+		OldChunk->RecordIds.Remove(Id);
+	}
+	Record.Chunk = Chunk;
+	GetChunk(Chunk).RecordIds.Add(Id);
+}
+
+void USurvivalSaveSubsystem::FindChunksOnDisk()
+{
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(GetSaveDirectory() / TEXT("*.sav")), true, false);
+	for (const FString& File : Files)
+	{
+		const FString Name = FPaths::GetBaseFilename(File);
+		FString X;
+		FString Y;
+		if (Name == TEXT("Global"))
+		{
+			GetChunk(SurvivalSave::GlobalChunk).OnDisk = true;
+		}
+		else if (Name.Split(TEXT("_"), &X, &Y) && X.IsNumeric() && Y.IsNumeric())
+		{
+			GetChunk(FIntPoint(FCString::Atoi(*X), FCString::Atoi(*Y))).OnDisk = true;
+		}
+	}
+}
+
+void USurvivalSaveSubsystem::Register(UObject* Object)
+{
+	ISurvivalSaveable* Saveable = Cast<ISurvivalSaveable>(Object);
+	if (!Saveable || !CanSave() || IdsByObject.Contains(Object))
+	{
+		return;
+	}
+
+	//Only what saves the actor spawned from a record takes its id, not other components registering during its spawn
+	FString Id = Saveable->GetSaveId();
+	AActor* SavedActor = GetSavedActor(Object, Saveable);
+	const FSurvivalSaveRecord* SpawningRecord = SpawningId.IsEmpty() ? nullptr : Records.Find(SpawningId);
+	if (Id.IsEmpty() && SpawningRecord && SavedActor && SpawningRecord->ClassPath == SavedActor->GetClass()->GetPathName())
+	{
+		Id = MoveTemp(SpawningId);
+		SpawningId.Reset();
+	}
+	const bool Placed = IsPlacedInLevel(Object);
+	if (Id.IsEmpty())
+	{
+		Id = Placed ? UWorld::RemovePIEPrefix(Object->GetPathName()) : FGuid::NewGuid().ToString();
+	}
+
+	IdsByObject.Add(Object, Id);
+	FSurvivalSaveRecord& Record = Records.FindOrAdd(Id);
+	Record.Object = Object;
+	if (Record.PendingLoad || Record.Removed)
+	{
+		ApplyRecord(Record, Saveable);
+		return;
+	}
+
+	//Actors spawned at runtime are spawned again on load, everything else already exists
+	if (!Placed && Saveable->GetSaveId().IsEmpty() && SavedActor)
+	{
+		Record.ClassPath = SavedActor->GetClass()->GetPathName();
+	}
+	MoveRecordToChunk(Id, Record, GetChunkFor(Object, Saveable));
+	if (!Placed)
+	{
+		DirtyRecords.Add(Id); //Placed objects match the level until they change
+	}
+}
+
+void USurvivalSaveSubsystem::Unregister(UObject* Object, bool Destroyed)
+{
+	FString Id;
+	if (!IdsByObject.RemoveAndCopyValue(Object, Id))
+	{
+		return;
+	}
+	FSurvivalSaveRecord* Record = Records.Find(Id);
+	if (!Record)
+	{
+		return;
+	}
+
+	//Objects with their own id, like players, keep their state when they leave
+	ISurvivalSaveable* Saveable = Cast<ISurvivalSaveable>(Object);
+	if (!Destroyed || (Saveable && !Saveable->GetSaveId().IsEmpty()))
+	{
+		if (DirtyRecords.Remove(Id) > 0)
+		{
+			SnapshotRecord(Id, *Record);
+		}
+		Record->Object = nullptr;
+		return;
+	}
+
+	DirtyRecords.Remove(Id);
+	GetChunk(Record->Chunk).Dirty = true;
+	if (IsPlacedInLevel(Object))
+	{
+		Record->Removed = true;
+		Record->Payload.Reset();
+		Record->Object = nullptr;
+	}
+	else
+	{
+		GetChunk(Record->Chunk).RecordIds.Remove(Id);
+		Records.Remove(Id);
+	}
+}
+
+void USurvivalSaveSubsystem::MarkDirty(UObject* Object)
+{
+	if (const FString* Id = IdsByObject.Find(Object))
+	{
+		DirtyRecords.Add(*Id);
+	}
+}
+
+void USurvivalSaveSubsystem::SnapshotRecord(const FString& Id, FSurvivalSaveRecord& Record)
+{
+	UObject* Object = Record.Object.Get();
+	ISurvivalSaveable* Saveable = Cast<ISurvivalSaveable>(Object);
+	if (!Saveable)
+	{
+		return;
+	}
+
+	//A new buffer every time, the last one may still be being written
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Payload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	FMemoryWriter Writer(*Payload);
+	Saveable->WriteSaveState(Writer);
+	Record.Payload = Payload;
+	Record.Version = Saveable->GetSaveVersion();
+	if (const AActor* Actor = GetSavedActor(Object, Saveable))
+	{
+		Record.Transform = Actor->GetActorTransform();
+	}
+
+	//Both chunks are written if it moved into another one
+	GetChunk(Record.Chunk).Dirty = true;
+	MoveRecordToChunk(Id, Record, GetChunkFor(Object, Saveable));
+	GetChunk(Record.Chunk).Dirty = true;
+}
+
+void USurvivalSaveSubsystem::ApplyRecord(FSurvivalSaveRecord& Record, ISurvivalSaveable* Saveable)
+{
+	Record.PendingLoad = false;
+	if (Record.Removed)
+	{
+		if (AActor* Actor = GetSavedActor(Record.Object.Get(), Saveable))
+		{
+			Actor->Destroy();
+		}
+		return;
+	}
+	if (Saveable && Record.Payload)
+	{
+		FMemoryReader Reader(*Record.Payload);
+		Saveable->ReadSaveState(Reader, Record.Version);
+	}
+}
+
+void USurvivalSaveSubsystem::SaveNow()
+{
+	if (!CanSave())
+	{
+		return;
+	}
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_SurvivalSaveSnapshot);
+
+	//Only what changed is copied, everything else is already in its record
+	for (const FString& Id : DirtyRecords)
+	{
+		if (FSurvivalSaveRecord* Record = Records.Find(Id))
+		{
+			SnapshotRecord(Id, *Record);
+		}
+	}
+	DirtyRecords.Reset();
+
+	for (TPair<FIntPoint, FChunk>& Pair : Chunks)
+	{
+		FChunk& Chunk = Pair.Value;
+		//Chunks that haven't been read yet keep their changes until they are, writing them would lose what is on disk
+		if (!Chunk.Dirty || Chunk.Saving || (Chunk.OnDisk && !Chunk.Loaded))
+		{
+			continue;
+		}
+
+		FSurvivalSaveChunkSnapshot Snapshot;
+		Snapshot.Chunk = Pair.Key;
+		Snapshot.Path = GetChunkPath(Pair.Key);
+		Snapshot.Records.Reserve(Chunk.RecordIds.Num());
+		for (const FString& Id : Chunk.RecordIds)
+		{
+			const FSurvivalSaveRecord& Record = Records.FindChecked(Id);
+			if (!Record.Payload && !Record.Removed)
+			{
+				continue; //Placed and never changed
+			}
+			FSurvivalSaveChunkSnapshot::FRecord& Saved = Snapshot.Records.AddDefaulted_GetRef();
+			Saved.Id = Id;
+			Saved.ClassPath = Record.ClassPath;
+			Saved.Transform = Record.Transform;
+			Saved.Version = Record.Version;
+			Saved.Removed = Record.Removed;
+			Saved.Payload = Record.Payload;
+		}
+
+		Chunk.Dirty = false;
+		Chunk.Saving = true;
+		Chunk.OnDisk = true;
+		Chunk.Loaded = true;
+		PendingSaves.Emplace(Pair.Key, Async(EAsyncExecution::ThreadPool, [Snapshot = MoveTemp(Snapshot)]() mutable
+		{
+			return Snapshot.Write();
+		}));
+	}
+}
+
+void USurvivalSaveSubsystem::CompleteSaves(bool Wait)
+{
+	for (int32 i = PendingSaves.Num() - 1; i >= 0; i--)
+	{
+		TPair<FIntPoint, TFuture<bool>>& Save = PendingSaves[i];
+		if (!Wait && !Save.Value.IsReady())
+		{
+			continue;
+		}
+		const bool Written = Save.Value.Get();
+		FChunk& Chunk = GetChunk(Save.Key);
+		Chunk.Saving = false;
+		if (!Written)
+		{
+			Chunk.Dirty = true; //Tried again with the next save
+			UE_LOG(LogSurvivalGame, Error, TEXT("Save: can't write %s"), *GetChunkPath(Save.Key));
+		}
+		PendingSaves.RemoveAtSwap(i);
+	}
+}
+
+void USurvivalSaveSubsystem::LoadChunk(FIntPoint ChunkCoord)
+{
+	FChunk* Chunk = Chunks.Find(ChunkCoord);
+	if (!Chunk || !Chunk->OnDisk || Chunk->Loading || Chunk->Loaded)
+	{
+		return;
+	}
+	Chunk->Loading = true;
+	const FString Path = GetChunkPath(ChunkCoord);
+	PendingLoads.Emplace(ChunkCoord, Async(EAsyncExecution::ThreadPool, [Path]()
+	{
+		TSharedPtr<FSurvivalSaveChunkSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FSurvivalSaveChunkSnapshot, ESPMode::ThreadSafe>();
+		Snapshot->Path = Path;
+		return Snapshot->Read() ? Snapshot : nullptr;
+	}));
+}
+
+void USurvivalSaveSubsystem::LoadNearbyChunks()
+{
+	LoadChunk(SurvivalSave::GlobalChunk);
+
+	const int32 Radius = FMath::CeilToInt(LoadRadius / ChunkSize);
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* Controller = It->Get();
+		if (!Controller)
+		{
+			continue;
+		}
+		FVector Location;
+		FRotator Rotation;
+		Controller->GetPlayerViewPoint(Location, Rotation);
+		const FIntPoint Center(FMath::FloorToInt(Location.X / ChunkSize), FMath::FloorToInt(Location.Y / ChunkSize));
+		for (int32 X = -Radius; X <= Radius; X++)
+		{
+			for (int32 Y = -Radius; Y <= Radius; Y++)
+			{
+				if (X * X + Y * Y <= Radius * Radius)
+				{
+					LoadChunk(Center + FIntPoint(X, Y));
+				}
+			}
+		}
+	}
+}
+
+void USurvivalSaveSubsystem::CompleteLoads()
+{
+	for (int32 i = PendingLoads.Num() - 1; i >= 0; i--)
+	{
+		if (!PendingLoads[i].Value.IsReady())
+		{
+			continue;
+		}
+		const FIntPoint ChunkCoord = PendingLoads[i].Key;
+		TSharedPtr<FSurvivalSaveChunkSnapshot, ESPMode::ThreadSafe> Snapshot = PendingLoads[i].Value.Get();
+		PendingLoads.RemoveAtSwap(i);
+
+		FChunk& Chunk = GetChunk(ChunkCoord);
+		Chunk.Loading = false;
+		Chunk.Loaded = true;
+		if (Snapshot)
+		{
+			ChunkLoaded(ChunkCoord, *Snapshot);
+		}
+		else
+		{
+			UE_LOG(LogSurvivalGame, Error, TEXT("Save: %s is corrupt or from another version, it will be replaced"), *GetChunkPath(ChunkCoord));
+		}
+	}
+}
+
+void USurvivalSaveSubsystem::ChunkLoaded(FIntPoint ChunkCoord, const FSurvivalSaveChunkSnapshot& Snapshot)
+{
+	//Records are added straight away so saving the chunk keeps them, spawning is spread over frames
+	for (const FSurvivalSaveChunkSnapshot::FRecord& Saved : Snapshot.Records)
+	{
+		FSurvivalSaveRecord& Record = Records.FindOrAdd(Saved.Id);
+		Record.ClassPath = Saved.ClassPath;
+		Record.Transform = Saved.Transform;
+		Record.Version = Saved.Version;
+		Record.Removed = Saved.Removed;
+		Record.Payload = Saved.Payload;
+		Record.PendingLoad = true;
+		MoveRecordToChunk(Saved.Id, Record, ChunkCoord);
+		DirtyRecords.Remove(Saved.Id);
+		LoadQueue.Add(Saved.Id);
+	}
+}
+
+void USurvivalSaveSubsystem::ProcessLoadedRecords()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_SurvivalSaveLoadRecords);
+	int32 Processed = 0;
+	while (LoadQueue.Num() > 0 && Processed < MaxLoadsPerFrame)
+	{
+		const FString Id = LoadQueue.Pop(false);
+		FSurvivalSaveRecord* Record = Records.Find(Id);
+		if (!Record || !Record->PendingLoad)
+		{
+			continue;
+		}
+		Processed++;
+
+		if (UObject* Object = Record->Object.Get())
+		{
+			ApplyRecord(*Record, Cast<ISurvivalSaveable>(Object));
+			continue;
+		}
+		if (Record->ClassPath.IsEmpty() || Record->Removed)
+		{
+			continue; //Applied when its object registers
+		}
+
+		UClass*& Class = LoadedClasses.FindOrAdd(Record->ClassPath);
+		if (!Class)
+		{
+			Class = LoadClass<AActor>(nullptr, *Record->ClassPath);
+		}
+		if (!Class)
+		{
+			UE_LOG(LogSurvivalGame, Warning, TEXT("Save: can't load %s for %s, it is kept in the save"), *Record->ClassPath, *Id);
+			continue;
+		}
+
+		//The actor registers during the spawn and takes this record's id and state
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawningId = Id;
+		GetWorld()->SpawnActor<AActor>(Class, Record->Transform, Params);
+		SpawningId.Reset();
+	}
+}
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SurvivalSaveSubsystem.generated.h"
+
+class AActor;
+class ISurvivalSaveable;
+
+/** A saved object's last snapshot, shared with the thread writing it */
+struct FSurvivalSaveRecord
+{
+	TWeakObjectPtr<UObject> Object;
+	/** Spawned again from this class when its chunk loads, empty for objects that exist on their own */
+	FString ClassPath;
+	FTransform Transform;
+	int32 Version = 0;
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Payload;
+	FIntPoint Chunk = FIntPoint::ZeroValue;
+	//A level placed object that was destroyed, it is destroyed again when it loads
+	bool Removed = false;
+	//Loaded from disk, waiting to be spawned or for its object to register
+	bool PendingLoad = false;
+};
+
+/** What the background thread needs to write one chunk file */
+struct FSurvivalSaveChunkSnapshot
+{
+	struct FRecord
+	{
+		FString Id;
+		FString ClassPath;
+		FTransform Transform;
+		int32 Version = 0;
+		bool Removed = false;
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Payload;
+	};
+
+	FIntPoint Chunk;
+	FString Path;
+	TArray<FRecord> Records;
+
+	/** Compresses the records and replaces the chunk's file, run on the thread pool */
+	bool Write();
+	bool Read();
+};
+
+/**
+ * Saves ISurvivalSaveable objects into one file per square chunk of the world, on the server.
+ * Only dirty objects are copied on the game thread, and only the chunks they are in are written.
+ * Writing and compression run on the thread pool. Chunks load in the background as players come near them,
+ * and their objects are spawned a few per frame.
+ */
+UCLASS(config=Game)
+class SURVIVALGAMEKITV1_API USurvivalSaveSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override
+	{
+		return GetWorld();
+	}
+
+	/** Width of a chunk */
+	UPROPERTY(Config)
+	float ChunkSize = 10000.0f;
+	/** Chunks this close to a player are loaded */
+	UPROPERTY(Config)
+	float LoadRadius = 30000.0f;
+	UPROPERTY(Config)
+	float LoadCheckInterval = 0.5f;
+	/** Seconds between saves of the dirty chunks, 0 to only save with SaveNow */
+	UPROPERTY(Config)
+	float AutosaveInterval = 60.0f;
+	/** Loaded objects spawned or given their state per frame */
+	UPROPERTY(Config)
+	int32 MaxLoadsPerFrame = 32;
+	/** Folder under Saved/SaveGames */
+	UPROPERTY(Config)
+	FString SaveSlot = TEXT("Default");
+
+	/** Call from BeginPlay. Objects with a saved state get it back straight away */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	void Register(UObject* Saveable);
+	/** Call from EndPlay. Destroyed objects are removed from the save, others keep their last state */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	void Unregister(UObject* Saveable, bool Destroyed);
+	/** The object is saved with the next save */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	void MarkDirty(UObject* Saveable);
+
+	/** Starts writing every dirty chunk that can be written */
+	UFUNCTION(BlueprintCallable, Category = "Save")
+	void SaveNow();
+
+	UFUNCTION(BlueprintPure, Category = "Save")
+	bool IsSaving() const
+	{
+		return PendingSaves.Num() > 0;
+	}
+
+	FString GetSaveDirectory() const;
+
+private:
+	struct FChunk
+	{
+		TSet<FString> RecordIds;
+		bool Dirty = false;
+		bool Saving = false;
+		bool OnDisk = false;
+		bool Loading = false;
+		bool Loaded = false;
+	};
+
+	bool CanSave() const;
+	static bool IsPlacedInLevel(UObject* Object);
+	static AActor* GetSavedActor(UObject* Object, ISurvivalSaveable* Saveable);
+	FIntPoint GetChunkFor(UObject* Object, ISurvivalSaveable* Saveable) const;
+	FString GetChunkPath(FIntPoint Chunk) const;
+	FChunk& GetChunk(FIntPoint Chunk);
+	void MoveRecordToChunk(const FString& Id, FSurvivalSaveRecord& Record, FIntPoint Chunk);
+
+	void SnapshotRecord(const FString& Id, FSurvivalSaveRecord& Record);
+	void ApplyRecord(FSurvivalSaveRecord& Record, ISurvivalSaveable* Saveable);
+	void FindChunksOnDisk();
+	void LoadChunk(FIntPoint Chunk);
+	void LoadNearbyChunks();
+	void ChunkLoaded(FIntPoint Chunk, const FSurvivalSaveChunkSnapshot& Snapshot);
+	void ProcessLoadedRecords();
+	void CompleteSaves(bool Wait);
+	void CompleteLoads();
+
+	bool bInitialized = false;
+	TMap<FIntPoint, FChunk> Chunks;
+	TMap<FString, FSurvivalSaveRecord> Records;
+	TMap<const UObject*, FString> IdsByObject;
+	TSet<FString> DirtyRecords;
+	//Loaded records waiting to be spawned or applied, a few each frame
+	TArray<FString> LoadQueue;
+	//Id given to the actor being spawned from a record, it registers during the spawn
+	FString SpawningId;
+	UPROPERTY(Transient)
+	TMap<FString, UClass*> LoadedClasses;
+
+	TArray<TPair<FIntPoint, TFuture<bool>>> PendingSaves;
+	TArray<TPair<FIntPoint, TFuture<TSharedPtr<FSurvivalSaveChunkSnapshot, ESPMode::ThreadSafe>>>> PendingLoads;
+
+	float NextAutosaveTime = 0;
+	float NextLoadCheckTime = 0;
+};
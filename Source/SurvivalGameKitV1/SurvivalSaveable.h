@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "SurvivalSaveable.generated.h"
+
+class AActor;
+
+UINTERFACE(MinimalAPI, meta = (CannotImplementInterfaceInBlueprint))
+class USurvivalSaveable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * An object saved by USurvivalSaveSubsystem. It registers in BeginPlay, unregisters in EndPlay and calls MarkDirty when its state changes.
+ * Actors spawned at runtime are spawned again when their chunk loads. Actors placed in the level get their state back when they register.
+ * Native only, Blueprint actors are saved by adding a USurvivalSaveComponent.
+ */
+class SURVIVALGAMEKITV1_API ISurvivalSaveable
+{
+	GENERATED_BODY()
+
+public:
+	/** Called on the game thread when the object is dirty and a save starts. Only copy state here, compression and writing happen on another thread */
+	virtual void WriteSaveState(FArchive& Ar) = 0;
+	/** Reads what WriteSaveState wrote, Version is what GetSaveVersion returned at the time */
+	virtual void ReadSaveState(FArchive& Ar, int32 Version) = 0;
+
+	/** Bump when what WriteSaveState writes changes */
+	virtual int32 GetSaveVersion() const
+	{
+		return 0;
+	}
+
+	/** Saved with the chunk it stands in, otherwise with the global chunk that loads at start, like players */
+	virtual bool IsSavedByLocation() const
+	{
+		return true;
+	}
+
+	/** A stable id for objects that exist before their save loads, like a player's net id. Empty lets the save pick one */
+	virtual FString GetSaveId() const
+	{
+		return FString();
+	}
+
+	/** The actor spawned again, moved and destroyed with this save, for components that save their whole actor. Null uses the object itself when it is an actor */
+	virtual AActor* GetSavedActor() const
+	{
+		return nullptr;
+	}
+};
@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalStructureSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "SurvivalBuildGridSubsystem.h"
+
+int32 FSurvivalSupportGraph::AddNode(bool bGrounded)
+{
+	FNode Node;
+	Node.bGrounded = bGrounded;
+	Node.bSupported = bGrounded;
+	return Nodes.Add(MoveTemp(Node));
+}
+
+void FSurvivalSupportGraph::Attach(int32 NodeId, int32 Parent)
+{
+	FNode& Node = Nodes[NodeId];
+	Node.Parent = Parent;
+	Node.Depth = Nodes[Parent].Depth + 1;
+	Node.bSupported = true;
+	Nodes[Parent].Children.Add(NodeId);
+}
+
+void FSurvivalSupportGraph::FloodSupport(TArray<int32>& Queue)
+{
+	for (int32 i = 0; i < Queue.Num(); i++)
+	{
+		const int32 NodeId = Queue[i];
+		for (int32 Link : Nodes[NodeId].Links)
+		{
+			if (!Nodes[Link].bSupported)
+			{
+				Attach(Link, NodeId);
+				Queue.Add(Link);
+			}
+		}
+	}
+}
+
+void FSurvivalSupportGraph::Connect(int32 A, int32 B)
+{
+	if (A == B || !Nodes.IsValidIndex(A) || !Nodes.IsValidIndex(B) || Nodes[A].Links.Contains(B))
+	{
+		return;
+	}
+	Nodes[A].Links.Add(B);
+	Nodes[B].Links.Add(A);
+
+	//Only a connection between a supported and an unsupported part changes anything
+	if (Nodes[A].bSupported == Nodes[B].bSupported)
+	{
+		return;
+	}
+	const int32 Supported = Nodes[A].bSupported ? A : B;
+	const int32 Unsupported = Nodes[A].bSupported ? B : A;
+	Attach(Unsupported, Supported);
+	TArray<int32> Queue;
+	Queue.Add(Unsupported);
+	FloodSupport(Queue);
+}
+
+void FSurvivalSupportGraph::RemoveNode(int32 NodeId, TArray<int32>& OutUnsupported)
+{
+	if (!Nodes.IsValidIndex(NodeId))
+	{
+		return;
+	}
+
+	{
+		FNode& Node = Nodes[NodeId];
+		if (Node.Parent != INDEX_NONE)
+		{
+			Nodes[Node.Parent].Children.RemoveSingleSwap(NodeId, false);
+		}
+		for (int32 Link : Node.Links)
+		{
+			Nodes[Link].Links.RemoveSingleSwap(NodeId, false);
+		}
+	}
+
+	//Everything that hung from the node is unsupported until shown otherwise, the rest of the base isn't touched
+	TArray<int32> Orphans;
+	Orphans.Append(Nodes[NodeId].Children);
+	Nodes.RemoveAt(NodeId);
+	for (int32 i = 0; i < Orphans.Num(); i++)
+	{
+		FNode& Orphan = Nodes[Orphans[i]];
+		Orphan.Parent = INDEX_NONE;
+		Orphan.bSupported = false;
+		Orphans.Append(Orphan.Children);
+		Orphan.Children.Reset();
+	}
+
+	//Orphans next to a part that is still supported hang from the shallowest one, then support the rest
+	TArray<int32> Queue;
+	for (int32 OrphanId : Orphans)
+	{
+		int32 Best = INDEX_NONE;
+		for (int32 Link : Nodes[OrphanId].Links)
+		{
+			if (Nodes[Link].bSupported && (Best == INDEX_NONE || Nodes[Link].Depth < Nodes[Best].Depth))
+			{
+				Best = Link;
+			}
+		}
+		if (Best != INDEX_NONE)
+		{
+			Attach(OrphanId, Best);
+			Queue.Add(OrphanId);
+		}
+	}
+	Queue.Sort([this](int32 A, int32 B)
+	{
+		return Nodes[A].Depth < Nodes[B].Depth;
+	});
+	FloodSupport(Queue);
+
+	for (int32 OrphanId : Orphans)
+	{
+		if (!Nodes[OrphanId].bSupported)
+		{
+			OutUnsupported.Add(OrphanId);
+		}
+	}
+}
+
+void FSurvivalSupportGraph::Reset()
+{
+	Nodes.Empty();
+}
+
+void USurvivalStructureSubsystem::Deinitialize()
+{
+	Graph.Reset();
+	NodeIds.Reset();
+	NodeActors.Reset();
+	Super::Deinitialize();
+}
+
+int32 USurvivalStructureSubsystem::FindNodeId(const AActor* Part) const
+{
+	const int32* NodeId = Part ? NodeIds.Find(Part) : nullptr;
+	return NodeId ? *NodeId : INDEX_NONE;
+}
+
+void USurvivalStructureSubsystem::AddPart(AActor* Part, bool bGrounded, float ContactTolerance)
+{
+	if (!Part || NodeIds.Contains(Part))
+	{
+		return;
+	}
+
+	const int32 NodeId = Graph.AddNode(bGrounded);
+	if (NodeActors.Num() <= NodeId)
+	{
+		NodeActors.SetNum(NodeId + 1);
+	}
+	NodeActors[NodeId] = Part;
+	NodeIds.Add(Part, NodeId);
+
+	if (const USurvivalBuildGridSubsystem* BuildGrid = GetWorld()->GetSubsystem<USurvivalBuildGridSubsystem>())
+	{
+		TArray<AActor*> Touching;
+		BuildGrid->GetTouchingParts(Part, ContactTolerance, Touching);
+		for (AActor* Other : Touching)
+		{
+			Graph.Connect(NodeId, FindNodeId(Other));
+		}
+	}
+}
+
+void USurvivalStructureSubsystem::ConnectParts(AActor* A, AActor* B)
+{
+	Graph.Connect(FindNodeId(A), FindNodeId(B));
+}
+
+void USurvivalStructureSubsystem::RemovePart(AActor* Part, TArray<AActor*>& Collapsed)
+{
+	Collapsed.Reset();
+	int32 NodeId;
+	if (!Part || !NodeIds.RemoveAndCopyValue(Part, NodeId))
+	{
+		return;
+	}
+
+	TArray<int32> Unsupported;
+	Graph.RemoveNode(NodeId, Unsupported);
+	NodeActors[NodeId] = nullptr;
+	for (int32 UnsupportedId : Unsupported)
+	{
+		if (AActor* CollapsedPart = NodeActors[UnsupportedId].Get())
+		{
+			Collapsed.Add(CollapsedPart);
+		}
+	}
+}
+
+bool USurvivalStructureSubsystem::IsSupported(const AActor* Part) const
+{
+	return Graph.IsSupported(FindNodeId(Part));
+}
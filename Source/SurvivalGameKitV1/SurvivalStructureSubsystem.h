@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SurvivalStructureSubsystem.generated.h"
+
+/**
+ * Which parts connect to a grounded part. Every supported part keeps one parent in a forest rooted at the grounded parts.
+ * Removing a part only revisits the parts that hung from it, they reattach through any other supported neighbor or collapse.
+ * Adding a part or a connection only floods the parts it newly supports.
+ */
+class SURVIVALGAMEKITV1_API FSurvivalSupportGraph
+{
+public:
+	int32 AddNode(bool bGrounded);
+	/** Outs the nodes that lost support, they stay in the graph until removed */
+	void RemoveNode(int32 NodeId, TArray<int32>& OutUnsupported);
+	void Connect(int32 A, int32 B);
+	void Reset();
+
+	bool IsSupported(int32 NodeId) const
+	{
+		return Nodes.IsValidIndex(NodeId) && Nodes[NodeId].bSupported;
+	}
+
+	int32 NumNodes() const
+	{
+		return Nodes.Num();
+	}
+
+private:
+	struct FNode
+	{
+		TArray<int32, TInlineAllocator<6>> Links;
+		TArray<int32, TInlineAllocator<2>> Children;
+		int32 Parent = INDEX_NONE;
+		//Steps to the ground through parents, used to hang parts from the shortest path
+		int32 Depth = 0;
+		bool bGrounded = false;
+		bool bSupported = false;
+	};
+
+	void Attach(int32 NodeId, int32 Parent);
+	/** Supports every unsupported node reachable from Queue, breadth first so paths stay short */
+	void FloodSupport(TArray<int32>& Queue);
+
+	TSparseArray<FNode> Nodes;
+};
+
+/**
+ * Tracks which build parts are held up by a foundation, so demolishing a part tells what collapses with it without rescanning the base.
+ * Parts register when placed and are connected to the parts they touch. Collapsed parts are returned, not destroyed.
+ */
+UCLASS()
+class SURVIVALGAMEKITV1_API USurvivalStructureSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Grounded parts, like foundations, support themselves. Connects to the parts the build grid finds within ContactTolerance, register it there first */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void AddPart(AActor* Part, bool bGrounded, float ContactTolerance = 5.0f);
+	/** For connections the build grid can't see */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void ConnectParts(AActor* A, AActor* B);
+	/** Outs the parts that no longer reach the ground, destroying them removes them in turn */
+	UFUNCTION(BlueprintCallable, Category = "Building")
+	void RemovePart(AActor* Part, TArray<AActor*>& Collapsed);
+
+	UFUNCTION(BlueprintPure, Category = "Building")
+	bool IsSupported(const AActor* Part) const;
+
+private:
+	int32 FindNodeId(const AActor* Part) const;
+
+	FSurvivalSupportGraph Graph;
+	TMap<const AActor*, int32> NodeIds;
+	//By node id
+	TArray<TWeakObjectPtr<AActor>> NodeActors;
+};